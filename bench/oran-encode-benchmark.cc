@@ -0,0 +1,504 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/oran-interface.h"
+#include "ns3/kpi-schema.h"
+#include "ns3/mock-ric.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <stdlib.h>
+
+using namespace ns3;
+
+/**
+* Encode throughput of the E2SM builders. Every case builds one message
+* per iteration for at least minTime seconds and reports messages/s,
+* ns/message, ns/UE, encoded bytes/message and heap allocations/message
+* as JSON, one case per line.
+*
+* ./waf --run "oran-encode-benchmark --output=baseline.json"
+* ./waf --run "oran-encode-benchmark --compare=baseline.json,candidate.json"
+*
+* The second form compares two runs, typically of two builds, and exits
+* with status 1 if a case of the candidate is slower than the baseline by
+* more than the threshold or allocates more.
+*/
+
+NS_LOG_COMPONENT_DEFINE ("OranEncodeBenchmark");
+
+#if defined(__GLIBC__) && !defined(NS3_ORAN_ALLOC_ACCOUNTING)
+// Counts every heap allocation of the process, asn1c and operator new
+// included, by interposing the glibc allocator. Builds with the asn1c
+// allocation accounting interpose free and realloc in the module, so the
+// allocations are not counted there.
+extern "C" {
+void *__libc_malloc (size_t size);
+void *__libc_calloc (size_t count, size_t size);
+void *__libc_realloc (void *ptr, size_t size);
+}
+
+static std::atomic<uint64_t> g_allocations (0);
+
+extern "C" void *
+malloc (size_t size)
+{
+  g_allocations.fetch_add (1, std::memory_order_relaxed);
+  return __libc_malloc (size);
+}
+
+extern "C" void *
+calloc (size_t count, size_t size)
+{
+  g_allocations.fetch_add (1, std::memory_order_relaxed);
+  return __libc_calloc (count, size);
+}
+
+extern "C" void *
+realloc (void *ptr, size_t size)
+{
+  g_allocations.fetch_add (1, std::memory_order_relaxed);
+  return __libc_realloc (ptr, size);
+}
+
+static bool
+CountsAllocations ()
+{
+  return true;
+}
+
+static uint64_t
+GetAllocations ()
+{
+  return g_allocations.load (std::memory_order_relaxed);
+}
+#else
+static bool
+CountsAllocations ()
+{
+  return false;
+}
+
+static uint64_t
+GetAllocations ()
+{
+  return 0;
+}
+#endif
+
+/**
+* Measurements of a case, or of a case read back from a JSON file
+*/
+struct BenchmarkResult
+{
+  std::string m_name;
+  uint32_t m_ues; //!< UEs per message, 0 if not UE-specific
+  uint32_t m_kpis; //!< KPIs per UE, 0 if not UE-specific
+  uint64_t m_iterations;
+  double m_nsPerMessage;
+  double m_messagesPerSecond;
+  double m_nsPerUe; //!< 0 if not UE-specific
+  double m_bytesPerMessage;
+  double m_allocationsPerMessage; //!< negative if not counted
+};
+
+/**
+* Builds one message and returns its encoded size
+*/
+typedef std::function<size_t ()> BenchmarkBody;
+
+static const uint64_t MIN_ITERATIONS = 3;
+
+static BenchmarkResult
+RunBenchmark (const std::string &name, uint32_t ues, uint32_t kpis, BenchmarkBody body,
+              double minTime)
+{
+  // fills the template caches and buffer pools, as in a running scenario
+  body ();
+
+  uint64_t iterations = 0;
+  uint64_t bytes = 0;
+  uint64_t allocations = GetAllocations ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  std::chrono::steady_clock::time_point deadline =
+      start + std::chrono::duration_cast<std::chrono::steady_clock::duration> (
+                  std::chrono::duration<double> (minTime));
+  std::chrono::steady_clock::time_point now;
+  do
+    {
+      bytes += body ();
+      ++iterations;
+      now = std::chrono::steady_clock::now ();
+    }
+  while (now < deadline || iterations < MIN_ITERATIONS);
+  allocations = GetAllocations () - allocations;
+
+  double elapsed = std::chrono::duration<double, std::nano> (now - start).count ();
+  BenchmarkResult result;
+  result.m_name = name;
+  result.m_ues = ues;
+  result.m_kpis = kpis;
+  result.m_iterations = iterations;
+  result.m_nsPerMessage = elapsed / iterations;
+  result.m_messagesPerSecond = 1e9 * iterations / elapsed;
+  result.m_nsPerUe = ues > 0 ? result.m_nsPerMessage / ues : 0;
+  result.m_bytesPerMessage = (double) bytes / iterations;
+  result.m_allocationsPerMessage =
+      CountsAllocations () ? (double) allocations / iterations : -1;
+  return result;
+}
+
+static std::string
+ToJson (const BenchmarkResult &result)
+{
+  std::ostringstream json;
+  json << std::setprecision (10) << "{\"name\": \"" << result.m_name << "\", \"ues\": "
+       << result.m_ues << ", \"kpis\": " << result.m_kpis
+       << ", \"iterations\": " << result.m_iterations
+       << ", \"nsPerMessage\": " << result.m_nsPerMessage
+       << ", \"messagesPerSecond\": " << result.m_messagesPerSecond
+       << ", \"nsPerUe\": " << result.m_nsPerUe
+       << ", \"bytesPerMessage\": " << result.m_bytesPerMessage << ", \"allocationsPerMessage\": ";
+  if (result.m_allocationsPerMessage < 0)
+    {
+      json << "null";
+    }
+  else
+    {
+      json << result.m_allocationsPerMessage;
+    }
+  json << "}";
+  return json.str ();
+}
+
+/**
+* \return the number following "key": in a line written by ToJson, or
+*         -1 if the key is missing or null
+*/
+static double
+GetJsonNumber (const std::string &line, const std::string &key)
+{
+  size_t pos = line.find ("\"" + key + "\": ");
+  if (pos == std::string::npos)
+    {
+      return -1;
+    }
+  const char *value = line.c_str () + pos + key.size () + 4;
+  char *end;
+  double number = strtod (value, &end);
+  return end == value ? -1 : number;
+}
+
+/**
+* Reads back the cases of a file written by this program
+*/
+static std::map<std::string, BenchmarkResult>
+ReadResults (const std::string &path)
+{
+  std::ifstream file (path);
+  NS_ABORT_MSG_IF (!file.is_open (), "Cannot open " << path);
+
+  std::map<std::string, BenchmarkResult> results;
+  std::string line;
+  while (std::getline (file, line))
+    {
+      size_t name = line.find ("\"name\": \"");
+      if (name == std::string::npos)
+        {
+          continue;
+        }
+      name += 9;
+      BenchmarkResult result;
+      result.m_name = line.substr (name, line.find ('"', name) - name);
+      result.m_ues = GetJsonNumber (line, "ues");
+      result.m_kpis = GetJsonNumber (line, "kpis");
+      result.m_iterations = GetJsonNumber (line, "iterations");
+      result.m_nsPerMessage = GetJsonNumber (line, "nsPerMessage");
+      result.m_messagesPerSecond = GetJsonNumber (line, "messagesPerSecond");
+      result.m_nsPerUe = GetJsonNumber (line, "nsPerUe");
+      result.m_bytesPerMessage = GetJsonNumber (line, "bytesPerMessage");
+      result.m_allocationsPerMessage = GetJsonNumber (line, "allocationsPerMessage");
+      results[result.m_name] = result;
+    }
+  return results;
+}
+
+/**
+* Prints the candidate against the baseline, case by case
+*
+* \return the number of regressions
+*/
+static uint32_t
+CompareResults (const std::string &baselinePath, const std::string &candidatePath,
+                double threshold)
+{
+  std::map<std::string, BenchmarkResult> baseline = ReadResults (baselinePath);
+  std::map<std::string, BenchmarkResult> candidate = ReadResults (candidatePath);
+
+  uint32_t regressions = 0;
+  std::cout << std::left << std::setw (34) << "case" << std::right << std::setw (14)
+            << "base ns/msg" << std::setw (14) << "cand ns/msg" << std::setw (8) << "ratio"
+            << std::setw (12) << "base alloc" << std::setw (12) << "cand alloc"
+            << std::setw (12) << "base bytes" << std::setw (12) << "cand bytes" << std::endl;
+  for (const auto &entry : baseline)
+    {
+      auto found = candidate.find (entry.first);
+      if (found == candidate.end ())
+        {
+          std::cout << std::left << std::setw (34) << entry.first << "  missing in the candidate"
+                    << std::endl;
+          continue;
+        }
+      const BenchmarkResult &base = entry.second;
+      const BenchmarkResult &cand = found->second;
+      double ratio = cand.m_nsPerMessage / base.m_nsPerMessage;
+      bool slower = ratio > 1 + threshold;
+      // allocation counts are deterministic up to the pool refills, which
+      // the half allocation absorbs
+      bool allocates = base.m_allocationsPerMessage >= 0 && cand.m_allocationsPerMessage >= 0 &&
+                       cand.m_allocationsPerMessage > base.m_allocationsPerMessage + 0.5;
+      std::cout << std::left << std::setw (34) << entry.first << std::right << std::fixed
+                << std::setprecision (0) << std::setw (14) << base.m_nsPerMessage
+                << std::setw (14) << cand.m_nsPerMessage << std::setprecision (3)
+                << std::setw (8) << ratio << std::setprecision (1) << std::setw (12)
+                << base.m_allocationsPerMessage << std::setw (12)
+                << cand.m_allocationsPerMessage << std::setprecision (0) << std::setw (12)
+                << base.m_bytesPerMessage << std::setw (12) << cand.m_bytesPerMessage;
+      if (slower || allocates)
+        {
+          std::cout << "  REGRESSION";
+          ++regressions;
+        }
+      std::cout << std::endl;
+    }
+  for (const auto &entry : candidate)
+    {
+      if (baseline.find (entry.first) == baseline.end ())
+        {
+          std::cout << std::left << std::setw (34) << entry.first << "  new in the candidate"
+                    << std::endl;
+        }
+    }
+  return regressions;
+}
+
+/**
+* \return the bytes of a RIC Control Request sent by the mock RIC
+*/
+static std::vector<uint8_t>
+CaptureRicControlRequest ()
+{
+  std::pair<Ptr<InProcessE2Transport>, Ptr<InProcessE2Transport>> ends =
+      InProcessE2Transport::CreatePair ();
+
+  std::mutex mutex;
+  std::condition_variable received;
+  std::vector<uint8_t> bytes;
+  ends.second->Connect ([&] (const uint8_t *buffer, size_t size) {
+    std::lock_guard<std::mutex> lock (mutex);
+    bytes.assign (buffer, buffer + size);
+    received.notify_all ();
+  });
+
+  Ptr<MockRic> ric = CreateObject<MockRic> ();
+  ric->SetTransport (ends.first);
+  ric->Start ();
+  ric->SendControl (MockRic::HANDOVER, 1, 2);
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    received.wait_for (lock, std::chrono::seconds (1), [&] () { return !bytes.empty (); });
+  }
+  ends.second->Close ();
+  ric->Dispose ();
+
+  NS_ABORT_MSG_IF (bytes.empty (), "The mock RIC did not send the RIC Control Request");
+  std::lock_guard<std::mutex> lock (mutex);
+  return bytes;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string filter;
+  double minTime = 0.5;
+  std::string output;
+  std::string compare;
+  double threshold = 0.05;
+  uint32_t workers = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("filter", "Only run the cases whose name contains this string", filter);
+  cmd.AddValue ("minTime", "Minimum measured time of each case, in seconds", minTime);
+  cmd.AddValue ("output", "JSON file of the results, standard output if empty", output);
+  cmd.AddValue ("compare",
+                "Compare two result files instead of running, as baseline.json,candidate.json",
+                compare);
+  cmd.AddValue ("threshold", "Slowdown over which compare reports a regression", threshold);
+  cmd.AddValue ("workers", "Threads building Format 3 reports, see SetParallelBuild", workers);
+  cmd.Parse (argc, argv);
+
+  if (!compare.empty ())
+    {
+      size_t comma = compare.find (',');
+      NS_ABORT_MSG_IF (comma == std::string::npos,
+                       "--compare expects baseline.json,candidate.json");
+      uint32_t regressions =
+          CompareResults (compare.substr (0, comma), compare.substr (comma + 1), threshold);
+      std::cout << regressions << " regression(s)" << std::endl;
+      return regressions > 0 ? 1 : 0;
+    }
+
+  KpmIndicationMessage::SetParallelBuild (workers);
+
+  std::vector<BenchmarkResult> results;
+  auto run = [&] (const std::string &name, uint32_t ues, uint32_t kpis, BenchmarkBody body) {
+    if (name.find (filter) == std::string::npos)
+      {
+        return;
+      }
+    results.push_back (RunBenchmark (name, ues, kpis, body, minTime));
+    NS_LOG_INFO (ToJson (results.back ()));
+  };
+
+  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues;
+  headerValues.m_plmId = "111";
+  headerValues.m_gnbId = "1";
+  headerValues.m_nrCellId = 5;
+  headerValues.m_timestamp = 1630068655325;
+  run ("kpm-header", 0, 0, [&] () {
+    ++headerValues.m_timestamp;
+    Ptr<KpmIndicationHeader> header =
+        Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::gNB, headerValues);
+    return header->m_size;
+  });
+  run ("kpm-header-uncached", 0, 0, [&] () {
+    KpmIndicationHeader::ClearTemplateCache ();
+    Ptr<KpmIndicationHeader> header =
+        Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::gNB, headerValues);
+    return header->m_size;
+  });
+
+  std::vector<const KpiDescriptor *> ueKpis;
+  for (const KpiDescriptor &descriptor : KPI_SCHEMA)
+    {
+      if (descriptor.m_scope == KPI_UE)
+        {
+          ueKpis.push_back (&descriptor);
+        }
+    }
+  for (uint32_t ues : {1, 10, 100, 1000, 5000})
+    {
+      for (uint32_t kpis : {1, 10, 30})
+        {
+          KpmIndicationMessage::KpmIndicationMessageValues values;
+          values.m_cellObjectId = "NRCellCU";
+          for (uint32_t ue = 0; ue < ues; ++ue)
+            {
+              size_t slot = values.m_ueKpis.GetSlot ("1110000000" + std::to_string (10000 + ue));
+              for (uint32_t kpi = 0; kpi < kpis && kpi < ueKpis.size (); ++kpi)
+                {
+                  const KpiDescriptor *descriptor = ueKpis[kpi];
+                  size_t column = values.m_ueKpis.GetColumn (descriptor->m_id,
+                                                             descriptor->m_name,
+                                                             descriptor->m_type);
+                  if (descriptor->m_type == KpiTable::REAL)
+                    {
+                      values.m_ueKpis.SetReal (slot, column, ue / 7.0 + kpi);
+                    }
+                  else
+                    {
+                      values.m_ueKpis.SetInteger (slot, column, ue * 1000 + kpi);
+                    }
+                }
+            }
+          run ("kpm-message-f3/" + std::to_string (ues) + "x" + std::to_string (kpis), ues,
+               kpis, [&values] () {
+                 Ptr<KpmIndicationMessage> message = Create<KpmIndicationMessage> (values);
+                 return message->m_size;
+               });
+          // steady state of a persistent tree, no UE attaches or detaches
+          Ptr<KpmReportTree> tree = Create<KpmReportTree> ();
+          run ("kpm-message-f3-tree/" + std::to_string (ues) + "x" + std::to_string (kpis), ues,
+               kpis, [&values, tree] () {
+                 Ptr<KpmIndicationMessage> message =
+                     Create<KpmIndicationMessage> (tree, 0, tree->Update (values));
+                 return message->m_size;
+               });
+        }
+    }
+
+  run ("kpm-function-description", 0, 0, [] () {
+    Ptr<KpmFunctionDescription> description = Create<KpmFunctionDescription> ();
+    return description->m_size;
+  });
+  run ("rc-function-description", 0, 0, [] () {
+    Ptr<RicControlFunctionDescription> description = Create<RicControlFunctionDescription> ();
+    return description->m_size;
+  });
+
+  // a neighbour report of the 8 cells allowed by the standard, freed as
+  // the indication message would free it
+  run ("l3-rrc-measurements", 0, 0, [] () {
+    Ptr<L3RrcMeasurements> measurements = L3RrcMeasurements::CreateL3RrcUeSpecificSinrNeigh ();
+    for (long cell = 0; cell < 8; ++cell)
+      {
+        measurements->AddNeighbourCellMeasurement (cell + 2, 40 + cell);
+      }
+    ASN_STRUCT_FREE (asn_DEF_L3_RRC_Measurements, measurements->GetPointer ());
+    return (size_t) 0;
+  });
+
+  std::vector<uint8_t> control = CaptureRicControlRequest ();
+  run ("ric-control-decode", 0, 0, [&control] () {
+    E2AP_PDU_t *pdu = nullptr;
+    asn_dec_rval_t decoded = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU,
+                                         (void **) &pdu, control.data (), control.size ());
+    NS_ABORT_MSG_IF (decoded.code != RC_OK, "Cannot decode the RIC Control Request");
+    // decoded and released right away, as by the E2 termination
+    Create<RicControlMessage> (pdu);
+    ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+    return control.size ();
+  });
+
+  std::ofstream file;
+  if (!output.empty ())
+    {
+      file.open (output);
+      NS_ABORT_MSG_IF (!file.is_open (), "Cannot open " << output);
+    }
+  std::ostream &json = output.empty () ? std::cout : file;
+  json << "{\"benchmarks\": [" << std::endl;
+  for (size_t i = 0; i < results.size (); ++i)
+    {
+      json << "  " << ToJson (results[i]) << (i + 1 < results.size () ? "," : "") << std::endl;
+    }
+  json << "]}" << std::endl;
+  return 0;
+}
@@ -75,22 +75,13 @@ static void BuildAndSendReportMessage (E2Termination::RicSubscriptionRequest_rva
   ue1DummyValues->AddItem<double> ("DRB.IPThpDl.UEID", 10.0);
   ue1DummyValues->AddItem<double> ("DRB.IPLateDl.UEID", 11.0);
   msgValues.m_ueIndications.insert (ue1DummyValues);
+
+  // only the KPIs requested by the action definition are encoded
+  msgValues.m_subscription = params.subscription;
   
-  Ptr<KpmIndicationMessage> msg = Create<KpmIndicationMessage> (msgValues);
-  
-  E2AP_PDU *pdu_cuup_ue = new E2AP_PDU;	
-  encoding::generate_e2apv1_indication_request_parameterized(pdu_cuup_ue, 
-                                                             params.requestorId,
-                                                             params.instanceId,
-                                                             params.ranFuncionId,
-                                                             params.actionId,
-                                                             1, // TODO sequence number  
-                                                             (uint8_t*) header->m_buffer, // buffer containing the encoded header
-                                                             header->m_size, // size of the encoded header
-                                                             (uint8_t*) msg->m_buffer, // buffer containing the encoded message
-                                                             msg->m_size); // size of the encoded message  
-  e2Term->SendE2Message (pdu_cuup_ue);
-  delete pdu_cuup_ue;
+  // encodes the message, split according to the E2Termination attributes,
+  // and sends it with the next sequence numbers of the subscription
+  e2Term->SendKpmIndications (params, header, msgValues);
   
 }
 
@@ -109,7 +100,8 @@ static void KpmSubscriptionCallback (E2AP_PDU_t* sub_req_pdu)
   NS_LOG_UNCOND ("requestorId " << +params.requestorId << 
                  ", instanceId " << +params.instanceId << 
                  ", ranFuncionId " << +params.ranFuncionId << 
-                 ", actionId " << +params.actionId);  
+                 ", actionId " << +params.actionId <<
+                 ", reportingPeriod " << params.reportingPeriod);  
   
   BuildAndSendReportMessage (params);
 }
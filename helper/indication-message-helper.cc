@@ -71,6 +71,24 @@ IndicationMessageHelper::FillBaseCuCpValues (uint16_t numActiveUes)
   m_msgValues.m_pmContainerValues = m_cuCpValues;
 }
 
+size_t
+IndicationMessageHelper::GetUeSlot (const std::string &ueImsiComplete)
+{
+  return m_msgValues.m_ueKpis.GetSlot (ueImsiComplete);
+}
+
+size_t
+IndicationMessageHelper::GetCellSlot ()
+{
+  return m_msgValues.m_cellKpis.GetSlot ("");
+}
+
+void
+IndicationMessageHelper::SetSubscriptionFilter (Ptr<KpmSubscriptionFilter> filter)
+{
+  m_msgValues.m_subscription = filter;
+}
+
 IndicationMessageHelper::~IndicationMessageHelper ()
 {
 }
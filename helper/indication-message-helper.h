@@ -26,6 +26,7 @@
 #define INDICATION_MESSAGE_HELPER_H
 
 #include <ns3/kpm-indication.h>
+#include <ns3/kpi-schema.h>
 
 namespace ns3 {
 
@@ -45,6 +46,76 @@ public:
     return m_offline;
   }
 
+  /**
+  * \param ueImsiComplete the UE IMSI
+  * \return the slot of the UE in the UE KPI table, added on first use
+  */
+  size_t GetUeSlot (const std::string &ueImsiComplete);
+
+  /**
+  * \return the slot of the cell in the cell KPI table
+  */
+  size_t GetCellSlot ();
+
+  /**
+  * Restricts the KPIs of the messages to the ones subscribed by the RIC.
+  * Unsubscribed KPIs are dropped by SetKpi and are not encoded.
+  *
+  * \param filter the filter of the subscription, see
+  *        E2Termination::RicSubscriptionRequest_rval_s, or nullptr to
+  *        report every KPI
+  */
+  void SetSubscriptionFilter (Ptr<KpmSubscriptionFilter> filter);
+
+  /**
+  * Callers may check this before computing an expensive KPI
+  *
+  * \param id a KPI of KPI_SCHEMA
+  * \return true if the KPI would be stored by SetKpi
+  */
+  bool
+  IsKpiSubscribed (kpi::Id id) const
+  {
+    return (!m_reducedPmValues || KPI_SCHEMA[id].m_reduced) &&
+           (!m_msgValues.m_subscription || m_msgValues.m_subscription->IsSubscribed (id));
+  }
+
+  /**
+  * Sets a KPI of KPI_SCHEMA in the UE or cell KPI table, depending on its
+  * scope. The name, value type, scope and reduced profile membership of
+  * the KPI are compile-time constants, so KPIs that are always reported
+  * skip the m_reducedPmValues check and the column lookup is an array
+  * access. KPIs not subscribed by the RIC are dropped.
+  *
+  * \param slot the slot returned by GetUeSlot or GetCellSlot
+  * \param value the KPI value
+  */
+  template <kpi::Id Id, class T>
+  void
+  SetKpi (size_t slot, T value)
+  {
+    constexpr KpiDescriptor descriptor = KPI_SCHEMA[Id];
+    if (!descriptor.m_reduced && m_reducedPmValues)
+      {
+        return;
+      }
+    if (m_msgValues.m_subscription && !m_msgValues.m_subscription->IsSubscribed (Id))
+      {
+        return;
+      }
+    KpiTable &table =
+        descriptor.m_scope == KpiScope::UE ? m_msgValues.m_ueKpis : m_msgValues.m_cellKpis;
+    size_t column = table.GetColumn (Id, descriptor.m_name, descriptor.m_type);
+    if (descriptor.m_type == KpiTable::INTEGER)
+      {
+        table.SetInteger (slot, column, static_cast<int64_t> (value));
+      }
+    else
+      {
+        table.SetReal (slot, column, static_cast<double> (value));
+      }
+  }
+
 protected:
   void FillBaseCuUpValues (std::string plmId);
 
@@ -0,0 +1,375 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/asn1c-alloc.h>
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <string.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Asn1cAlloc");
+
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+
+namespace {
+
+struct SiteEntry
+{
+  std::string m_key; //!< "type file:line"
+  Asn1cAlloc::Counters m_counters;
+  Asn1cAlloc::Counters *m_typeCounters; //!< node of Ledger::m_types
+};
+
+/**
+* A live allocation
+*/
+struct Record
+{
+  SiteEntry *m_site;
+  size_t m_size;
+};
+
+struct Ledger
+{
+  std::mutex m_mutex;
+  std::unordered_map<void *, Record> m_live;
+  std::map<std::pair<const char *, int>, SiteEntry> m_sites; //!< keyed by __FILE__ and __LINE__
+  std::map<std::string, Asn1cAlloc::Counters> m_types;
+  Asn1cAlloc::Counters m_total;
+};
+
+/**
+* Created by Enable and never destroyed, since free may be called until the
+* very end of the process
+*/
+std::atomic<Ledger *> g_ledger (nullptr);
+
+/**
+* Set while the thread holds the ledger, whose containers allocate and free
+* through the interposed functions
+*/
+thread_local bool t_inLedger = false;
+
+/**
+* Locks the ledger and marks the thread as inside it
+*/
+class LedgerLock
+{
+public:
+  explicit LedgerLock (Ledger *ledger) : m_lock (ledger->m_mutex)
+  {
+    t_inLedger = true;
+  }
+  ~LedgerLock ()
+  {
+    t_inLedger = false;
+  }
+
+private:
+  std::lock_guard<std::mutex> m_lock;
+};
+
+void
+AddBytes (Asn1cAlloc::Counters &counters, int64_t bytes)
+{
+  counters.m_liveBytes += bytes;
+  counters.m_peakBytes = std::max (counters.m_peakBytes, counters.m_liveBytes);
+}
+
+void
+Count (Record &record, int64_t bytes, int64_t allocations, int64_t frees)
+{
+  Asn1cAlloc::Counters *counters[] = {&record.m_site->m_counters, record.m_site->m_typeCounters,
+                                      &g_ledger.load ()->m_total};
+  for (Asn1cAlloc::Counters *c : counters)
+    {
+      c->m_allocations += allocations;
+      c->m_frees += frees;
+      c->m_liveCount += allocations - frees;
+      AddBytes (*c, bytes);
+    }
+}
+
+/**
+* Forgets a freed allocation, with the ledger locked
+*/
+void
+Retire (Ledger *ledger, void *ptr)
+{
+  auto found = ledger->m_live.find (ptr);
+  if (found != ledger->m_live.end ())
+    {
+      Count (found->second, -(int64_t) found->second.m_size, 0, 1);
+      ledger->m_live.erase (found);
+    }
+}
+
+void
+Track (const Asn1cAlloc::Site &site, void *ptr, size_t size)
+{
+  Ledger *ledger = g_ledger.load (std::memory_order_acquire);
+  if (ledger == nullptr || t_inLedger)
+    {
+      return;
+    }
+  LedgerLock lock (ledger);
+  // an address freed behind the ledger's back and handed out again
+  Retire (ledger, ptr);
+
+  auto inserted = ledger->m_sites.emplace (std::make_pair (site.m_file, site.m_line), SiteEntry ());
+  SiteEntry &entry = inserted.first->second;
+  if (inserted.second)
+    {
+      const char *file = strrchr (site.m_file, '/');
+      entry.m_key = std::string (site.m_type) + " " + (file ? file + 1 : site.m_file) + ":" +
+                    std::to_string (site.m_line);
+      entry.m_counters = Asn1cAlloc::Counters ();
+      entry.m_typeCounters = &ledger->m_types[site.m_type];
+    }
+  Record record = {&entry, size};
+  Count (record, size, 1, 0);
+  ledger->m_live[ptr] = record;
+}
+
+void
+Retire (void *ptr)
+{
+  Ledger *ledger = g_ledger.load (std::memory_order_acquire);
+  if (ptr == nullptr || ledger == nullptr || t_inLedger)
+    {
+      return;
+    }
+  LedgerLock lock (ledger);
+  Retire (ledger, ptr);
+}
+
+/**
+* Follows a tracked allocation moved by realloc
+*/
+void
+Move (void *from, void *to, size_t size)
+{
+  Ledger *ledger = g_ledger.load (std::memory_order_acquire);
+  if (ledger == nullptr || t_inLedger)
+    {
+      return;
+    }
+  LedgerLock lock (ledger);
+  auto found = ledger->m_live.find (from);
+  if (found == ledger->m_live.end ())
+    {
+      return;
+    }
+  Record record = found->second;
+  ledger->m_live.erase (found);
+  if (to == nullptr)
+    {
+      Count (record, -(int64_t) record.m_size, 0, 1);
+      return;
+    }
+  Count (record, (int64_t) size - (int64_t) record.m_size, 0, 0);
+  record.m_size = size;
+  ledger->m_live[to] = record;
+}
+
+} // namespace
+
+#endif /* NS3_ORAN_ALLOC_ACCOUNTING */
+
+bool
+Asn1cAlloc::IsAvailable ()
+{
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+Asn1cAlloc::Enable ()
+{
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+  if (g_ledger.load () == nullptr)
+    {
+      Ledger *ledger = new Ledger ();
+      ledger->m_total = Counters ();
+      Ledger *expected = nullptr;
+      if (!g_ledger.compare_exchange_strong (expected, ledger))
+        {
+          delete ledger;
+        }
+    }
+#else
+  NS_LOG_WARN ("Allocation accounting not built, see --enable-oran-alloc-accounting");
+#endif
+}
+
+bool
+Asn1cAlloc::IsEnabled ()
+{
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+  return g_ledger.load () != nullptr;
+#else
+  return false;
+#endif
+}
+
+void *
+Asn1cAlloc::Calloc (const Site &site, size_t count, size_t size)
+{
+  void *ptr = calloc (count, size);
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+  if (ptr != nullptr)
+    {
+      Track (site, ptr, count * size);
+    }
+#endif
+  return ptr;
+}
+
+void
+Asn1cAlloc::Free (void *ptr)
+{
+#if defined(NS3_ORAN_ALLOC_ACCOUNTING) && !defined(__GLIBC__)
+  Retire (ptr);
+#endif
+  free (ptr);
+}
+
+std::map<std::string, Asn1cAlloc::Counters>
+Asn1cAlloc::GetSiteCounters ()
+{
+  std::map<std::string, Counters> sites;
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+  Ledger *ledger = g_ledger.load ();
+  if (ledger != nullptr)
+    {
+      LedgerLock lock (ledger);
+      for (const auto &site : ledger->m_sites)
+        {
+          sites[site.second.m_key] = site.second.m_counters;
+        }
+    }
+#endif
+  return sites;
+}
+
+std::map<std::string, Asn1cAlloc::Counters>
+Asn1cAlloc::GetTypeCounters ()
+{
+  std::map<std::string, Counters> types;
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+  Ledger *ledger = g_ledger.load ();
+  if (ledger != nullptr)
+    {
+      LedgerLock lock (ledger);
+      types = ledger->m_types;
+    }
+#endif
+  return types;
+}
+
+Asn1cAlloc::Counters
+Asn1cAlloc::GetTotal ()
+{
+  Counters total = Counters ();
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+  Ledger *ledger = g_ledger.load ();
+  if (ledger != nullptr)
+    {
+      LedgerLock lock (ledger);
+      total = ledger->m_total;
+    }
+#endif
+  return total;
+}
+
+static void
+PrintCounters (std::ostream &os, const std::map<std::string, Asn1cAlloc::Counters> &counters)
+{
+  std::vector<std::pair<std::string, Asn1cAlloc::Counters>> sorted (counters.begin (),
+                                                                     counters.end ());
+  std::sort (sorted.begin (), sorted.end (), [] (const std::pair<std::string, Asn1cAlloc::Counters> &a,
+                                                  const std::pair<std::string, Asn1cAlloc::Counters> &b) {
+    return a.second.m_liveBytes > b.second.m_liveBytes;
+  });
+  for (const auto &entry : sorted)
+    {
+      const Asn1cAlloc::Counters &c = entry.second;
+      os << "  " << entry.first << ": " << c.m_liveBytes << " live bytes in " << c.m_liveCount
+         << " blocks, peak " << c.m_peakBytes << " bytes, " << c.m_allocations
+         << " allocations, " << c.m_frees << " frees" << std::endl;
+    }
+}
+
+void
+Asn1cAlloc::Print (std::ostream &os)
+{
+  if (!IsEnabled ())
+    {
+      os << "asn1c allocation accounting disabled" << std::endl;
+      return;
+    }
+  Counters total = GetTotal ();
+  os << "asn1c allocations: " << total.m_liveBytes << " live bytes in " << total.m_liveCount
+     << " blocks, peak " << total.m_peakBytes << " bytes, " << total.m_allocations
+     << " allocations, " << total.m_frees << " frees" << std::endl;
+  os << "by message type:" << std::endl;
+  PrintCounters (os, GetTypeCounters ());
+  os << "by call site:" << std::endl;
+  PrintCounters (os, GetSiteCounters ());
+}
+
+} // namespace ns3
+
+#if defined(NS3_ORAN_ALLOC_ACCOUNTING) && defined(__GLIBC__)
+extern "C" {
+void __libc_free (void *ptr);
+void *__libc_realloc (void *ptr, size_t size);
+
+// asn1c frees and grows the tracked structures with the plain allocator
+void
+free (void *ptr) __THROW
+{
+  ns3::Retire (ptr);
+  __libc_free (ptr);
+}
+
+void *
+realloc (void *ptr, size_t size) __THROW
+{
+  void *result = __libc_realloc (ptr, size);
+  if (ptr != nullptr && (result != nullptr || size == 0))
+    {
+      ns3::Move (ptr, result, size);
+    }
+  return result;
+}
+}
+#endif
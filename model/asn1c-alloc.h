@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ASN1C_ALLOC_H
+#define ASN1C_ALLOC_H
+
+#include <map>
+#include <ostream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+namespace ns3 {
+
+/**
+* Opt-in accounting of the heap memory behind the asn1c structures built
+* by the wrapper classes and the E2SM encoders, to find which message type
+* keeps memory alive in long simulations.
+*
+* The allocations go through ASN1C_CALLOC and ASN1C_FREE, tagged with a
+* message type and their call site. Accounting is compiled in with
+* ./waf configure --enable-oran-alloc-accounting, which defines
+* NS3_ORAN_ALLOC_ACCOUNTING, and started with Enable; otherwise the macros
+* are plain calloc and free. Since the asn1c runtime frees and reallocates
+* these structures itself, in ASN_STRUCT_FREE and ASN_SEQUENCE_ADD, the
+* accounting build also interposes free and realloc on glibc, which makes
+* every free of the process take a lock once enabled, and which cannot
+* be combined with the sanitizers, as they replace the allocator too.
+*/
+class Asn1cAlloc
+{
+public:
+  /**
+  * Where an allocation is made
+  */
+  struct Site
+  {
+    const char *m_type; //!< message type, for instance "KpmIndicationHeader"
+    const char *m_file;
+    int m_line;
+  };
+
+  /**
+  * Counters of a call site, a message type or the whole process
+  */
+  struct Counters
+  {
+    uint64_t m_allocations;
+    uint64_t m_frees;
+    uint64_t m_liveCount; //!< allocations not freed yet
+    uint64_t m_liveBytes;
+    uint64_t m_peakBytes; //!< high-water mark of m_liveBytes
+  };
+
+  /**
+  * \return true if the module was built with the accounting
+  */
+  static bool IsAvailable ();
+
+  /**
+  * Starts the accounting of the allocations made from now on. Does
+  * nothing, with a warning, if the accounting is not available.
+  */
+  static void Enable ();
+
+  static bool IsEnabled ();
+
+  static void *Calloc (const Site &site, size_t count, size_t size);
+  static void Free (void *ptr);
+
+  /**
+  * \return the counters of each call site, keyed by "type file:line"
+  */
+  static std::map<std::string, Counters> GetSiteCounters ();
+
+  /**
+  * \return the counters of each message type
+  */
+  static std::map<std::string, Counters> GetTypeCounters ();
+
+  static Counters GetTotal ();
+
+  /**
+  * Prints the totals, then the message types and call sites holding live
+  * memory, largest first
+  */
+  static void Print (std::ostream &os);
+};
+
+} // namespace ns3
+
+#ifdef NS3_ORAN_ALLOC_ACCOUNTING
+#define ASN1C_CALLOC(type, count, size)                                                          \
+  ns3::Asn1cAlloc::Calloc (ns3::Asn1cAlloc::Site{type, __FILE__, __LINE__}, count, size)
+#define ASN1C_FREE(ptr) ns3::Asn1cAlloc::Free (ptr)
+#else
+#define ASN1C_CALLOC(type, count, size) calloc (count, size)
+#define ASN1C_FREE(ptr) free (ptr)
+#endif
+
+#endif /* ASN1C_ALLOC_H */
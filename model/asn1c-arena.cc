@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/asn1c-arena.h>
+#include <ns3/log.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Asn1Arena");
+
+Asn1Arena::Asn1Arena (size_t chunkSize)
+    : m_chunkSize (chunkSize), m_offset (0), m_used (0)
+{
+  NS_ABORT_MSG_IF (chunkSize == 0, "Arena chunk size must be positive");
+}
+
+Asn1Arena::~Asn1Arena ()
+{
+  for (auto &chunk : m_chunks)
+    {
+      free (chunk.m_data);
+    }
+}
+
+void
+Asn1Arena::AddChunk (size_t minSize)
+{
+  size_t size = minSize > m_chunkSize ? minSize : m_chunkSize;
+  uint8_t *data = (uint8_t *) malloc (size);
+  NS_ABORT_MSG_IF (data == nullptr, "Memory exhausted while growing the ASN.1 arena");
+  m_chunks.push_back ({data, size});
+  m_offset = 0;
+  NS_LOG_LOGIC ("New arena chunk of " << size << " bytes, " << m_chunks.size () << " chunks");
+}
+
+void *
+Asn1Arena::Allocate (size_t size, size_t align)
+{
+  NS_ASSERT_MSG (align != 0 && (align & (align - 1)) == 0, "Alignment must be a power of two");
+  if (size == 0)
+    {
+      size = 1;
+    }
+
+  size_t start = (m_offset + align - 1) & ~(align - 1);
+  if (m_chunks.empty () || start + size > m_chunks.back ().m_size)
+    {
+      // malloc alignment covers max_align_t, larger requests get padding
+      AddChunk (size + (align > alignof (std::max_align_t) ? align : 0));
+      start = ((uintptr_t) m_chunks.back ().m_data + align - 1) & ~(uintptr_t) (align - 1);
+      start -= (uintptr_t) m_chunks.back ().m_data;
+    }
+
+  uint8_t *ptr = m_chunks.back ().m_data + start;
+  memset (ptr, 0, size);
+  m_offset = start + size;
+  m_used += size;
+  return ptr;
+}
+
+uint8_t *
+Asn1Arena::CopyBytes (const void *src, size_t size)
+{
+  uint8_t *dst = NewArray<uint8_t> (size);
+  memcpy (dst, src, size);
+  return dst;
+}
+
+void
+Asn1Arena::Reset ()
+{
+  // a single chunk of the total size serves again what the chunks did, so
+  // that only messages larger than every previous one hit malloc
+  if (m_chunks.size () > 1)
+    {
+      size_t total = 0;
+      for (auto &chunk : m_chunks)
+        {
+          total += chunk.m_size;
+          free (chunk.m_data);
+        }
+      m_chunks.clear ();
+      AddChunk (total);
+    }
+  m_offset = 0;
+  m_used = 0;
+}
+
+size_t
+Asn1Arena::GetUsedBytes () const
+{
+  return m_used;
+}
+
+size_t
+Asn1Arena::GetChunkCount () const
+{
+  return m_chunks.size ();
+}
+
+} // namespace ns3
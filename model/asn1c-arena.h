@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ASN1C_ARENA_H
+#define ASN1C_ARENA_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+
+namespace ns3 {
+
+/**
+* Bump allocator used to build a whole ASN.1 tree for a single message.
+*
+* Every allocation is zero-initialized, as the asn1c structures expect
+* (equivalent to calloc), and nothing is released individually: the whole
+* tree goes away when the arena is reset or destroyed. Trees built here
+* must therefore never be passed to ASN_STRUCT_FREE, nor grown with
+* ASN_SEQUENCE_ADD past the capacity reserved with ReserveList, since the
+* asn1c runtime would try to realloc/free arena memory.
+*/
+class Asn1Arena
+{
+public:
+  static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+  Asn1Arena (size_t chunkSize = DEFAULT_CHUNK_SIZE);
+  ~Asn1Arena ();
+
+  Asn1Arena (const Asn1Arena &) = delete;
+  Asn1Arena &operator= (const Asn1Arena &) = delete;
+
+  /**
+  * Returns size zeroed bytes aligned to align (a power of two)
+  */
+  void *Allocate (size_t size, size_t align = alignof (std::max_align_t));
+
+  /**
+  * Returns a zeroed object of type T
+  */
+  template <class T>
+  T *
+  New ()
+  {
+    return static_cast<T *> (Allocate (sizeof (T), alignof (T)));
+  }
+
+  /**
+  * Returns a zeroed array of count objects of type T
+  */
+  template <class T>
+  T *
+  NewArray (size_t count)
+  {
+    return static_cast<T *> (Allocate (sizeof (T) * count, alignof (T)));
+  }
+
+  /**
+  * Copies size bytes from src into the arena
+  */
+  uint8_t *CopyBytes (const void *src, size_t size);
+
+  /**
+  * Pre-sizes an asn1c A_SEQUENCE_OF list with count slots taken from the
+  * arena, so that the following count ASN_SEQUENCE_ADD calls never realloc
+  */
+  template <class List>
+  void
+  ReserveList (List *list, size_t count)
+  {
+    typedef typename std::remove_pointer<decltype (list->array)>::type Element;
+    list->array = count > 0 ? NewArray<Element> (count) : nullptr;
+    list->size = static_cast<int> (count);
+    list->count = 0;
+  }
+
+  /**
+  * Releases every allocation at once. If the arena grew past one chunk,
+  * the chunks are replaced by a single one of their total size, so that
+  * the next message of the same size is served without malloc.
+  */
+  void Reset ();
+
+  /**
+  * \return the number of bytes handed out since the last reset
+  */
+  size_t GetUsedBytes () const;
+
+  /**
+  * \return the number of chunks currently owned by the arena
+  */
+  size_t GetChunkCount () const;
+
+private:
+  struct Chunk
+  {
+    uint8_t *m_data;
+    size_t m_size;
+  };
+
+  void AddChunk (size_t minSize);
+
+  size_t m_chunkSize; //!< default size of a new chunk
+  std::vector<Chunk> m_chunks; //!< owned chunks, the last one is the active one
+  size_t m_offset; //!< first free byte in the active chunk
+  size_t m_used; //!< bytes handed out since the last reset
+};
+
+} // namespace ns3
+
+#endif /* ASN1C_ARENA_H */
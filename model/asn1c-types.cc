@@ -27,6 +27,8 @@
  */
 
 #include <ns3/asn1c-types.h>
+#include <ns3/asn1c-alloc.h>
+#include <ns3/measurement-name-registry.h>
 #include <ns3/log.h>
 
 NS_LOG_COMPONENT_DEFINE ("Asn1Types");
@@ -43,8 +45,8 @@ OctetString::OctetString (std::string value, size_t size)
 void OctetString::CreateBaseOctetString (size_t size)
 {
   NS_LOG_FUNCTION (this);
-  m_octetString = (OCTET_STRING_t *) calloc (1, sizeof (OCTET_STRING_t));
-  m_octetString->buf = (uint8_t *) calloc (1, size);
+  m_octetString = (OCTET_STRING_t *) ASN1C_CALLOC ("OctetString", 1, sizeof (OCTET_STRING_t));
+  m_octetString->buf = (uint8_t *) ASN1C_CALLOC ("OctetString", 1, size);
   m_octetString->size = size;
 }
 
@@ -60,7 +62,7 @@ OctetString::~OctetString ()
   NS_LOG_FUNCTION (this);
   // if (m_octetString->buf != NULL)
     // free (m_octetString->buf);
-  free (m_octetString);
+  ASN1C_FREE (m_octetString);
 }
 
 OCTET_STRING_t *
@@ -88,8 +90,8 @@ BitString::BitString (std::string value, size_t size)
 
 {
   NS_LOG_FUNCTION (this);
-  m_bitString = (BIT_STRING_t *) calloc (1, sizeof (BIT_STRING_t));
-  m_bitString->buf = (uint8_t *) calloc (1, size);
+  m_bitString = (BIT_STRING_t *) ASN1C_CALLOC ("BitString", 1, sizeof (BIT_STRING_t));
+  m_bitString->buf = (uint8_t *) ASN1C_CALLOC ("BitString", 1, size);
   m_bitString->size = size;
   memcpy (m_bitString->buf, value.c_str(), size);
 }
@@ -104,7 +106,7 @@ BitString::BitString (std::string value, size_t size, size_t bits_unused)
 BitString::~BitString ()
 {
   NS_LOG_FUNCTION (this);
-  free (m_bitString);
+  ASN1C_FREE (m_bitString);
 }
 
 BIT_STRING_t *
@@ -155,17 +157,17 @@ NrCellId::GetPointer ()
 
 Snssai::Snssai (std::string sst)
 {
-  m_sNssai = (SNSSAI_t *) calloc (1, sizeof (SNSSAI_t));
-  m_sst = (OCTET_STRING_t *) calloc (1, sizeof (OCTET_STRING_t));
-  m_sst->buf = (uint8_t *) calloc (1, sst.size ());
+  m_sNssai = (SNSSAI_t *) ASN1C_CALLOC ("Snssai", 1, sizeof (SNSSAI_t));
+  m_sst = (OCTET_STRING_t *) ASN1C_CALLOC ("Snssai", 1, sizeof (OCTET_STRING_t));
+  m_sst->buf = (uint8_t *) ASN1C_CALLOC ("Snssai", 1, sst.size ());
   m_sst->size = sst.size ();
   memcpy (m_sst->buf, sst.c_str (), sst.size ());
   m_sNssai->sST = *m_sst;
 }
 Snssai::Snssai (std::string sst, std::string sd) : Snssai (sst)
 {
-  m_sd = (OCTET_STRING_t *) calloc (1, sizeof (OCTET_STRING_t));
-  m_sd->buf = (uint8_t *) calloc (1, sst.size ());
+  m_sd = (OCTET_STRING_t *) ASN1C_CALLOC ("Snssai", 1, sizeof (OCTET_STRING_t));
+  m_sd->buf = (uint8_t *) ASN1C_CALLOC ("Snssai", 1, sst.size ());
   m_sd->size = sd.size ();
   memcpy (m_sd->buf, sd.c_str (), sd.size ());
   m_sNssai->sD = m_sd;
@@ -198,27 +200,32 @@ void
 MeasQuantityResultsWrap::AddRsrp (long rsrp)
 {
 
-  m_measQuantityResults->rsrp = (RSRP_Range_t *) calloc (1, sizeof (RSRP_Range_t));
+  m_measQuantityResults->rsrp =
+      (RSRP_Range_t *) ASN1C_CALLOC ("MeasQuantityResultsWrap", 1, sizeof (RSRP_Range_t));
   *m_measQuantityResults->rsrp = rsrp;
 }
 
 void
 MeasQuantityResultsWrap::AddRsrq (long rsrq)
 {
-  m_measQuantityResults->rsrq = (RSRQ_Range_t *) calloc (1, sizeof (RSRQ_Range_t));
+  m_measQuantityResults->rsrq =
+      (RSRQ_Range_t *) ASN1C_CALLOC ("MeasQuantityResultsWrap", 1, sizeof (RSRQ_Range_t));
   *m_measQuantityResults->rsrq = rsrq;
 }
 
 void
 MeasQuantityResultsWrap::AddSinr (long sinr)
 {
-  m_measQuantityResults->sinr = (SINR_Range_t *) calloc (1, sizeof (SINR_Range_t));
+  m_measQuantityResults->sinr =
+      (SINR_Range_t *) ASN1C_CALLOC ("MeasQuantityResultsWrap", 1, sizeof (SINR_Range_t));
   *m_measQuantityResults->sinr = sinr;
 }
 
 MeasQuantityResultsWrap::MeasQuantityResultsWrap ()
 {
-  m_measQuantityResults = (MeasQuantityResults_t *) calloc (1, sizeof (MeasQuantityResults_t));
+  m_measQuantityResults =
+      (MeasQuantityResults_t *) ASN1C_CALLOC ("MeasQuantityResultsWrap",
+                                              1, sizeof (MeasQuantityResults_t));
 }
 
 MeasQuantityResultsWrap::~MeasQuantityResultsWrap ()
@@ -258,7 +265,8 @@ ResultsPerCsiRsIndex::ResultsPerCsiRsIndex (long csiRsIndex, MeasQuantityResults
 ResultsPerCsiRsIndex::ResultsPerCsiRsIndex (long csiRsIndex)
 {
   m_resultsPerCsiRsIndex =
-      (ResultsPerCSI_RS_Index_t *) calloc (1, sizeof (ResultsPerCSI_RS_Index_t));
+      (ResultsPerCSI_RS_Index_t *) ASN1C_CALLOC ("ResultsPerCsiRsIndex",
+                                                 1, sizeof (ResultsPerCSI_RS_Index_t));
   m_resultsPerCsiRsIndex->csi_RS_Index = csiRsIndex;
 }
 
@@ -282,7 +290,9 @@ ResultsPerSSBIndex::ResultsPerSSBIndex (long ssbIndex, MeasQuantityResults_t *ss
 
 ResultsPerSSBIndex::ResultsPerSSBIndex (long ssbIndex)
 {
-  m_resultsPerSSBIndex = (ResultsPerSSB_Index_t *) calloc (1, sizeof (ResultsPerSSB_Index_t));
+  m_resultsPerSSBIndex =
+      (ResultsPerSSB_Index_t *) ASN1C_CALLOC ("ResultsPerSSBIndex",
+                                              1, sizeof (ResultsPerSSB_Index_t));
   m_resultsPerSSBIndex->ssb_Index = ssbIndex;
 }
 
@@ -335,7 +345,8 @@ MeasResultNr::AddPerCsiRsIndexResults (ResultsPerCSI_RS_Index_t *resultsCSI_RS_I
 
 void MeasResultNr::AddPhyCellId (long physCellId)
 {
-  PhysCellId_t *s_physCellId = (PhysCellId_t *) calloc (1, sizeof (PhysCellId_t));
+  PhysCellId_t *s_physCellId =
+      (PhysCellId_t *) ASN1C_CALLOC ("MeasResultNr", 1, sizeof (PhysCellId_t));
   *s_physCellId = physCellId;
   m_measResultNr->physCellId = s_physCellId;
 }
@@ -347,7 +358,7 @@ MeasResultNr::MeasResultNr (long physCellId) : MeasResultNr ()
 
 MeasResultNr::MeasResultNr ()
 {
-  m_measResultNr = (MeasResultNR_t *) calloc (1, sizeof (MeasResultNR_t));
+  m_measResultNr = (MeasResultNR_t *) ASN1C_CALLOC ("MeasResultNr", 1, sizeof (MeasResultNR_t));
   m_shouldFree = false;
 }
 
@@ -355,7 +366,7 @@ MeasResultNr::~MeasResultNr ()
 {
   if (m_shouldFree)
     {
-      free (m_measResultNr);
+      ASN1C_FREE (m_measResultNr);
     }
 }
 
@@ -384,7 +395,8 @@ MeasResultEutra::MeasResultEutra (long eutraPhysCellId, long rsrp, long rsrq, lo
 
 MeasResultEutra::MeasResultEutra (long eutraPhysCellId)
 {
-  m_measResultEutra = (MeasResultEUTRA_t *) calloc (1, sizeof (MeasResultEUTRA_t));
+  m_measResultEutra =
+      (MeasResultEUTRA_t *) ASN1C_CALLOC ("MeasResultEutra", 1, sizeof (MeasResultEUTRA_t));
   m_measResultEutra->eutra_PhysCellId = eutraPhysCellId;
 }
 
@@ -392,21 +404,21 @@ void
 MeasResultEutra::AddRsrp (long rsrp)
 {
   m_measResultEutra->measResult.rsrp =
-      (RSRP_RangeEUTRA_t *) calloc (1, sizeof (RSRP_RangeEUTRA_t));
+      (RSRP_RangeEUTRA_t *) ASN1C_CALLOC ("MeasResultEutra", 1, sizeof (RSRP_RangeEUTRA_t));
   *m_measResultEutra->measResult.rsrp = rsrp;
 }
 void
 MeasResultEutra::AddRsrq (long rsrq)
 {
   m_measResultEutra->measResult.rsrq =
-      (RSRQ_RangeEUTRA_t *) calloc (1, sizeof (RSRQ_RangeEUTRA_t));
+      (RSRQ_RangeEUTRA_t *) ASN1C_CALLOC ("MeasResultEutra", 1, sizeof (RSRQ_RangeEUTRA_t));
   *m_measResultEutra->measResult.rsrq = rsrq;
 }
 void
 MeasResultEutra::AddSinr (long sinr)
 {
   m_measResultEutra->measResult.sinr =
-      (SINR_RangeEUTRA_t *) calloc (1, sizeof (SINR_RangeEUTRA_t));
+      (SINR_RangeEUTRA_t *) ASN1C_CALLOC ("MeasResultEutra", 1, sizeof (SINR_RangeEUTRA_t));
   *m_measResultEutra->measResult.sinr = sinr;
 }
 
@@ -431,7 +443,8 @@ MeasResultPCellWrap::MeasResultPCellWrap (long eutraPhysCellId, long rsrpResult,
 
 MeasResultPCellWrap::MeasResultPCellWrap (long eutraPhysCellId)
 {
-  m_measResultPCell = (MeasResultPCell_t *) calloc (1, sizeof (MeasResultPCell_t));
+  m_measResultPCell =
+      (MeasResultPCell_t *) ASN1C_CALLOC ("MeasResultPCellWrap", 1, sizeof (MeasResultPCell_t));
   m_measResultPCell->eutra_PhysCellId = eutraPhysCellId;
 }
 
@@ -468,7 +481,8 @@ MeasResultServMo::MeasResultServMo (long servCellId, MeasResultNR_t measResultSe
 
 MeasResultServMo::MeasResultServMo (long servCellId, MeasResultNR_t measResultServingCell)
 {
-  m_measResultServMo = (MeasResultServMO_t *) calloc (1, sizeof (MeasResultServMO_t));
+  m_measResultServMo =
+      (MeasResultServMO_t *) ASN1C_CALLOC ("MeasResultServMo", 1, sizeof (MeasResultServMO_t));
   m_measResultServMo->servCellId = servCellId;
   m_measResultServMo->measResultServingCell = measResultServingCell;
 }
@@ -509,13 +523,15 @@ ServingCellMeasurementsWrap::AddMeasResultServMo (MeasResultServMO_t *measResult
 ServingCellMeasurementsWrap::ServingCellMeasurementsWrap (ServingCellMeasurements_PR present)
 {
   m_servingCellMeasurements =
-      (ServingCellMeasurements_t *) calloc (1, sizeof (ServingCellMeasurements_t));
+      (ServingCellMeasurements_t *) ASN1C_CALLOC ("ServingCellMeasurementsWrap",
+                                                  1, sizeof (ServingCellMeasurements_t));
   m_servingCellMeasurements->present = present;
 
   if (m_servingCellMeasurements->present == ServingCellMeasurements_PR_nr_measResultServingMOList)
     {
       m_nr_measResultServingMOList =
-          (MeasResultServMOList_t *) calloc (1, sizeof (MeasResultServMOList_t));
+          (MeasResultServMOList_t *) ASN1C_CALLOC ("ServingCellMeasurementsWrap",
+                                                   1, sizeof (MeasResultServMOList_t));
       m_servingCellMeasurements->choice.nr_measResultServingMOList = m_nr_measResultServingMOList;
     }
 }
@@ -633,21 +649,25 @@ void
 L3RrcMeasurements::addMeasResultNeighCells (MeasResultNeighCells_PR present)
 {
   m_l3RrcMeasurements->measResultNeighCells =
-      (MeasResultNeighCells_t *) calloc (1, sizeof (MeasResultNeighCells_t));
+      (MeasResultNeighCells_t *) ASN1C_CALLOC ("L3RrcMeasurements",
+                                               1, sizeof (MeasResultNeighCells_t));
   m_l3RrcMeasurements->measResultNeighCells->present = present;
 
   switch (present)
     {
       case MeasResultNeighCells_PR_measResultListEUTRA: {
         m_measResultListEUTRA =
-            (MeasResultListEUTRA_t *) calloc (1, sizeof (MeasResultListEUTRA_t));
+            (MeasResultListEUTRA_t *) ASN1C_CALLOC ("L3RrcMeasurements",
+                                                    1, sizeof (MeasResultListEUTRA_t));
         m_l3RrcMeasurements->measResultNeighCells->choice.measResultListEUTRA =
             m_measResultListEUTRA;
         break;
       }
 
       case MeasResultNeighCells_PR_measResultListNR: {
-        m_measResultListNR = (MeasResultListNR_t *) calloc (1, sizeof (MeasResultListNR_t));
+        m_measResultListNR =
+            (MeasResultListNR_t *) ASN1C_CALLOC ("L3RrcMeasurements",
+                                                 1, sizeof (MeasResultListNR_t));
         m_l3RrcMeasurements->measResultNeighCells->choice.measResultListNR = m_measResultListNR;
         break;
       }
@@ -661,7 +681,9 @@ L3RrcMeasurements::addMeasResultNeighCells (MeasResultNeighCells_PR present)
 
 L3RrcMeasurements::L3RrcMeasurements (RRCEvent_t rrcEvent)
 {
-  m_l3RrcMeasurements = (L3_RRC_Measurements_t *) calloc (1, sizeof (L3_RRC_Measurements_t));
+  m_l3RrcMeasurements =
+      (L3_RRC_Measurements_t *) ASN1C_CALLOC ("L3RrcMeasurements",
+                                              1, sizeof (L3_RRC_Measurements_t));
   m_l3RrcMeasurements->rrcEvent = rrcEvent;
   m_measItemsCounter = 0;
 }
@@ -803,17 +825,13 @@ L3RrcMeasurements::ThreeGppMapSinr (double sinr)
 MeasurementItem::MeasurementItem (std::string name)
 {
 
-  m_measurementItem = (PM_Info_Item_t *) calloc (1, sizeof (PM_Info_Item_t));
-  m_pmType = (MeasurementType_t *) calloc (1, sizeof (MeasurementType_t));
+  m_measurementItem =
+      (PM_Info_Item_t *) ASN1C_CALLOC ("MeasurementItem", 1, sizeof (PM_Info_Item_t));
+  m_pmType = (MeasurementType_t *) ASN1C_CALLOC ("MeasurementItem", 1, sizeof (MeasurementType_t));
   m_measurementItem->pmType = *m_pmType;
 
-  m_measName =
-      (MeasurementTypeName_t *) calloc (1, sizeof (MeasurementTypeName_t));
-  m_measName->buf = (uint8_t *) calloc (1, sizeof (OCTET_STRING));
-  m_measName->size = name.length ();
-  memcpy (m_measName->buf, name.c_str (), m_measName->size);
-
-  m_measurementItem->pmType.choice.measName = *m_measName;
+  // the interned name is shared, it must not be freed with the item
+  m_measurementItem->pmType.choice.measName = MeasurementNameRegistry::Intern (name);
   m_measurementItem->pmType.present = MeasurementType_PR_measName;
 }
 
@@ -842,7 +860,8 @@ MeasurementItem::MeasurementItem (std::string name, Ptr<L3RrcMeasurements>value)
 void
 MeasurementItem::CreateMeasurementValue (MeasurementValue_PR measurementValue_PR)
 {
-  m_pmVal = ((MeasurementValue_t *) calloc (1, sizeof (MeasurementValue_t)));
+  m_pmVal =
+      ((MeasurementValue_t *) ASN1C_CALLOC ("MeasurementItem", 1, sizeof (MeasurementValue_t)));
   m_measurementItem->pmVal = *m_pmVal;
   m_measurementItem->pmVal.present = measurementValue_PR;
 }
@@ -853,11 +872,6 @@ MeasurementItem::~MeasurementItem ()
   if (m_pmVal != NULL)
     ASN_STRUCT_FREE (asn_DEF_MeasurementValue, m_pmVal);
 
-  if (m_measName != NULL)
-    {
-      free (m_measName);
-    }
-
   if (m_pmType != NULL)
     ASN_STRUCT_FREE (asn_DEF_MeasurementType, m_pmType);
 }
@@ -331,7 +331,6 @@ private:
   PM_Info_Item_t *m_measurementItem;
 
   // Accessory structs that we must track to release memory after use
-  MeasurementTypeName_t *m_measName;
   MeasurementValue_t *m_pmVal;
   MeasurementType_t *m_pmType;
 };
@@ -0,0 +1,189 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/e2-io-reactor.h>
+#include <ns3/log.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("E2IoReactor");
+
+static std::atomic<uint32_t> g_reactorThreads (2);
+
+E2IoReactor *
+E2IoReactor::Get ()
+{
+  // destroyed at exit, which stops the threads
+  static E2IoReactor reactor (g_reactorThreads);
+  return &reactor;
+}
+
+void
+E2IoReactor::SetThreadCount (uint32_t threads)
+{
+  g_reactorThreads = threads > 0 ? threads : 1;
+}
+
+E2IoReactor::E2IoReactor (uint32_t threads)
+{
+  m_epoll = epoll_create1 (EPOLL_CLOEXEC);
+  NS_ABORT_MSG_IF (m_epoll < 0, "epoll_create1 failed: " << strerror (errno));
+  m_wakeFd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  NS_ABORT_MSG_IF (m_wakeFd < 0, "eventfd failed: " << strerror (errno));
+
+  // level-triggered, so that a single write wakes every thread up
+  struct epoll_event event;
+  memset (&event, 0, sizeof (event));
+  event.events = EPOLLIN;
+  event.data.fd = m_wakeFd;
+  epoll_ctl (m_epoll, EPOLL_CTL_ADD, m_wakeFd, &event);
+
+  NS_LOG_INFO ("Starting the E2 I/O reactor on " << threads << " threads");
+  for (uint32_t i = 0; i < threads; ++i)
+    {
+      m_threads.emplace_back (&E2IoReactor::Run, this);
+    }
+}
+
+E2IoReactor::~E2IoReactor ()
+{
+  uint64_t one = 1;
+  if (write (m_wakeFd, &one, sizeof (one)) < 0)
+    {
+      NS_LOG_ERROR ("Cannot wake the reactor threads up");
+    }
+  for (auto &thread : m_threads)
+    {
+      thread.join ();
+    }
+  close (m_wakeFd);
+  close (m_epoll);
+}
+
+void
+E2IoReactor::Add (int fd, Handler handler)
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_handlers[fd] = std::make_shared<Handler> (handler);
+  }
+
+  struct epoll_event event;
+  memset (&event, 0, sizeof (event));
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.fd = fd;
+  if (epoll_ctl (m_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+      NS_FATAL_ERROR ("Cannot watch descriptor " << fd << ": " << strerror (errno));
+    }
+}
+
+void
+E2IoReactor::Remove (int fd)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  if (m_handlers.erase (fd) > 0)
+    {
+      epoll_ctl (m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    }
+  // a handler removing its own descriptor is not waited for
+  std::thread::id self = std::this_thread::get_id ();
+  m_idle.wait (lock, [this, fd, self] {
+    auto it = m_running.find (fd);
+    return it == m_running.end () || it->second == self;
+  });
+}
+
+uint32_t
+E2IoReactor::GetThreadCount () const
+{
+  return m_threads.size ();
+}
+
+size_t
+E2IoReactor::GetSize () const
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_handlers.size ();
+}
+
+void
+E2IoReactor::Run ()
+{
+  const int maxEvents = 16;
+  struct epoll_event events[maxEvents];
+  while (true)
+    {
+      int count = epoll_wait (m_epoll, events, maxEvents, -1);
+      if (count < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_LOG_ERROR ("epoll_wait failed: " << strerror (errno));
+          return;
+        }
+
+      for (int i = 0; i < count; ++i)
+        {
+          int fd = events[i].data.fd;
+          if (fd == m_wakeFd)
+            {
+              return;
+            }
+
+          std::shared_ptr<Handler> handler;
+          {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            auto it = m_handlers.find (fd);
+            if (it == m_handlers.end ())
+              {
+                continue;
+              }
+            handler = it->second;
+            m_running[fd] = std::this_thread::get_id ();
+          }
+          (*handler) ();
+
+          // re-armed only if still registered, Remove holds the lock
+          std::lock_guard<std::mutex> lock (m_mutex);
+          m_running.erase (fd);
+          m_idle.notify_all ();
+          auto it = m_handlers.find (fd);
+          if (it != m_handlers.end () && it->second == handler)
+            {
+              struct epoll_event event;
+              memset (&event, 0, sizeof (event));
+              event.events = EPOLLIN | EPOLLONESHOT;
+              event.data.fd = fd;
+              epoll_ctl (m_epoll, EPOLL_CTL_MOD, fd, &event);
+            }
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef E2_IO_REACTOR_H
+#define E2_IO_REACTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+* Process-wide epoll loop serving the E2 associations of every
+* E2Termination over a small fixed pool of threads, instead of one thread
+* blocking on each socket.
+*
+* A registered descriptor is armed one-shot, so its handler never runs on
+* two threads at once, and is re-armed when the handler returns. Handlers
+* must not block: sockets are expected to be non-blocking, and handlers
+* should read until EAGAIN.
+*/
+class E2IoReactor
+{
+public:
+  typedef std::function<void ()> Handler; //!< called when the descriptor is readable
+
+  ~E2IoReactor ();
+
+  /**
+  * \return the reactor of the process, started on first use
+  */
+  static E2IoReactor *Get ();
+
+  /**
+  * Sets the number of threads of the reactor. Only effective before the
+  * first call to Get.
+  *
+  * \param threads the number of threads, at least 1
+  */
+  static void SetThreadCount (uint32_t threads);
+
+  /**
+  * Starts watching a descriptor
+  *
+  * \param fd the descriptor, which must stay open until Remove
+  * \param handler called on a reactor thread whenever fd is readable
+  */
+  void Add (int fd, Handler handler);
+
+  /**
+  * Stops watching a descriptor. If its handler is running on another
+  * thread, waits for it to return, so that the objects the handler uses
+  * may be destroyed once Remove returns. A handler may remove its own
+  * descriptor.
+  *
+  * \param fd the descriptor
+  */
+  void Remove (int fd);
+
+  uint32_t GetThreadCount () const;
+
+  /**
+  * \return the number of descriptors being watched
+  */
+  size_t GetSize () const;
+
+private:
+  explicit E2IoReactor (uint32_t threads);
+  E2IoReactor (const E2IoReactor &) = delete;
+  E2IoReactor &operator= (const E2IoReactor &) = delete;
+
+  /**
+  * Loop of a reactor thread
+  */
+  void Run ();
+
+  int m_epoll; //!< epoll instance shared by the threads
+  int m_wakeFd; //!< eventfd waking every thread up on destruction
+  std::vector<std::thread> m_threads;
+  mutable std::mutex m_mutex; //!< protects m_handlers and m_running
+  std::unordered_map<int, std::shared_ptr<Handler>> m_handlers; //!< handler of each descriptor
+  std::unordered_map<int, std::thread::id> m_running; //!< thread running each handler
+  std::condition_variable m_idle; //!< notified when a handler returns
+};
+
+} // namespace ns3
+
+#endif /* E2_IO_REACTOR_H */
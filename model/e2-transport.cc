@@ -0,0 +1,443 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/e2-transport.h>
+#include <ns3/e2-io-reactor.h>
+#include <ns3/encode-buffer-pool.h>
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("E2Transport");
+
+// largest E2 message reassembled from the parts delivered by SCTP
+static const size_t MAX_MESSAGE_SIZE = 4 << 20;
+
+E2Transport::~E2Transport ()
+{
+}
+
+SocketE2Transport::SocketE2Transport ()
+  : m_fd (-1),
+    m_receivedSize (0),
+    m_partialDelivery (false),
+    m_discarding (false)
+{
+}
+
+SocketE2Transport::SocketE2Transport (int fd)
+  : m_fd (fd),
+    m_receivedSize (0),
+    m_partialDelivery (false),
+    m_discarding (false)
+{
+}
+
+SocketE2Transport::~SocketE2Transport ()
+{
+  Close ();
+}
+
+int
+SocketE2Transport::Open ()
+{
+  return m_fd;
+}
+
+bool
+SocketE2Transport::Connect (ReceiveCallback receive)
+{
+  int fd = Open ();
+  if (fd < 0)
+    {
+      return false;
+    }
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+  // SCTP may deliver a large message in parts, the last one flagged
+  // MSG_EOR, and the buffer grows as needed. A SOCK_SEQPACKET socket
+  // delivers whole messages, which cannot exceed its receive buffer.
+  int protocol = 0;
+  socklen_t length = sizeof (protocol);
+  m_partialDelivery = getsockopt (fd, SOL_SOCKET, SO_PROTOCOL, &protocol, &length) == 0 &&
+                      protocol == IPPROTO_SCTP;
+  int bufferSize = 0;
+  length = sizeof (bufferSize);
+  if (m_partialDelivery || getsockopt (fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, &length) < 0)
+    {
+      bufferSize = 0;
+    }
+  m_receiveBuffer.resize (std::max<size_t> (65536, bufferSize));
+  m_receivedSize = 0;
+  m_discarding = false;
+
+  m_fd = fd;
+  m_receive = receive;
+  E2IoReactor::Get ()->Add (fd, [this] () { Receive (); });
+  return true;
+}
+
+void
+SocketE2Transport::Receive ()
+{
+  while (true)
+    {
+      int fd = m_fd;
+      if (fd < 0)
+        {
+          return;
+        }
+      if (m_receivedSize == m_receiveBuffer.size ())
+        {
+          // only with partial delivery, the message does not fit yet
+          if (m_receiveBuffer.size () < MAX_MESSAGE_SIZE)
+            {
+              m_receiveBuffer.resize (std::min (2 * m_receiveBuffer.size (), MAX_MESSAGE_SIZE));
+            }
+          else
+            {
+              if (!m_discarding)
+                {
+                  NS_LOG_ERROR ("E2 message larger than " << MAX_MESSAGE_SIZE
+                                                          << " bytes dropped");
+                }
+              m_receivedSize = 0;
+              m_discarding = true;
+            }
+        }
+
+      struct iovec vector;
+      vector.iov_base = m_receiveBuffer.data () + m_receivedSize;
+      vector.iov_len = m_receiveBuffer.size () - m_receivedSize;
+      struct msghdr header;
+      memset (&header, 0, sizeof (header));
+      header.msg_iov = &vector;
+      header.msg_iovlen = 1;
+      ssize_t received = recvmsg (fd, &header, 0);
+      if (received < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+              NS_LOG_ERROR ("Cannot receive from the peer: " << strerror (errno));
+              Close ();
+            }
+          return;
+        }
+      if (received == 0)
+        {
+          NS_LOG_WARN ("The peer closed the association");
+          Close ();
+          return;
+        }
+      if (header.msg_flags & MSG_TRUNC)
+        {
+          NS_LOG_ERROR ("E2 message larger than the " << m_receiveBuffer.size ()
+                                                     << " bytes receive buffer dropped");
+          m_receivedSize = 0;
+          continue;
+        }
+
+      m_receivedSize += received;
+      if (m_partialDelivery && !(header.msg_flags & MSG_EOR))
+        {
+          continue;
+        }
+      size_t size = m_receivedSize;
+      m_receivedSize = 0;
+      if (m_discarding)
+        {
+          // last part of a message too large
+          m_discarding = false;
+          continue;
+        }
+      m_receive (m_receiveBuffer.data (), size);
+    }
+}
+
+bool
+SocketE2Transport::Send (const uint8_t *buffer, size_t size)
+{
+  int fd = m_fd;
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Association closed, E2 message dropped");
+      return false;
+    }
+  // a message socket sends a message whole or not at all
+  while (send (fd, buffer, size, MSG_NOSIGNAL) < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+          struct pollfd writable = {fd, POLLOUT, 0};
+          poll (&writable, 1, 100);
+        }
+      else if (errno != EINTR)
+        {
+          NS_LOG_ERROR ("Cannot send to the peer: " << strerror (errno));
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+SocketE2Transport::Close ()
+{
+  int fd = m_fd.exchange (-1);
+  if (fd >= 0)
+    {
+      E2IoReactor::Get ()->Remove (fd);
+      close (fd);
+    }
+}
+
+SctpE2Transport::SctpE2Transport (const std::string &ricAddress, uint16_t ricPort,
+                                  uint16_t clientPort)
+  : m_ricAddress (ricAddress),
+    m_ricPort (ricPort),
+    m_clientPort (clientPort)
+{
+}
+
+int
+SctpE2Transport::Open ()
+{
+  int fd = socket (AF_INET, SOCK_STREAM, IPPROTO_SCTP);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Cannot create the SCTP socket: " << strerror (errno));
+      return -1;
+    }
+
+  int reuse = 1;
+  setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof (reuse));
+  struct sockaddr_in local;
+  memset (&local, 0, sizeof (local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl (INADDR_ANY);
+  local.sin_port = htons (m_clientPort);
+  if (bind (fd, (struct sockaddr *) &local, sizeof (local)) < 0)
+    {
+      NS_LOG_ERROR ("Cannot bind the client port " << m_clientPort << ": " << strerror (errno));
+      close (fd);
+      return -1;
+    }
+
+  struct sockaddr_in remote;
+  memset (&remote, 0, sizeof (remote));
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons (m_ricPort);
+  if (inet_pton (AF_INET, m_ricAddress.c_str (), &remote.sin_addr) != 1)
+    {
+      NS_LOG_ERROR ("Invalid RIC address " << m_ricAddress);
+      close (fd);
+      return -1;
+    }
+  if (connect (fd, (struct sockaddr *) &remote, sizeof (remote)) < 0)
+    {
+      NS_LOG_ERROR ("Cannot connect to the RIC at " << m_ricAddress << ":" << m_ricPort << ": "
+                                                    << strerror (errno));
+      close (fd);
+      return -1;
+    }
+  return fd;
+}
+
+UnixE2Transport::UnixE2Transport (const std::string &path)
+  : m_path (path)
+{
+}
+
+int
+UnixE2Transport::Open ()
+{
+  struct sockaddr_un remote;
+  memset (&remote, 0, sizeof (remote));
+  if (m_path.size () >= sizeof (remote.sun_path))
+    {
+      NS_LOG_ERROR ("Socket path too long: " << m_path);
+      return -1;
+    }
+  remote.sun_family = AF_UNIX;
+  memcpy (remote.sun_path, m_path.c_str (), m_path.size ());
+
+  int fd = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Cannot create the Unix socket: " << strerror (errno));
+      return -1;
+    }
+  if (connect (fd, (struct sockaddr *) &remote, sizeof (remote)) < 0)
+    {
+      NS_LOG_ERROR ("Cannot connect to the RIC at " << m_path << ": " << strerror (errno));
+      close (fd);
+      return -1;
+    }
+  return fd;
+}
+
+InProcessE2Transport::Channel::Channel (uint32_t capacity, Time sendTimeout)
+  : m_sendTimeout (sendTimeout.GetNanoSeconds ())
+{
+  for (int end = 0; end < 2; ++end)
+    {
+      m_closed[end] = false;
+      m_queues[end].reset (new MpscQueue<Message> (capacity));
+      m_eventFds[end] = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+      NS_ABORT_MSG_IF (m_eventFds[end] < 0, "eventfd failed: " << strerror (errno));
+    }
+}
+
+InProcessE2Transport::Channel::~Channel ()
+{
+  for (int end = 0; end < 2; ++end)
+    {
+      Message message;
+      while (m_queues[end]->TryPop (message))
+        {
+          EncodeBufferPool::Release (message.m_buffer, message.m_capacity);
+        }
+      close (m_eventFds[end]);
+    }
+}
+
+InProcessE2Transport::InProcessE2Transport (std::shared_ptr<Channel> channel, int end)
+  : m_channel (channel),
+    m_end (end),
+    m_connected (false),
+    m_dropped (0)
+{
+}
+
+InProcessE2Transport::~InProcessE2Transport ()
+{
+  Close ();
+}
+
+std::pair<Ptr<InProcessE2Transport>, Ptr<InProcessE2Transport>>
+InProcessE2Transport::CreatePair (uint32_t capacity, Time sendTimeout)
+{
+  std::shared_ptr<Channel> channel = std::make_shared<Channel> (capacity, sendTimeout);
+  // the constructor is private, hence no Create
+  return std::make_pair (Ptr<InProcessE2Transport> (new InProcessE2Transport (channel, 0), false),
+                         Ptr<InProcessE2Transport> (new InProcessE2Transport (channel, 1), false));
+}
+
+bool
+InProcessE2Transport::Connect (ReceiveCallback receive)
+{
+  NS_ABORT_MSG_IF (m_connected, "Transport already connected");
+  m_receive = receive;
+  m_connected = true;
+  m_channel->m_closed[m_end] = false;
+  // the eventfd is level-triggered, so messages sent before are delivered
+  E2IoReactor::Get ()->Add (m_channel->m_eventFds[m_end], [this] () { Receive (); });
+  return true;
+}
+
+void
+InProcessE2Transport::Receive ()
+{
+  uint64_t count;
+  if (read (m_channel->m_eventFds[m_end], &count, sizeof (count)) < 0 && errno != EAGAIN)
+    {
+      NS_LOG_ERROR ("Cannot read the eventfd: " << strerror (errno));
+    }
+  // drained after the read, so that a message pushed meanwhile signals again
+  Message message;
+  while (m_channel->m_queues[m_end]->TryPop (message))
+    {
+      m_receive ((const uint8_t *) message.m_buffer, message.m_size);
+      EncodeBufferPool::Release (message.m_buffer, message.m_capacity);
+    }
+}
+
+bool
+InProcessE2Transport::Send (const uint8_t *buffer, size_t size)
+{
+  int peer = 1 - m_end;
+  Message message;
+  message.m_buffer = EncodeBufferPool::Get ()->Acquire (size, &message.m_capacity);
+  memcpy (message.m_buffer, buffer, size);
+  message.m_size = size;
+
+  // E2 messages must not be lost, wait for the other end to make room,
+  // but not forever if it is closed or not draining its queue
+  if (!m_channel->m_queues[peer]->TryPush (message))
+    {
+      auto deadline = std::chrono::steady_clock::now () + m_channel->m_sendTimeout;
+      do
+        {
+          if (m_channel->m_closed[peer] || std::chrono::steady_clock::now () >= deadline)
+            {
+              NS_LOG_ERROR ("Queue of the other end full, E2 message dropped");
+              EncodeBufferPool::Release (message.m_buffer, message.m_capacity);
+              m_dropped++;
+              return false;
+            }
+          std::this_thread::yield ();
+        }
+      while (!m_channel->m_queues[peer]->TryPush (message));
+    }
+  uint64_t one = 1;
+  if (write (m_channel->m_eventFds[peer], &one, sizeof (one)) < 0)
+    {
+      NS_LOG_ERROR ("Cannot signal the eventfd: " << strerror (errno));
+    }
+  return true;
+}
+
+void
+InProcessE2Transport::Close ()
+{
+  m_channel->m_closed[m_end] = true;
+  if (m_connected)
+    {
+      E2IoReactor::Get ()->Remove (m_channel->m_eventFds[m_end]);
+      m_connected = false;
+    }
+}
+
+uint64_t
+InProcessE2Transport::GetDroppedCount () const
+{
+  return m_dropped;
+}
+
+} // namespace ns3
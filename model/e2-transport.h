@@ -0,0 +1,248 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef E2_TRANSPORT_H
+#define E2_TRANSPORT_H
+
+#include "ns3/object.h"
+#include "ns3/mpsc-queue.h"
+#include "ns3/nstime.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+* Message-oriented association between an E2 node and a RIC, carrying APER
+* encoded E2AP PDUs. Received messages are delivered by the E2IoReactor
+* threads, one at a time for a given transport.
+*/
+class E2Transport : public SimpleRefCount<E2Transport>
+{
+public:
+  /**
+  * Called with each received message, which is only valid during the call
+  */
+  typedef std::function<void (const uint8_t *buffer, size_t size)> ReceiveCallback;
+
+  virtual ~E2Transport ();
+
+  /**
+  * Opens the association and starts delivering received messages
+  *
+  * \param receive the callback of received messages
+  * \return false if the association cannot be opened
+  */
+  virtual bool Connect (ReceiveCallback receive) = 0;
+
+  /**
+  * Sends a message. May be called by any thread.
+  *
+  * \param buffer the message
+  * \param size the size of the message
+  * \return false if the message could not be sent
+  */
+  virtual bool Send (const uint8_t *buffer, size_t size) = 0;
+
+  /**
+  * Closes the association. No message is delivered once it returns: a
+  * receive callback running on another thread is waited for. May be
+  * called from the receive callback.
+  */
+  virtual void Close () = 0;
+};
+
+/**
+* Transport over a connected message-oriented socket, served by the
+* E2IoReactor
+*/
+class SocketE2Transport : public E2Transport
+{
+public:
+  /**
+  * \param fd a connected SOCK_SEQPACKET or SCTP socket, now owned by the
+  *        transport
+  */
+  explicit SocketE2Transport (int fd);
+  virtual ~SocketE2Transport ();
+
+  virtual bool Connect (ReceiveCallback receive);
+  virtual bool Send (const uint8_t *buffer, size_t size);
+  virtual void Close ();
+
+protected:
+  SocketE2Transport ();
+
+  /**
+  * Opens and connects the socket
+  *
+  * \return the socket, or -1 on error
+  */
+  virtual int Open ();
+
+private:
+  /**
+  * Reactor handler, reads until the socket would block. A message
+  * delivered in parts by SCTP is reassembled up to MSG_EOR, and a message
+  * larger than the receive buffer of a SOCK_SEQPACKET socket, which the
+  * kernel truncates, is dropped with an error.
+  */
+  void Receive ();
+
+  std::atomic<int> m_fd; //!< the socket, -1 when closed
+  ReceiveCallback m_receive;
+  std::vector<uint8_t> m_receiveBuffer; //!< used by one reactor thread at a time
+  size_t m_receivedSize; //!< bytes of a message received in parts
+  bool m_partialDelivery; //!< true for SCTP, whose messages end with MSG_EOR
+  bool m_discarding; //!< true while the parts of a message too large are dropped
+};
+
+/**
+* SCTP association with a RIC, as opened by e2sim
+*/
+class SctpE2Transport : public SocketE2Transport
+{
+public:
+  /**
+  * \param ricAddress the IPv4 address of the RIC
+  * \param ricPort the SCTP port of the RIC
+  * \param clientPort the local port, 0 for any
+  */
+  SctpE2Transport (const std::string &ricAddress, uint16_t ricPort, uint16_t clientPort);
+
+protected:
+  virtual int Open ();
+
+private:
+  std::string m_ricAddress;
+  uint16_t m_ricPort;
+  uint16_t m_clientPort;
+};
+
+/**
+* SOCK_SEQPACKET Unix-domain socket with a RIC running on the same host,
+* for machines without the SCTP kernel module
+*/
+class UnixE2Transport : public SocketE2Transport
+{
+public:
+  /**
+  * \param path the path the RIC listens on
+  */
+  explicit UnixE2Transport (const std::string &path);
+
+protected:
+  virtual int Open ();
+
+private:
+  std::string m_path;
+};
+
+/**
+* One end of an in-process pair of lock-free queues, so that a RIC
+* stand-in can run in the same process without any socket. Send copies
+* the message into a pooled buffer, pushes it to the queue of the other
+* end and signals its eventfd, whose E2IoReactor handler delivers the
+* queued messages.
+*/
+class InProcessE2Transport : public E2Transport
+{
+public:
+  virtual ~InProcessE2Transport ();
+
+  /**
+  * Creates two connected ends
+  *
+  * \param capacity the capacity of the queue of each direction
+  * \param sendTimeout how long Send waits for the other end to make room
+  *        in a full queue before dropping the message
+  * \return the two ends, for instance the E2 node and the RIC
+  */
+  static std::pair<Ptr<InProcessE2Transport>, Ptr<InProcessE2Transport>>
+  CreatePair (uint32_t capacity = 1024, Time sendTimeout = Seconds (5));
+
+  virtual bool Connect (ReceiveCallback receive);
+
+  /**
+  * Queues a message for the other end. If the queue is full, waits for
+  * the other end to make room, and drops the message once the send
+  * timeout expires or as soon as the other end is closed.
+  *
+  * \param buffer the message
+  * \param size the size of the message
+  * \return false if the message was dropped
+  */
+  virtual bool Send (const uint8_t *buffer, size_t size);
+  virtual void Close ();
+
+  /**
+  * \return the number of messages dropped by Send
+  */
+  uint64_t GetDroppedCount () const;
+
+private:
+  /**
+  * A message queued for the other end
+  */
+  struct Message
+  {
+    void *m_buffer; //!< from the EncodeBufferPool
+    size_t m_size;
+    size_t m_capacity;
+  };
+
+  /**
+  * The queues and eventfds of both directions
+  */
+  struct Channel
+  {
+    Channel (uint32_t capacity, Time sendTimeout);
+    ~Channel ();
+
+    std::unique_ptr<MpscQueue<Message>> m_queues[2]; //!< messages received by each end
+    int m_eventFds[2]; //!< signalled when a message is queued for each end
+    std::atomic<bool> m_closed[2]; //!< true once each end is closed, until it connects again
+    std::chrono::nanoseconds m_sendTimeout;
+  };
+
+  InProcessE2Transport (std::shared_ptr<Channel> channel, int end);
+
+  /**
+  * Reactor handler, delivers the queued messages
+  */
+  void Receive ();
+
+  std::shared_ptr<Channel> m_channel;
+  int m_end; //!< index of this end in the channel
+  bool m_connected;
+  ReceiveCallback m_receive;
+  std::atomic<uint64_t> m_dropped; //!< messages dropped by Send
+};
+
+} // namespace ns3
+
+#endif /* E2_TRANSPORT_H */
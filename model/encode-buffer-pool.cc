@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/encode-buffer-pool.h>
+#include <ns3/log.h>
+
+#include <stdlib.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EncodeBufferPool");
+
+EncodeBufferPool::EncodeBufferPool () : m_hits (0), m_misses (0), m_retries (0)
+{
+  m_buckets.resize (GetBucket (MAX_BUFFER_SIZE) + 1);
+}
+
+EncodeBufferPool::~EncodeBufferPool ()
+{
+  for (auto &bucket : m_buckets)
+    {
+      for (void *buffer : bucket)
+        {
+          free (buffer);
+        }
+    }
+}
+
+EncodeBufferPool *
+EncodeBufferPool::Get ()
+{
+  static thread_local EncodeBufferPool pool;
+  return &pool;
+}
+
+int
+EncodeBufferPool::GetBucket (size_t size)
+{
+  int bucket = 0;
+  size_t bucketSize = MIN_BUFFER_SIZE;
+  while (bucketSize < size)
+    {
+      bucketSize <<= 1;
+      ++bucket;
+    }
+  return bucket;
+}
+
+void *
+EncodeBufferPool::Acquire (size_t minSize, size_t *capacity)
+{
+  if (minSize > MAX_BUFFER_SIZE)
+    {
+      ++m_misses;
+      *capacity = minSize;
+      return malloc (minSize);
+    }
+
+  int bucket = GetBucket (minSize);
+  *capacity = MIN_BUFFER_SIZE << bucket;
+  if (!m_buckets[bucket].empty ())
+    {
+      ++m_hits;
+      void *buffer = m_buckets[bucket].back ();
+      m_buckets[bucket].pop_back ();
+      return buffer;
+    }
+  ++m_misses;
+  return malloc (*capacity);
+}
+
+void
+EncodeBufferPool::Recycle (void *buffer, size_t capacity)
+{
+  if (buffer == nullptr)
+    {
+      return;
+    }
+  // only buffers handed out by a pool have an exact bucket capacity
+  if (capacity >= MIN_BUFFER_SIZE && capacity <= MAX_BUFFER_SIZE && (capacity & (capacity - 1)) == 0)
+    {
+      std::vector<void *> &bucket = m_buckets[GetBucket (capacity)];
+      if (bucket.size () < MAX_BUFFERS_PER_BUCKET)
+        {
+          bucket.push_back (buffer);
+          return;
+        }
+    }
+  free (buffer);
+}
+
+void
+EncodeBufferPool::Release (void *buffer, size_t capacity)
+{
+  Get ()->Recycle (buffer, capacity);
+}
+
+size_t
+EncodeBufferPool::GetSizeEstimate (const asn_TYPE_descriptor_t *type) const
+{
+  auto it = m_estimates.find (type);
+  return it == m_estimates.end () ? MIN_BUFFER_SIZE : it->second;
+}
+
+void
+EncodeBufferPool::UpdateSizeEstimate (const asn_TYPE_descriptor_t *type, size_t encoded)
+{
+  // follow growth immediately, shrink slowly so that a single small message
+  // does not cause a retry on the next large one
+  size_t target = encoded + encoded / 4;
+  auto it = m_estimates.find (type);
+  if (it == m_estimates.end ())
+    {
+      m_estimates[type] = target;
+    }
+  else if (target > it->second)
+    {
+      it->second = target;
+    }
+  else
+    {
+      it->second -= (it->second - target) / 16;
+    }
+}
+
+asn_enc_rval_t
+EncodeBufferPool::Encode (const asn_TYPE_descriptor_t *type, const void *structure,
+                          void **buffer, size_t *capacity)
+{
+  EncodeBufferPool *pool = Get ();
+  asn_codec_ctx_t *opt_cod = 0; // disable stack bounds checking
+
+  *buffer = pool->Acquire (pool->GetSizeEstimate (type), capacity);
+  NS_ABORT_MSG_IF (*buffer == nullptr, "Memory exhausted while encoding " << type->name);
+  asn_enc_rval_t encoded =
+      asn_encode_to_buffer (opt_cod, ATS_ALIGNED_BASIC_PER, type, structure, *buffer, *capacity);
+
+  if (encoded.encoded > 0 && (size_t) encoded.encoded > *capacity)
+    {
+      // the encoder reports the size it would have needed, retry once with it
+      NS_LOG_LOGIC (type->name << " needs " << encoded.encoded << " bytes, estimate was "
+                               << *capacity);
+      ++pool->m_retries;
+      pool->Recycle (*buffer, *capacity);
+      *buffer = pool->Acquire (encoded.encoded, capacity);
+      NS_ABORT_MSG_IF (*buffer == nullptr, "Memory exhausted while encoding " << type->name);
+      encoded = asn_encode_to_buffer (opt_cod, ATS_ALIGNED_BASIC_PER, type, structure, *buffer,
+                                      *capacity);
+    }
+
+  if (encoded.encoded < 0 || (size_t) encoded.encoded > *capacity)
+    {
+      pool->Recycle (*buffer, *capacity);
+      *buffer = nullptr;
+      *capacity = 0;
+      if (encoded.encoded >= 0)
+        {
+          encoded.encoded = -1;
+        }
+      return encoded;
+    }
+
+  pool->UpdateSizeEstimate (type, encoded.encoded);
+  return encoded;
+}
+
+uint64_t
+EncodeBufferPool::GetHits () const
+{
+  return m_hits;
+}
+
+uint64_t
+EncodeBufferPool::GetMisses () const
+{
+  return m_misses;
+}
+
+uint64_t
+EncodeBufferPool::GetRetries () const
+{
+  return m_retries;
+}
+
+} // namespace ns3
@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ENCODE_BUFFER_POOL_H
+#define ENCODE_BUFFER_POOL_H
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+extern "C" {
+  #include "asn_application.h"
+}
+
+namespace ns3 {
+
+/**
+* Thread-local pool of buffers for the PER encoding of E2 messages.
+*
+* Buffers are kept in power-of-two buckets and handed back to the pool when
+* the object holding the encoded message goes away, so that a node sending
+* one indication per period reuses the same few buffers instead of growing
+* a new one through realloc every time. The initial buffer size for each
+* ASN.1 type is estimated from the messages of that type encoded so far.
+*/
+class EncodeBufferPool
+{
+public:
+  static const size_t MIN_BUFFER_SIZE = 256; //!< smallest bucket
+  static const size_t MAX_BUFFER_SIZE = 1 << 20; //!< largest pooled bucket
+  static const size_t MAX_BUFFERS_PER_BUCKET = 8; //!< idle buffers kept per bucket
+
+  ~EncodeBufferPool ();
+
+  /**
+  * \return the pool of the calling thread
+  */
+  static EncodeBufferPool *Get ();
+
+  /**
+  * Encodes structure in aligned PER into a buffer taken from the pool of
+  * the calling thread. On success, buffer and capacity describe the pooled
+  * buffer, which must be handed back with Release; on failure no buffer is
+  * returned.
+  *
+  * \param type the asn1c type descriptor
+  * \param structure the structure to encode
+  * \param buffer filled with the buffer holding the encoded message
+  * \param capacity filled with the allocated size of buffer
+  * \return the asn1c encoding result
+  */
+  static asn_enc_rval_t Encode (const asn_TYPE_descriptor_t *type, const void *structure,
+                                void **buffer, size_t *capacity);
+
+  /**
+  * Gives a buffer back to the pool of the calling thread. Buffers that do
+  * not fit any bucket are freed. Null buffers are ignored.
+  *
+  * \param buffer a buffer returned by Encode or Acquire, or any malloc'd buffer
+  * \param capacity the capacity returned together with buffer, 0 if unknown
+  */
+  static void Release (void *buffer, size_t capacity);
+
+  /**
+  * Returns a buffer of at least minSize bytes
+  *
+  * \param minSize the requested size
+  * \param capacity filled with the actual size of the buffer
+  */
+  void *Acquire (size_t minSize, size_t *capacity);
+
+  /**
+  * \return the size the next encoding of type is expected to need
+  */
+  size_t GetSizeEstimate (const asn_TYPE_descriptor_t *type) const;
+
+  uint64_t GetHits () const; //!< acquisitions served from the pool
+  uint64_t GetMisses () const; //!< acquisitions that needed a malloc
+  uint64_t GetRetries () const; //!< encodings that overflowed the estimate
+
+private:
+  EncodeBufferPool ();
+
+  void Recycle (void *buffer, size_t capacity);
+  void UpdateSizeEstimate (const asn_TYPE_descriptor_t *type, size_t encoded);
+  static int GetBucket (size_t size);
+
+  std::vector<std::vector<void *>> m_buckets; //!< idle buffers, by power-of-two bucket
+  std::map<const asn_TYPE_descriptor_t *, size_t> m_estimates; //!< expected encoded size per type
+  uint64_t m_hits;
+  uint64_t m_misses;
+  uint64_t m_retries;
+};
+
+} // namespace ns3
+
+#endif /* ENCODE_BUFFER_POOL_H */
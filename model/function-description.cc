@@ -24,6 +24,7 @@
 
 #include <ns3/function-description.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/encode-buffer-pool.h>
 #include <ns3/log.h>
 
 
@@ -37,12 +38,14 @@ FunctionDescription::FunctionDescription ()
 //   FillAndEncodeKpmFunctionDescription (descriptor);
 //   ASN_STRUCT_FREE_CONTENTS_ONLY (asn_DEF_E2SM_KPM_RANfunction_Description, descriptor);
 //   delete descriptor;
+    m_buffer = nullptr;
     m_size = 0;
+    m_capacity = 0;
 }
 
 FunctionDescription::~FunctionDescription ()
 {
-  free (m_buffer);
+  EncodeBufferPool::Release (m_buffer, m_capacity);
   m_size = 0;
 }
 
@@ -48,6 +48,7 @@ namespace ns3 {
 
     void* m_buffer;
     size_t m_size;
+    size_t m_capacity; //!< allocated size of m_buffer, see EncodeBufferPool
     
     // TODO improve the abstraction
 //   private:
@@ -0,0 +1,372 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef KPI_SCHEMA_H
+#define KPI_SCHEMA_H
+
+#include <ns3/kpi-table.h>
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+
+namespace ns3 {
+
+/**
+* KPIs reported by the indication message helpers. The values index
+* KPI_SCHEMA and are used as column keys of the KpiTable.
+*/
+namespace kpi {
+enum Id : uint16_t {
+  // mmWave O-CU-UP, UE
+  QOSFLOW_PDCP_PDU_VOLUME_DL_FILTER_UEID = 0,
+  DRB_PDCP_PDU_NBR_DL_QOS_UEID,
+  // mmWave O-DU, UE
+  DRB_UE_THP_DL_UEID,
+  TB_TOT_NBR_DL_1_UEID,
+  TB_TOT_NBR_DL_INITIAL_1_UEID,
+  TB_TOT_NBR_DL_INITIAL_QPSK_UEID,
+  TB_TOT_NBR_DL_INITIAL_16QAM_UEID,
+  TB_TOT_NBR_DL_INITIAL_64QAM_UEID,
+  TB_ERR_TOTAL_NBR_DL_1_UEID,
+  RRU_PRB_USED_DL_UEID,
+  CARR_PDSCH_MCS_DIST_BIN1_UEID,
+  CARR_PDSCH_MCS_DIST_BIN2_UEID,
+  CARR_PDSCH_MCS_DIST_BIN3_UEID,
+  CARR_PDSCH_MCS_DIST_BIN4_UEID,
+  CARR_PDSCH_MCS_DIST_BIN5_UEID,
+  CARR_PDSCH_MCS_DIST_BIN6_UEID,
+  L1M_RS_SINR_BIN34_UEID,
+  L1M_RS_SINR_BIN46_UEID,
+  L1M_RS_SINR_BIN58_UEID,
+  L1M_RS_SINR_BIN70_UEID,
+  L1M_RS_SINR_BIN82_UEID,
+  L1M_RS_SINR_BIN94_UEID,
+  L1M_RS_SINR_BIN127_UEID,
+  DRB_BUFFER_SIZE_QOS_UEID,
+  // O-CU-CP, UE
+  DRB_ESTAB_SUCC_5QI_UEID,
+  DRB_REL_ACT_NBR_5QI_UEID,
+  // mmWave serving and neighbor cells, UE
+  SERVING_CELL_ID,
+  SERVING_SINR,
+  SERVING_CONVERTED_SINR,
+  NEIG_CELL_ID_1,
+  NEIG_SINR_1,
+  NEIG_CONVERTED_SINR_1,
+  NEIG_CELL_ID_2,
+  NEIG_SINR_2,
+  NEIG_CONVERTED_SINR_2,
+  NEIG_CELL_ID_3,
+  NEIG_SINR_3,
+  NEIG_CONVERTED_SINR_3,
+  NEIG_CELL_ID_4,
+  NEIG_SINR_4,
+  NEIG_CONVERTED_SINR_4,
+  NEIG_CELL_ID_5,
+  NEIG_SINR_5,
+  NEIG_CONVERTED_SINR_5,
+  NEIG_CELL_ID_6,
+  NEIG_SINR_6,
+  NEIG_CONVERTED_SINR_6,
+  NEIG_CELL_ID_7,
+  NEIG_SINR_7,
+  NEIG_CONVERTED_SINR_7,
+  NEIG_CELL_ID_8,
+  NEIG_SINR_8,
+  NEIG_CONVERTED_SINR_8,
+  // LTE O-CU-UP, UE
+  DRB_PDCP_SDU_VOLUME_DL_FILTER_UEID,
+  TOT_PDCP_SDU_NBR_DL_UEID,
+  DRB_PDCP_SDU_BIT_RATE_DL_UEID,
+  DRB_PDCP_SDU_DELAY_DL_UEID,
+  // mmWave O-DU, cell
+  TB_TOT_NBR_DL_1,
+  TB_TOT_NBR_DL_INITIAL,
+  TB_TOT_NBR_DL_INITIAL_QPSK,
+  TB_TOT_NBR_DL_INITIAL_16QAM,
+  TB_TOT_NBR_DL_INITIAL_64QAM,
+  RRU_PRB_USED_DL,
+  TB_ERR_TOTAL_NBR_DL_1,
+  QOSFLOW_PDCP_PDU_VOLUME_DL_FILTER,
+  CARR_PDSCH_MCS_DIST_BIN1,
+  CARR_PDSCH_MCS_DIST_BIN2,
+  CARR_PDSCH_MCS_DIST_BIN3,
+  CARR_PDSCH_MCS_DIST_BIN4,
+  CARR_PDSCH_MCS_DIST_BIN5,
+  CARR_PDSCH_MCS_DIST_BIN6,
+  L1M_RS_SINR_BIN34,
+  L1M_RS_SINR_BIN46,
+  L1M_RS_SINR_BIN58,
+  L1M_RS_SINR_BIN70,
+  L1M_RS_SINR_BIN82,
+  L1M_RS_SINR_BIN94,
+  L1M_RS_SINR_BIN127,
+  DRB_BUFFER_SIZE_QOS,
+  DRB_MEAN_ACTIVE_UE_DL,
+  // LTE, cell
+  DRB_PDCP_SDU_DELAY_DL,
+  PDCP_BYTES_UL,
+  PDCP_BYTES_DL,
+  NUM_ACTIVE_UES,
+
+  COUNT
+};
+} // namespace kpi
+
+enum class KpiScope : uint8_t { UE = 0, CELL = 1 };
+
+/**
+* Compile-time description of a KPI
+*/
+struct KpiDescriptor
+{
+  template <size_t N>
+  constexpr KpiDescriptor (kpi::Id id, const char (&name)[N], KpiTable::ValueType type,
+                           KpiScope scope, bool reduced)
+      : m_id (id), m_name (name), m_nameSize (N - 1), m_type (type), m_scope (scope),
+        m_reduced (reduced)
+  {
+  }
+
+  kpi::Id m_id;
+  const char *m_name; //!< measurement name, the PrintableString content
+  size_t m_nameSize; //!< length of m_name
+  KpiTable::ValueType m_type;
+  KpiScope m_scope;
+  bool m_reduced; //!< true if also reported with the reduced PM values profile
+};
+
+constexpr KpiTable::ValueType KPI_INT = KpiTable::INTEGER;
+constexpr KpiTable::ValueType KPI_REAL = KpiTable::REAL;
+constexpr KpiScope KPI_UE = KpiScope::UE;
+constexpr KpiScope KPI_CELL = KpiScope::CELL;
+
+constexpr KpiDescriptor KPI_SCHEMA[] = {
+    {kpi::QOSFLOW_PDCP_PDU_VOLUME_DL_FILTER_UEID, "QosFlow.PdcpPduVolumeDL_Filter.UEID", KPI_INT, KPI_UE, false},
+    {kpi::DRB_PDCP_PDU_NBR_DL_QOS_UEID, "DRB.PdcpPduNbrDl.Qos.UEID", KPI_INT, KPI_UE, false},
+
+    {kpi::DRB_UE_THP_DL_UEID, "DRB.UEThpDl.UEID", KPI_REAL, KPI_UE, true},
+    {kpi::TB_TOT_NBR_DL_1_UEID, "TB.TotNbrDl.1.UEID", KPI_INT, KPI_UE, false},
+    {kpi::TB_TOT_NBR_DL_INITIAL_1_UEID, "TB.TotNbrDlInitial.1.UEID", KPI_INT, KPI_UE, false},
+    {kpi::TB_TOT_NBR_DL_INITIAL_QPSK_UEID, "TB.TotNbrDlInitial.Qpsk.UEID", KPI_INT, KPI_UE, false},
+    {kpi::TB_TOT_NBR_DL_INITIAL_16QAM_UEID, "TB.TotNbrDlInitial.16Qam.UEID", KPI_INT, KPI_UE, false},
+    {kpi::TB_TOT_NBR_DL_INITIAL_64QAM_UEID, "TB.TotNbrDlInitial.64Qam.UEID", KPI_INT, KPI_UE, false},
+    {kpi::TB_ERR_TOTAL_NBR_DL_1_UEID, "TB.ErrTotalNbrDl.1.UEID", KPI_INT, KPI_UE, false},
+    {kpi::RRU_PRB_USED_DL_UEID, "RRU.PrbUsedDl.UEID", KPI_INT, KPI_UE, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN1_UEID, "CARR.PDSCHMCSDist.Bin1.UEID", KPI_INT, KPI_UE, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN2_UEID, "CARR.PDSCHMCSDist.Bin2.UEID", KPI_INT, KPI_UE, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN3_UEID, "CARR.PDSCHMCSDist.Bin3.UEID", KPI_INT, KPI_UE, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN4_UEID, "CARR.PDSCHMCSDist.Bin4.UEID", KPI_INT, KPI_UE, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN5_UEID, "CARR.PDSCHMCSDist.Bin5.UEID", KPI_INT, KPI_UE, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN6_UEID, "CARR.PDSCHMCSDist.Bin6.UEID", KPI_INT, KPI_UE, false},
+    {kpi::L1M_RS_SINR_BIN34_UEID, "L1M.RS-SINR.Bin34.UEID", KPI_INT, KPI_UE, false},
+    {kpi::L1M_RS_SINR_BIN46_UEID, "L1M.RS-SINR.Bin46.UEID", KPI_INT, KPI_UE, false},
+    {kpi::L1M_RS_SINR_BIN58_UEID, "L1M.RS-SINR.Bin58.UEID", KPI_INT, KPI_UE, false},
+    {kpi::L1M_RS_SINR_BIN70_UEID, "L1M.RS-SINR.Bin70.UEID", KPI_INT, KPI_UE, false},
+    {kpi::L1M_RS_SINR_BIN82_UEID, "L1M.RS-SINR.Bin82.UEID", KPI_INT, KPI_UE, false},
+    {kpi::L1M_RS_SINR_BIN94_UEID, "L1M.RS-SINR.Bin94.UEID", KPI_INT, KPI_UE, false},
+    {kpi::L1M_RS_SINR_BIN127_UEID, "L1M.RS-SINR.Bin127.UEID", KPI_INT, KPI_UE, false},
+    {kpi::DRB_BUFFER_SIZE_QOS_UEID, "DRB.BufferSize.Qos.UEID", KPI_INT, KPI_UE, false},
+
+    {kpi::DRB_ESTAB_SUCC_5QI_UEID, "DRB.EstabSucc.5QI.UEID", KPI_INT, KPI_UE, false},
+    {kpi::DRB_REL_ACT_NBR_5QI_UEID, "DRB.RelActNbr.5QI.UEID", KPI_INT, KPI_UE, false},
+
+    {kpi::SERVING_CELL_ID, "servingcellID", KPI_INT, KPI_UE, true},
+    {kpi::SERVING_SINR, "servingSINR", KPI_REAL, KPI_UE, true},
+    {kpi::SERVING_CONVERTED_SINR, "servingconvertedSINR", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_1, "neigCellid1", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_1, "neigSINR1", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_1, "neigconvertedSINR1", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_2, "neigCellid2", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_2, "neigSINR2", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_2, "neigconvertedSINR2", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_3, "neigCellid3", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_3, "neigSINR3", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_3, "neigconvertedSINR3", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_4, "neigCellid4", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_4, "neigSINR4", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_4, "neigconvertedSINR4", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_5, "neigCellid5", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_5, "neigSINR5", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_5, "neigconvertedSINR5", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_6, "neigCellid6", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_6, "neigSINR6", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_6, "neigconvertedSINR6", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_7, "neigCellid7", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_7, "neigSINR7", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_7, "neigconvertedSINR7", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_CELL_ID_8, "neigCellid8", KPI_INT, KPI_UE, true},
+    {kpi::NEIG_SINR_8, "neigSINR8", KPI_REAL, KPI_UE, true},
+    {kpi::NEIG_CONVERTED_SINR_8, "neigconvertedSINR8", KPI_INT, KPI_UE, true},
+
+    {kpi::DRB_PDCP_SDU_VOLUME_DL_FILTER_UEID, "DRB.PdcpSduVolumeDl_Filter.UEID", KPI_INT, KPI_UE, false},
+    {kpi::TOT_PDCP_SDU_NBR_DL_UEID, "Tot.PdcpSduNbrDl.UEID", KPI_INT, KPI_UE, false},
+    {kpi::DRB_PDCP_SDU_BIT_RATE_DL_UEID, "DRB.PdcpSduBitRateDl.UEID", KPI_REAL, KPI_UE, false},
+    {kpi::DRB_PDCP_SDU_DELAY_DL_UEID, "DRB.PdcpSduDelayDl.UEID", KPI_REAL, KPI_UE, false},
+
+    {kpi::TB_TOT_NBR_DL_1, "TB.TotNbrDl.1", KPI_INT, KPI_CELL, false},
+    {kpi::TB_TOT_NBR_DL_INITIAL, "TB.TotNbrDlInitial", KPI_INT, KPI_CELL, false},
+    {kpi::TB_TOT_NBR_DL_INITIAL_QPSK, "TB.TotNbrDlInitial.Qpsk", KPI_INT, KPI_CELL, true},
+    {kpi::TB_TOT_NBR_DL_INITIAL_16QAM, "TB.TotNbrDlInitial.16Qam", KPI_INT, KPI_CELL, true},
+    {kpi::TB_TOT_NBR_DL_INITIAL_64QAM, "TB.TotNbrDlInitial.64Qam", KPI_INT, KPI_CELL, true},
+    {kpi::RRU_PRB_USED_DL, "RRU.PrbUsedDl", KPI_REAL, KPI_CELL, true},
+    {kpi::TB_ERR_TOTAL_NBR_DL_1, "TB.ErrTotalNbrDl.1", KPI_INT, KPI_CELL, false},
+    {kpi::QOSFLOW_PDCP_PDU_VOLUME_DL_FILTER, "QosFlow.PdcpPduVolumeDL_Filter", KPI_INT, KPI_CELL, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN1, "CARR.PDSCHMCSDist.Bin1", KPI_INT, KPI_CELL, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN2, "CARR.PDSCHMCSDist.Bin2", KPI_INT, KPI_CELL, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN3, "CARR.PDSCHMCSDist.Bin3", KPI_INT, KPI_CELL, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN4, "CARR.PDSCHMCSDist.Bin4", KPI_INT, KPI_CELL, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN5, "CARR.PDSCHMCSDist.Bin5", KPI_INT, KPI_CELL, false},
+    {kpi::CARR_PDSCH_MCS_DIST_BIN6, "CARR.PDSCHMCSDist.Bin6", KPI_INT, KPI_CELL, false},
+    {kpi::L1M_RS_SINR_BIN34, "L1M.RS-SINR.Bin34", KPI_INT, KPI_CELL, false},
+    {kpi::L1M_RS_SINR_BIN46, "L1M.RS-SINR.Bin46", KPI_INT, KPI_CELL, false},
+    {kpi::L1M_RS_SINR_BIN58, "L1M.RS-SINR.Bin58", KPI_INT, KPI_CELL, false},
+    {kpi::L1M_RS_SINR_BIN70, "L1M.RS-SINR.Bin70", KPI_INT, KPI_CELL, false},
+    {kpi::L1M_RS_SINR_BIN82, "L1M.RS-SINR.Bin82", KPI_INT, KPI_CELL, false},
+    {kpi::L1M_RS_SINR_BIN94, "L1M.RS-SINR.Bin94", KPI_INT, KPI_CELL, false},
+    {kpi::L1M_RS_SINR_BIN127, "L1M.RS-SINR.Bin127", KPI_INT, KPI_CELL, false},
+    {kpi::DRB_BUFFER_SIZE_QOS, "DRB.BufferSize.Qos", KPI_INT, KPI_CELL, false},
+    {kpi::DRB_MEAN_ACTIVE_UE_DL, "DRB.MeanActiveUeDl", KPI_INT, KPI_CELL, true},
+
+    {kpi::DRB_PDCP_SDU_DELAY_DL, "DRB.PdcpSduDelayDl", KPI_REAL, KPI_CELL, false},
+    {kpi::PDCP_BYTES_UL, "m_pDCPBytesUL", KPI_INT, KPI_CELL, true},
+    {kpi::PDCP_BYTES_DL, "m_pDCPBytesDL", KPI_INT, KPI_CELL, true},
+    {kpi::NUM_ACTIVE_UES, "numActiveUes", KPI_INT, KPI_CELL, true},
+};
+
+/**
+* \return true if every entry of KPI_SCHEMA sits at the index of its ID
+*/
+constexpr bool
+IsKpiSchemaOrdered ()
+{
+  for (size_t i = 0; i < kpi::COUNT; ++i)
+    {
+      if (KPI_SCHEMA[i].m_id != i)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+* Histogram KPI, whose bins are consecutive KPIs of KPI_SCHEMA. The bins
+* are set as separate columns of the KpiTable, and encoded as a single
+* measurement with one distBinX label per bin.
+*/
+struct KpiHistogram
+{
+  const char *m_name; //!< measurement name of the histogram
+  kpi::Id m_firstBin; //!< KPI of the first bin, the others follow it
+  uint8_t m_binCount;
+  uint8_t m_binLabels[8]; //!< distBinX label of each bin, the number of the bin name
+};
+
+constexpr KpiHistogram KPI_HISTOGRAMS[] = {
+    {"CARR.PDSCHMCSDist.UEID", kpi::CARR_PDSCH_MCS_DIST_BIN1_UEID, 6, {1, 2, 3, 4, 5, 6}},
+    {"L1M.RS-SINR.UEID", kpi::L1M_RS_SINR_BIN34_UEID, 7, {34, 46, 58, 70, 82, 94, 127}},
+    {"CARR.PDSCHMCSDist", kpi::CARR_PDSCH_MCS_DIST_BIN1, 6, {1, 2, 3, 4, 5, 6}},
+    {"L1M.RS-SINR", kpi::L1M_RS_SINR_BIN34, 7, {34, 46, 58, 70, 82, 94, 127}},
+};
+
+/**
+* \param id a KPI of KPI_SCHEMA
+* \return the measurement ID of the KPI, advertised in the RAN function
+*         description: its kpi::Id plus one, since measID 0 is not allowed
+*/
+constexpr long
+GetMeasId (kpi::Id id)
+{
+  return id + 1;
+}
+
+/**
+* \param histogram an entry of KPI_HISTOGRAMS
+* \return the measurement ID of the histogram, numbered after the last KPI
+*/
+inline long
+GetHistogramMeasId (const KpiHistogram &histogram)
+{
+  return kpi::COUNT + 1 + (&histogram - KPI_HISTOGRAMS);
+}
+
+/**
+* \param name a measurement name
+* \return the KPI of KPI_SCHEMA with that name, or kpi::COUNT if there is
+*         none
+*/
+inline kpi::Id
+FindKpi (const std::string &name)
+{
+  for (const KpiDescriptor &descriptor : KPI_SCHEMA)
+    {
+      if (name.size () == descriptor.m_nameSize &&
+          memcmp (name.data (), descriptor.m_name, descriptor.m_nameSize) == 0)
+        {
+          return descriptor.m_id;
+        }
+    }
+  return kpi::COUNT;
+}
+
+/**
+* \param id a KPI of KPI_SCHEMA
+* \return the histogram the KPI is a bin of, or nullptr
+*/
+inline const KpiHistogram *
+FindKpiHistogram (kpi::Id id)
+{
+  for (const KpiHistogram &histogram : KPI_HISTOGRAMS)
+    {
+      if (id >= histogram.m_firstBin && id < histogram.m_firstBin + histogram.m_binCount)
+        {
+          return &histogram;
+        }
+    }
+  return nullptr;
+}
+
+/**
+* \param name a measurement name
+* \return the histogram with that name, or nullptr
+*/
+inline const KpiHistogram *
+FindKpiHistogram (const std::string &name)
+{
+  for (const KpiHistogram &histogram : KPI_HISTOGRAMS)
+    {
+      if (name == histogram.m_name)
+        {
+          return &histogram;
+        }
+    }
+  return nullptr;
+}
+
+static_assert (sizeof (KPI_SCHEMA) / sizeof (KPI_SCHEMA[0]) == kpi::COUNT,
+               "KPI_SCHEMA must have one entry per kpi::Id");
+static_assert (IsKpiSchemaOrdered (), "KPI_SCHEMA entries must follow the kpi::Id order");
+
+} // namespace ns3
+
+#endif /* KPI_SCHEMA_H */
@@ -0,0 +1,257 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/kpi-table.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpiTable");
+
+const size_t KpiTable::NO_COLUMN = static_cast<size_t> (-1);
+
+KpiTable::KpiTable ()
+{
+}
+
+size_t
+KpiTable::GetSlot (const std::string &id)
+{
+  auto it = m_slots.find (id);
+  if (it != m_slots.end ())
+    {
+      return it->second;
+    }
+
+  size_t slot = m_ids.size ();
+  m_ids.push_back (id);
+  m_slots.emplace (id, slot);
+  m_valueCounts.push_back (0);
+  for (auto &column : m_columns)
+    {
+      Resize (column, slot + 1);
+    }
+  return slot;
+}
+
+size_t
+KpiTable::GetColumn (const std::string &name, ValueType type)
+{
+  auto it = m_columnIndex.find (name);
+  if (it != m_columnIndex.end ())
+    {
+      NS_ABORT_MSG_IF (m_columns[it->second].m_type != type,
+                       "KPI " << name << " already registered with another value type");
+      return it->second;
+    }
+
+  size_t index = m_columns.size ();
+  m_columns.push_back ({name, type, {}, {}, {}});
+  Resize (m_columns.back (), m_ids.size ());
+  m_columnIndex.emplace (name, index);
+  NS_LOG_LOGIC ("New KPI column " << name << " at " << index);
+  return index;
+}
+
+size_t
+KpiTable::AddKeyedColumn (uint16_t key, const char *name, ValueType type)
+{
+  size_t column = GetColumn (std::string (name), type);
+  if (key >= m_keyedColumns.size ())
+    {
+      m_keyedColumns.resize (key + 1, NO_COLUMN);
+    }
+  m_keyedColumns[key] = column;
+  return column;
+}
+
+void
+KpiTable::Resize (Column &column, size_t slots)
+{
+  if (column.m_type == INTEGER)
+    {
+      column.m_integers.resize (slots, 0);
+    }
+  else
+    {
+      column.m_reals.resize (slots, 0.0);
+    }
+  column.m_present.resize (slots, 0);
+}
+
+void
+KpiTable::SetInteger (size_t slot, size_t column, int64_t value)
+{
+  NS_ASSERT (slot < m_ids.size () && column < m_columns.size ());
+  Column &col = m_columns[column];
+  NS_ASSERT_MSG (col.m_type == INTEGER, "KPI " << col.m_name << " is not an integer");
+  col.m_integers[slot] = value;
+  if (!col.m_present[slot])
+    {
+      col.m_present[slot] = 1;
+      m_valueCounts[slot]++;
+    }
+}
+
+void
+KpiTable::SetReal (size_t slot, size_t column, double value)
+{
+  NS_ASSERT (slot < m_ids.size () && column < m_columns.size ());
+  Column &col = m_columns[column];
+  NS_ASSERT_MSG (col.m_type == REAL, "KPI " << col.m_name << " is not a real");
+  col.m_reals[slot] = value;
+  if (!col.m_present[slot])
+    {
+      col.m_present[slot] = 1;
+      m_valueCounts[slot]++;
+    }
+}
+
+void
+KpiTable::SetInteger (size_t slot, const std::string &name, int64_t value)
+{
+  SetInteger (slot, GetColumn (name, INTEGER), value);
+}
+
+void
+KpiTable::SetReal (size_t slot, const std::string &name, double value)
+{
+  SetReal (slot, GetColumn (name, REAL), value);
+}
+
+bool
+KpiTable::FindSlot (const std::string &id, size_t &slot) const
+{
+  auto it = m_slots.find (id);
+  if (it == m_slots.end ())
+    {
+      return false;
+    }
+  slot = it->second;
+  return true;
+}
+
+bool
+KpiTable::FindColumn (const std::string &name, size_t &column) const
+{
+  auto it = m_columnIndex.find (name);
+  if (it == m_columnIndex.end ())
+    {
+      return false;
+    }
+  column = it->second;
+  return true;
+}
+
+size_t
+KpiTable::GetSlotCount () const
+{
+  return m_ids.size ();
+}
+
+size_t
+KpiTable::GetColumnCount () const
+{
+  return m_columns.size ();
+}
+
+bool
+KpiTable::IsEmpty () const
+{
+  return m_ids.empty ();
+}
+
+const std::string &
+KpiTable::GetId (size_t slot) const
+{
+  return m_ids.at (slot);
+}
+
+const std::string &
+KpiTable::GetColumnName (size_t column) const
+{
+  return m_columns.at (column).m_name;
+}
+
+KpiTable::ValueType
+KpiTable::GetColumnType (size_t column) const
+{
+  return m_columns.at (column).m_type;
+}
+
+bool
+KpiTable::HasValue (size_t slot, size_t column) const
+{
+  return m_columns[column].m_present[slot] != 0;
+}
+
+int64_t
+KpiTable::GetInteger (size_t slot, size_t column) const
+{
+  NS_ASSERT (m_columns[column].m_type == INTEGER);
+  return m_columns[column].m_integers[slot];
+}
+
+double
+KpiTable::GetReal (size_t slot, size_t column) const
+{
+  NS_ASSERT (m_columns[column].m_type == REAL);
+  return m_columns[column].m_reals[slot];
+}
+
+size_t
+KpiTable::GetValueCount (size_t slot) const
+{
+  return m_valueCounts[slot];
+}
+
+const std::vector<int64_t> &
+KpiTable::GetIntegers (size_t column) const
+{
+  return m_columns.at (column).m_integers;
+}
+
+const std::vector<double> &
+KpiTable::GetReals (size_t column) const
+{
+  return m_columns.at (column).m_reals;
+}
+
+const std::vector<uint8_t> &
+KpiTable::GetPresence (size_t column) const
+{
+  return m_columns.at (column).m_present;
+}
+
+void
+KpiTable::Clear ()
+{
+  m_ids.clear ();
+  m_slots.clear ();
+  m_valueCounts.clear ();
+  for (auto &column : m_columns)
+    {
+      column.m_integers.clear ();
+      column.m_reals.clear ();
+      column.m_present.clear ();
+    }
+}
+
+} // namespace ns3
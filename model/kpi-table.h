@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef KPI_TABLE_H
+#define KPI_TABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+* Columnar store of the KPIs of a report.
+*
+* Each row (slot) is a measured entity, e.g., a UE identified by its IMSI,
+* and each column is a KPI whose name is interned once per table. Values
+* are kept in one contiguous int64_t or double array per column, indexed
+* by slot, together with a presence flag, since not every entity reports
+* every KPI. Setting a value for an existing slot and column overwrites
+* it, so KPIs reported for the same entity by different calls end up in
+* the same row.
+*/
+class KpiTable
+{
+public:
+  enum ValueType { INTEGER = 0, REAL = 1 };
+
+  KpiTable ();
+
+  /**
+  * \param id the ID of the entity, e.g., the UE IMSI
+  * \return the slot of the entity, added on first use
+  */
+  size_t GetSlot (const std::string &id);
+
+  /**
+  * \param name the KPI name
+  * \param type the value type of the KPI, which must not change once the
+  *        column exists
+  * \return the column of the KPI, added on first use
+  */
+  size_t GetColumn (const std::string &name, ValueType type);
+
+  /**
+  * Same as GetColumn (name, type), with the column cached under a small
+  * caller-defined key, e.g., a kpi::Id, so that later lookups are a plain
+  * array access that neither builds nor hashes the name
+  *
+  * \param key the dense key of the KPI
+  * \param name the KPI name
+  * \param type the value type of the KPI
+  * \return the column of the KPI, added on first use
+  */
+  size_t
+  GetColumn (uint16_t key, const char *name, ValueType type)
+  {
+    if (key < m_keyedColumns.size () && m_keyedColumns[key] != NO_COLUMN)
+      {
+        return m_keyedColumns[key];
+      }
+    return AddKeyedColumn (key, name, type);
+  }
+
+  void SetInteger (size_t slot, size_t column, int64_t value);
+  void SetReal (size_t slot, size_t column, double value);
+
+  /**
+  * Shorthands looking up the column by name
+  */
+  void SetInteger (size_t slot, const std::string &name, int64_t value);
+  void SetReal (size_t slot, const std::string &name, double value);
+
+  /**
+  * Lookups that do not add the slot or the column
+  *
+  * \return false if the entity or the KPI is not in the table
+  */
+  bool FindSlot (const std::string &id, size_t &slot) const;
+  bool FindColumn (const std::string &name, size_t &column) const;
+
+  size_t GetSlotCount () const;
+  size_t GetColumnCount () const;
+  bool IsEmpty () const;
+
+  const std::string &GetId (size_t slot) const;
+  const std::string &GetColumnName (size_t column) const;
+  ValueType GetColumnType (size_t column) const;
+
+  bool HasValue (size_t slot, size_t column) const;
+  int64_t GetInteger (size_t slot, size_t column) const;
+  double GetReal (size_t slot, size_t column) const;
+
+  /**
+  * \return the number of KPIs with a value in the slot
+  */
+  size_t GetValueCount (size_t slot) const;
+
+  /**
+  * Contiguous views of a column, indexed by slot, for linear scans. Slots
+  * without a value hold 0.
+  */
+  const std::vector<int64_t> &GetIntegers (size_t column) const;
+  const std::vector<double> &GetReals (size_t column) const;
+  const std::vector<uint8_t> &GetPresence (size_t column) const;
+
+  /**
+  * Drops every row, keeping the interned columns and the allocated
+  * storage for the next report
+  */
+  void Clear ();
+
+private:
+  struct Column
+  {
+    std::string m_name;
+    ValueType m_type;
+    std::vector<int64_t> m_integers; //!< values of an INTEGER column
+    std::vector<double> m_reals; //!< values of a REAL column
+    std::vector<uint8_t> m_present; //!< 1 if the slot has a value
+  };
+
+  static const size_t NO_COLUMN;
+
+  void Resize (Column &column, size_t slots);
+  size_t AddKeyedColumn (uint16_t key, const char *name, ValueType type);
+
+  std::vector<std::string> m_ids; //!< entity ID of each slot
+  std::unordered_map<std::string, size_t> m_slots; //!< entity ID to slot
+  std::vector<uint16_t> m_valueCounts; //!< number of values of each slot
+  std::vector<Column> m_columns;
+  std::unordered_map<std::string, size_t> m_columnIndex; //!< KPI name to column
+  std::vector<size_t> m_keyedColumns; //!< column of each key, see GetColumn
+};
+
+} // namespace ns3
+
+#endif /* KPI_TABLE_H */
@@ -28,6 +28,8 @@
 
 #include <ns3/kpm-function-description.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/encode-buffer-pool.h>
+#include <ns3/kpi-schema.h>
 #include <ns3/log.h>
 
 extern "C" {
@@ -49,49 +51,23 @@ KpmFunctionDescription::KpmFunctionDescription ()
 
 KpmFunctionDescription::~KpmFunctionDescription ()
 {
-  free (m_buffer);
-  m_size = 0;
+  // m_buffer is released by FunctionDescription
 }
 
 void
 KpmFunctionDescription::Encode (E2SM_KPM_RANfunction_Description_t *descriptor)
 {
-  if (false) {
-    asn_codec_ctx_t *opt_cod = 0; // disable stack bounds checking
-    // encode the structure into the e2smbuffer
-    asn_encode_to_new_buffer_result_s encodedMsg = asn_encode_to_new_buffer (
-        opt_cod, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_RANfunction_Description, descriptor);
-
-    if (encodedMsg.result.encoded < 0)
-      {
-        printf("I am Hereeeeeeeeeeeeeeeeeeeeeeee");
-        
-        NS_FATAL_ERROR ("Error during the encoding of the RIC Indication Header, errno: "
-                        << strerror (errno) << ", failed_type " << encodedMsg.result.failed_type->name
-                        << ", structure_ptr " << encodedMsg.result.structure_ptr);
-      }
-
-    m_buffer = encodedMsg.buffer;
-    m_size = encodedMsg.result.encoded;
-  } else {
-    asn_codec_ctx_t *opt_cod = 0; // disable stack bounds checking
-    // encode the structure into the e2smbuffer
-    Bytee_array_t ba = {.buf = (uint8_t *) malloc (2048), .len = 2048};
-    asn_enc_rval_t encodedMsg = asn_encode_to_buffer(
-        opt_cod, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_RANfunction_Description, descriptor,ba.buf,ba.len);
-
-    if (encodedMsg.encoded < 0)
-      {
-        printf("I am Hereeeeeeeeeeeeeeeeeeeeeeee");
-        
-        NS_FATAL_ERROR ("Error during the encoding of the RIC Indication Header, errno: "
-                        << strerror (errno) << ", failed_type " << encodedMsg.failed_type->name
-                        << ", structure_ptr " << encodedMsg.structure_ptr);
-      }
-
-    m_buffer = ba.buf;
-    m_size = encodedMsg.encoded;
-  }
+  asn_enc_rval_t encodedMsg = EncodeBufferPool::Encode (
+      &asn_DEF_E2SM_KPM_RANfunction_Description, descriptor, &m_buffer, &m_capacity);
+
+  if (encodedMsg.encoded < 0)
+    {
+      NS_FATAL_ERROR ("Error during the encoding of the RAN Function Description, errno: "
+                      << strerror (errno) << ", failed_type " << encodedMsg.failed_type->name
+                      << ", structure_ptr " << encodedMsg.structure_ptr);
+    }
+
+  m_size = encodedMsg.encoded;
 }
 
 
@@ -106,6 +82,7 @@ OCTET_STRING_t KpmFunctionDescription::cp_str_to_ba(const char* str)
       assert(asn.buf != NULL && "Memory exhausted");
 
       memcpy(asn.buf, str, sz);
+    asn.size = sz;
 
     // asn.buf = (uint8_t*) calloc(sizeof(x) + 1, sizeof(char));
     // memcpy(asn.buf,&x,sizeof(x));
@@ -195,6 +172,25 @@ meas_item->measName = cp_str_to_ba(act);
 
   ASN_SEQUENCE_ADD (&report_style->measInfo_Action_List.list, meas_item);
 
+  // the KPIs and histograms of the schema, with their measurement IDs, which
+  // the RIC may subscribe to receive the IDs instead of the names
+  auto addMeasurement = [this, report_style] (const char *name, long measId) {
+    MeasurementInfo_Action_Item_t *item =
+        (MeasurementInfo_Action_Item_t *) calloc (1, sizeof (MeasurementInfo_Action_Item_t));
+    item->measName = cp_str_to_ba (name);
+    item->measID = (MeasurementTypeID_t *) calloc (1, sizeof (MeasurementTypeID_t));
+    *item->measID = measId;
+    ASN_SEQUENCE_ADD (&report_style->measInfo_Action_List.list, item);
+  };
+  for (const KpiDescriptor &descriptor : KPI_SCHEMA)
+    {
+      addMeasurement (descriptor.m_name, GetMeasId (descriptor.m_id));
+    }
+  for (const KpiHistogram &histogram : KPI_HISTOGRAMS)
+    {
+      addMeasurement (histogram.m_name, GetHistogramMeasId (histogram));
+    }
+
  ranfunc_desc->ric_ReportStyle_List =
        (E2SM_KPM_RANfunction_Description::E2SM_KPM_RANfunction_Description__ric_ReportStyle_List *)
            calloc (1, sizeof (E2SM_KPM_RANfunction_Description::
@@ -30,8 +30,24 @@
 
 #include <ns3/kpm-indication.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/asn1c-alloc.h>
+#include <ns3/asn1c-arena.h>
+#include <ns3/encode-buffer-pool.h>
+#include <ns3/measurement-name-registry.h>
 #include <ns3/log.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
 extern "C" {
 #include "E2SM-KPM-IndicationHeader-Format1.h"
 #include "E2SM-KPM-IndicationMessage-Format1.h"
@@ -92,19 +108,209 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("KpmIndication");
 
+/**
+* Identifies the nodes sharing the same header encoding
+*/
+struct KpmHeaderTemplateKey
+{
+  KpmIndicationHeader::GlobalE2nodeType m_nodeType;
+  std::string m_gnbId;
+  std::string m_plmId;
+  uint16_t m_nrCellId;
+
+  bool
+  operator< (const KpmHeaderTemplateKey &other) const
+  {
+    return std::tie (m_nodeType, m_gnbId, m_plmId, m_nrCellId) <
+           std::tie (other.m_nodeType, other.m_gnbId, other.m_plmId, other.m_nrCellId);
+  }
+};
+
+/**
+* Encoded header with the position of the collection timestamp
+*/
+struct KpmHeaderTemplate
+{
+  std::vector<uint8_t> m_encoded;
+  size_t m_timestampBitOffset; //!< position of the 64-bit timestamp, NO_OFFSET if it cannot be patched
+};
+
+static const size_t NO_OFFSET = static_cast<size_t> (-1);
+// sentinels used to locate the timestamp, chosen to be unlikely anywhere else
+static const uint64_t TIMESTAMP_SENTINEL = 0xA55AC33C0FF0E11EULL;
+
+static std::map<KpmHeaderTemplateKey, std::shared_ptr<const KpmHeaderTemplate>> g_headerTemplates;
+static std::mutex g_headerTemplatesMutex;
+static std::atomic<bool> g_validateHeaderTemplates (false);
+
+static uint64_t
+ReadBits64 (const uint8_t *buf, size_t bitOffset)
+{
+  uint64_t value = 0;
+  for (size_t i = 0; i < 64; ++i)
+    {
+      size_t bit = bitOffset + i;
+      value = (value << 1) | ((buf[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+  return value;
+}
+
+static void
+WriteBits64 (uint8_t *buf, size_t bitOffset, uint64_t value)
+{
+  if (bitOffset % 8 == 0)
+    {
+      uint64_t bigEndian = htobe64 (value);
+      memcpy (buf + bitOffset / 8, &bigEndian, sizeof (bigEndian));
+      return;
+    }
+  for (size_t i = 0; i < 64; ++i)
+    {
+      size_t bit = bitOffset + i;
+      uint8_t mask = 1 << (7 - bit % 8);
+      if ((value >> (63 - i)) & 1)
+        {
+          buf[bit / 8] |= mask;
+        }
+      else
+        {
+          buf[bit / 8] &= ~mask;
+        }
+    }
+}
+
 KpmIndicationHeader::KpmIndicationHeader (GlobalE2nodeType nodeType,
                                           KpmRicIndicationHeaderValues values)
 {
   m_nodeType = nodeType;
-  E2SM_KPM_IndicationHeader_t *descriptor = new E2SM_KPM_IndicationHeader_t;
+  m_buffer = nullptr;
+  m_size = 0;
+  m_capacity = 0;
+  EncodeFromTemplate (values);
+}
+
+void
+KpmIndicationHeader::SetTemplateValidation (bool validate)
+{
+  g_validateHeaderTemplates = validate;
+}
+
+void
+KpmIndicationHeader::ClearTemplateCache ()
+{
+  std::lock_guard<std::mutex> lock (g_headerTemplatesMutex);
+  g_headerTemplates.clear ();
+}
+
+void
+KpmIndicationHeader::EncodeWithAsn1c (const KpmRicIndicationHeaderValues &values)
+{
+  EncodeBufferPool::Release (m_buffer, m_capacity);
+  m_buffer = nullptr;
+  E2SM_KPM_IndicationHeader_t *descriptor = new E2SM_KPM_IndicationHeader_t ();
   FillAndEncodeKpmRicIndicationHeader (descriptor, values);
   delete descriptor;
 }
 
+void
+KpmIndicationHeader::EncodeFromTemplate (const KpmRicIndicationHeaderValues &values)
+{
+  KpmHeaderTemplateKey key = {m_nodeType, values.m_gnbId, values.m_plmId, values.m_nrCellId};
+  std::shared_ptr<const KpmHeaderTemplate> cached;
+  {
+    std::lock_guard<std::mutex> lock (g_headerTemplatesMutex);
+    auto it = g_headerTemplates.find (key);
+    if (it != g_headerTemplates.end ())
+      {
+        cached = it->second;
+      }
+  }
+
+  if (!cached)
+    {
+      KpmHeaderTemplate headerTemplate;
+      // encode with a sentinel timestamp and look for it in the output
+      KpmRicIndicationHeaderValues sentinelValues = values;
+      sentinelValues.m_timestamp = TIMESTAMP_SENTINEL;
+      EncodeWithAsn1c (sentinelValues);
+      const uint8_t *encoded = (const uint8_t *) m_buffer;
+      headerTemplate.m_encoded.assign (encoded, encoded + m_size);
+      headerTemplate.m_timestampBitOffset = NO_OFFSET;
+      for (size_t offset = 0; offset + 64 <= m_size * 8; ++offset)
+        {
+          if (ReadBits64 (encoded, offset) == TIMESTAMP_SENTINEL)
+            {
+              if (headerTemplate.m_timestampBitOffset != NO_OFFSET)
+                {
+                  // ambiguous, do not patch
+                  headerTemplate.m_timestampBitOffset = NO_OFFSET;
+                  break;
+                }
+              headerTemplate.m_timestampBitOffset = offset;
+            }
+        }
+
+      // confirm with a second timestamp that only those 64 bits change
+      if (headerTemplate.m_timestampBitOffset != NO_OFFSET)
+        {
+          sentinelValues.m_timestamp = ~TIMESTAMP_SENTINEL;
+          EncodeWithAsn1c (sentinelValues);
+          std::vector<uint8_t> patched = headerTemplate.m_encoded;
+          WriteBits64 (patched.data (), headerTemplate.m_timestampBitOffset, ~TIMESTAMP_SENTINEL);
+          if (m_size != patched.size () || memcmp (m_buffer, patched.data (), m_size) != 0)
+            {
+              headerTemplate.m_timestampBitOffset = NO_OFFSET;
+            }
+        }
+
+      if (headerTemplate.m_timestampBitOffset == NO_OFFSET)
+        {
+          NS_LOG_WARN ("Timestamp not found in the encoded KPM header of cell "
+                       << values.m_nrCellId << ", the header will be encoded every time");
+        }
+      else
+        {
+          NS_LOG_LOGIC ("KPM header template for cell " << values.m_nrCellId << ": "
+                        << headerTemplate.m_encoded.size () << " bytes, timestamp at bit "
+                        << headerTemplate.m_timestampBitOffset);
+        }
+
+      cached = std::make_shared<const KpmHeaderTemplate> (std::move (headerTemplate));
+      std::lock_guard<std::mutex> lock (g_headerTemplatesMutex);
+      g_headerTemplates[key] = cached;
+    }
+
+  const KpmHeaderTemplate &headerTemplate = *cached;
+  if (headerTemplate.m_timestampBitOffset == NO_OFFSET)
+    {
+      EncodeWithAsn1c (values);
+      return;
+    }
+
+  EncodeBufferPool::Release (m_buffer, m_capacity);
+  m_size = headerTemplate.m_encoded.size ();
+  m_buffer = EncodeBufferPool::Get ()->Acquire (m_size, &m_capacity);
+  NS_ABORT_MSG_IF (m_buffer == nullptr, "Memory exhausted while copying the KPM header");
+  memcpy (m_buffer, headerTemplate.m_encoded.data (), m_size);
+  WriteBits64 ((uint8_t *) m_buffer, headerTemplate.m_timestampBitOffset, values.m_timestamp);
+
+  if (g_validateHeaderTemplates)
+    {
+      std::vector<uint8_t> patched ((uint8_t *) m_buffer, (uint8_t *) m_buffer + m_size);
+      EncodeWithAsn1c (values);
+      if (m_size != patched.size () || memcmp (m_buffer, patched.data (), m_size) != 0)
+        {
+          NS_FATAL_ERROR ("Patched KPM header of cell " << values.m_nrCellId
+                          << " differs from the asn1c encoding, timestamp "
+                          << values.m_timestamp);
+        }
+    }
+}
+
 KpmIndicationHeader::~KpmIndicationHeader ()
 {
   NS_LOG_FUNCTION (this);
-  free (m_buffer);
+  EncodeBufferPool::Release (m_buffer, m_capacity);
   m_size = 0;
 }
 
@@ -145,7 +351,7 @@ OCTET_STRING_t KpmIndicationHeader::get_time_now_us() {
   
   OCTET_STRING_t dst = {0};
   
-  dst.buf = (uint8_t*)calloc(byteArray.size(), sizeof(uint8_t)); 
+  dst.buf = (uint8_t*)ASN1C_CALLOC ("KpmIndicationHeader", byteArray.size(), sizeof(uint8_t)); 
   dst.size = byteArray.size();
 
   memcpy(dst.buf, byteArray.data(), dst.size);
@@ -156,7 +362,7 @@ OCTET_STRING_t KpmIndicationHeader::get_time_now_us() {
 OCTET_STRING_t KpmIndicationHeader::int_64_to_octet_string(uint64_t x) {
     OCTET_STRING_t asn = {0};
 
-    asn.buf = (uint8_t*) calloc(sizeof(x) + 1, sizeof(char));
+    asn.buf = (uint8_t*) ASN1C_CALLOC ("KpmIndicationHeader", sizeof(x) + 1, sizeof(char));
     memcpy(asn.buf,&x,sizeof(x));
     asn.size = sizeof(x);
 
@@ -188,20 +394,18 @@ uint64_t KpmIndicationHeader::octet_string_to_int_64(OCTET_STRING_t asn) {
 
 void
 KpmIndicationHeader::Encode (E2SM_KPM_IndicationHeader_t *descriptor) {
-  asn_codec_ctx_t *opt_cod = 0; // disable stack bounds checking
-  asn_encode_to_new_buffer_result_s encodedHeader = asn_encode_to_new_buffer (
-      opt_cod, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationHeader, descriptor);
+  asn_enc_rval_t encodedHeader = EncodeBufferPool::Encode (
+      &asn_DEF_E2SM_KPM_IndicationHeader, descriptor, &m_buffer, &m_capacity);
 
-  if (encodedHeader.result.encoded < 0)
+  if (encodedHeader.encoded < 0)
     {
       NS_FATAL_ERROR ("*Error during the encoding of the RIC Indication Header, errno: "
                       << strerror (errno) << ", failed_type "
-                      << encodedHeader.result.failed_type->name << ", structure_ptr "
-                      << encodedHeader.result.structure_ptr);
+                      << encodedHeader.failed_type->name << ", structure_ptr "
+                      << encodedHeader.structure_ptr);
     }
 
-  m_buffer = encodedHeader.buffer;
-  m_size = encodedHeader.result.encoded;
+  m_size = encodedHeader.encoded;
 }
 //Update by Jlee
 void
@@ -220,8 +424,9 @@ KpmIndicationHeader::FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHea
   */
   NS_LOG_INFO ("FillAndEncodeKpmRicIndicationHeader");
 
-  E2SM_KPM_IndicationHeader_Format1_t *ind_header = (E2SM_KPM_IndicationHeader_Format1_t *) calloc (
-      1, sizeof (E2SM_KPM_IndicationHeader_Format1_t));
+  E2SM_KPM_IndicationHeader_Format1_t *ind_header =
+      (E2SM_KPM_IndicationHeader_Format1_t *) ASN1C_CALLOC (
+          "KpmIndicationHeader", 1, sizeof (E2SM_KPM_IndicationHeader_Format1_t));
 
   NS_LOG_DEBUG ("Timestamp received: " << values.m_timestamp);
   long bigEndianTimestamp = htobe64 (values.m_timestamp);
@@ -240,20 +445,281 @@ KpmIndicationHeader::FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHea
   ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationHeader_Format1, ind_header);
 }
 
-KpmIndicationMessage::KpmIndicationMessage (KpmIndicationMessageValues values) {
+/**
+* \return for each column of kpis, 1 if the KPI is subscribed and is
+*         encoded, or an empty vector when every column is encoded
+*/
+static std::vector<uint8_t>
+SelectColumns (const KpiTable &kpis, Ptr<KpmSubscriptionFilter> subscription)
+{
+  std::vector<uint8_t> selected;
+  if (subscription)
+    {
+      selected.resize (kpis.GetColumnCount ());
+      for (size_t column = 0; column < kpis.GetColumnCount (); ++column)
+        {
+          selected[column] = subscription->IsSubscribed (kpis.GetColumnName (column));
+        }
+    }
+  return selected;
+}
+
+/**
+* \return the number of values of the slot in the columns returned by
+*         SelectColumns
+*/
+static size_t
+CountSelectedValues (const KpiTable &kpis, size_t slot, const std::vector<uint8_t> &selected)
+{
+  if (selected.empty ())
+    {
+      return kpis.GetValueCount (slot);
+    }
+  size_t count = 0;
+  for (size_t column = 0; column < selected.size (); ++column)
+    {
+      count += selected[column] && kpis.HasValue (slot, column);
+    }
+  return count;
+}
+
+/**
+* The entities and the KPIs of a batched report: every UE, or the cell,
+* and every KPI with a value in any granularity period, holding its latest
+* value. The UEs of the latest period keep their slots, the others follow.
+* Only used to select the slots and the columns, the records of each
+* period are read from the table of the period, see KpiHistory.
+*
+* \param latest the KPIs of the latest period
+* \param periods the KPIs of the earlier periods, oldest first
+* \return the KPIs of every period
+*/
+static KpiTable
+MergeKpiHistory (const KpiTable &latest, const std::vector<KpiTable> &periods)
+{
+  KpiTable merged = latest;
+  for (auto period = periods.rbegin (); period != periods.rend (); ++period)
+    {
+      for (size_t column = 0; column < period->GetColumnCount (); ++column)
+        {
+          KpiTable::ValueType type = period->GetColumnType (column);
+          size_t mergedColumn = merged.GetColumn (period->GetColumnName (column), type);
+          for (size_t slot = 0; slot < period->GetSlotCount (); ++slot)
+            {
+              if (!period->HasValue (slot, column))
+                {
+                  continue;
+                }
+              size_t mergedSlot = merged.GetSlot (period->GetId (slot));
+              if (merged.HasValue (mergedSlot, mergedColumn))
+                {
+                  continue;
+                }
+              if (type == KpiTable::INTEGER)
+                {
+                  merged.SetInteger (mergedSlot, mergedColumn, period->GetInteger (slot, column));
+                }
+              else
+                {
+                  merged.SetReal (mergedSlot, mergedColumn, period->GetReal (slot, column));
+                }
+            }
+        }
+    }
+  return merged;
+}
+
+/**
+* \return true if the values are reported in a cell-level Format 1 message
+*/
+static bool
+IsCellLevel (const KpmIndicationMessage::KpmIndicationMessageValues &values)
+{
+  return values.m_subscription && values.m_subscription->IsCellLevel ();
+}
+
+KpmIndicationMessage::KpmIndicationMessage (const KpmIndicationMessageValues &values) {
+  E2SM_KPM_IndicationMessage_t *descriptor = new E2SM_KPM_IndicationMessage_t ();
+  CheckConstraints (values);
+  if (IsCellLevel (values))
+    {
+      FillAndEncodeKpmCellIndicationMessage (descriptor, values);
+    }
+  else
+    {
+      FillAndEncodeKpmIndicationMessage (descriptor, values, nullptr);
+    }
+  delete descriptor;
+}
+
+KpmIndicationMessage::KpmIndicationMessage (const KpmIndicationMessageValues &values,
+                                            const std::vector<size_t> &ueSlots)
+{
+  NS_ABORT_MSG_IF (!values.m_ueIndications.empty (),
+                   "Legacy UE indications must be merged before selecting UE slots");
   E2SM_KPM_IndicationMessage_t *descriptor = new E2SM_KPM_IndicationMessage_t ();
   CheckConstraints (values);
-  FillAndEncodeKpmIndicationMessage (descriptor, values);
+  FillAndEncodeKpmIndicationMessage (descriptor, values, &ueSlots);
   delete descriptor;
 }
 
+KpmIndicationMessage::KpmIndicationMessage (Ptr<KpmReportTree> tree, size_t begin, size_t count)
+{
+  NS_ABORT_MSG_IF (begin + count > tree->m_reports.size (), "UE reports out of the tree");
+  E2SM_KPM_IndicationMessage_t *descriptor = new E2SM_KPM_IndicationMessage_t ();
+  if (count == 0)
+    {
+      std::vector<size_t> noSlots;
+      FillAndEncodeKpmIndicationMessage (descriptor, KpmIndicationMessageValues (), &noSlots);
+      delete descriptor;
+      return;
+    }
+
+  // the list borrows the items of the tree, nothing is freed here
+  E2SM_KPM_IndicationMessage_Format3_t *format3 = new E2SM_KPM_IndicationMessage_Format3_t ();
+  format3->ueMeasReportList.list.array = tree->m_reports.data () + begin;
+  format3->ueMeasReportList.list.count = count;
+  format3->ueMeasReportList.list.size = count;
+  descriptor->indicationMessage_formats.present =
+      E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format3;
+  descriptor->indicationMessage_formats.choice.indicationMessage_Format3 = format3;
+
+  NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_KPM_IndicationMessage, descriptor));
+  Encode (descriptor);
+  delete format3;
+  delete descriptor;
+}
+
+uint32_t
+KpmIndicationMessage::BuildIndications (const KpmIndicationMessageValues &values, uint32_t maxUes,
+                                        uint32_t maxSize,
+                                        std::function<void (Ptr<KpmIndicationMessage>)> sink,
+                                        Ptr<KpmReportTree> tree)
+{
+  if (IsCellLevel (values))
+    {
+      sink (Create<KpmIndicationMessage> (values));
+      return 1;
+    }
+  if (tree && values.m_ueKpiHistory.empty ())
+    {
+      return BuildIndications (tree, tree->Update (values), maxUes, maxSize, sink);
+    }
+
+  const KpmIndicationMessageValues *source = &values;
+  KpmIndicationMessageValues merged;
+  if (!values.m_ueIndications.empty ())
+    {
+      merged = values;
+      merged.m_ueKpis = MergeLegacyUeIndications (values);
+      merged.m_ueIndications.clear ();
+      source = &merged;
+    }
+
+  // a UE reported in any of the batched periods is reported
+  const KpiTable *ueKpis = &source->m_ueKpis;
+  KpiTable batchedUeKpis;
+  if (!source->m_ueKpiHistory.empty ())
+    {
+      batchedUeKpis = MergeKpiHistory (source->m_ueKpis, source->m_ueKpiHistory);
+      ueKpis = &batchedUeKpis;
+    }
+  std::vector<uint8_t> selected = SelectColumns (*ueKpis, source->m_subscription);
+  std::vector<size_t> slots;
+  for (size_t slot = 0; slot < ueKpis->GetSlotCount (); ++slot)
+    {
+      if (CountSelectedValues (*ueKpis, slot, selected) > 0)
+        {
+          slots.push_back (slot);
+        }
+    }
+  if (slots.empty ())
+    {
+      // a single message carrying the placeholder report
+      sink (Create<KpmIndicationMessage> (*source, slots));
+      return 1;
+    }
+
+  uint32_t messages = 0;
+  size_t chunk = maxUes > 0 ? maxUes : slots.size ();
+  size_t begin = 0;
+  while (begin < slots.size ())
+    {
+      size_t count = std::min (chunk, slots.size () - begin);
+      std::vector<size_t> chunkSlots (slots.begin () + begin, slots.begin () + begin + count);
+      Ptr<KpmIndicationMessage> msg = Create<KpmIndicationMessage> (*source, chunkSlots);
+
+      if (maxSize > 0 && msg->m_size > maxSize)
+        {
+          if (count > 1)
+            {
+              // scale the chunk on the measured size per UE and retry
+              chunk = std::max<size_t> (1, count * maxSize / msg->m_size);
+              chunk = std::min (chunk, count - 1);
+              NS_LOG_LOGIC ("Indication of " << count << " UEs takes " << msg->m_size
+                                             << " bytes, retrying with " << chunk << " UEs");
+              continue;
+            }
+          NS_LOG_WARN ("The report of UE " << ueKpis->GetId (chunkSlots[0])
+                                           << " alone exceeds " << maxSize << " bytes");
+        }
+
+      sink (msg);
+      messages++;
+      begin += count;
+    }
+  NS_LOG_LOGIC ("Report of " << slots.size () << " UEs split in " << messages << " indications");
+  return messages;
+}
+
+uint32_t
+KpmIndicationMessage::BuildIndications (Ptr<KpmReportTree> tree, size_t ueCount, uint32_t maxUes,
+                                        uint32_t maxSize,
+                                        std::function<void (Ptr<KpmIndicationMessage>)> sink)
+{
+  if (ueCount == 0)
+    {
+      sink (Create<KpmIndicationMessage> (tree, 0, 0));
+      return 1;
+    }
+
+  // same splitting as above, on ranges of the tree
+  uint32_t messages = 0;
+  size_t chunk = maxUes > 0 ? maxUes : ueCount;
+  size_t begin = 0;
+  while (begin < ueCount)
+    {
+      size_t count = std::min (chunk, ueCount - begin);
+      Ptr<KpmIndicationMessage> msg = Create<KpmIndicationMessage> (tree, begin, count);
+
+      if (maxSize > 0 && msg->m_size > maxSize)
+        {
+          if (count > 1)
+            {
+              chunk = std::max<size_t> (1, count * maxSize / msg->m_size);
+              chunk = std::min (chunk, count - 1);
+              NS_LOG_LOGIC ("Indication of " << count << " UEs takes " << msg->m_size
+                                             << " bytes, retrying with " << chunk << " UEs");
+              continue;
+            }
+          NS_LOG_WARN ("The report of a UE alone exceeds " << maxSize << " bytes");
+        }
+
+      sink (msg);
+      messages++;
+      begin += count;
+    }
+  NS_LOG_LOGIC ("Report of " << ueCount << " UEs split in " << messages << " indications");
+  return messages;
+}
+
 KpmIndicationMessage::~KpmIndicationMessage () {
-  free (m_buffer);
+  EncodeBufferPool::Release (m_buffer, m_capacity);
   m_size = 0;
 }
 
 void
-KpmIndicationMessage::CheckConstraints (KpmIndicationMessageValues values)
+KpmIndicationMessage::CheckConstraints (const KpmIndicationMessageValues &values)
 {
 }
 
@@ -265,309 +731,1150 @@ typedef struct
 
 void
 KpmIndicationMessage::Encode (E2SM_KPM_IndicationMessage_t *descriptor) {
-      printf ("[JLEE: Encoding E2SM KPM Indicatin Message] ");
-      asn_codec_ctx_t *opt_cod = 0; // disable stack bounds checking
-      asn_encode_to_new_buffer_result_s encodedMsg = asn_encode_to_new_buffer (
-          opt_cod, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage, descriptor);
+      asn_enc_rval_t encodedMsg = EncodeBufferPool::Encode (
+          &asn_DEF_E2SM_KPM_IndicationMessage, descriptor, &m_buffer, &m_capacity);
 
-      if (encodedMsg.result.encoded < 0)
+      if (encodedMsg.encoded < 0)
         {
-          assert (encodedMsg.result.structure_ptr != nullptr);
+          assert (encodedMsg.structure_ptr != nullptr);
           NS_FATAL_ERROR ("Error during the encoding of the RIC Indication Message, errno: "
                           << strerror (errno) << ", failed_type "
-                          << encodedMsg.result.failed_type->name << ", structure_ptr "
-                          << encodedMsg.result.structure_ptr);
+                          << encodedMsg.failed_type->name << ", structure_ptr "
+                          << encodedMsg.structure_ptr);
         }
 
-      m_buffer = encodedMsg.buffer;
-      m_size = encodedMsg.result.encoded;
+      m_size = encodedMsg.encoded;
+}
+
+/**
+* Writes value as the minimal big-endian two's complement content of an
+* INTEGER, with the buffer taken from the arena (asn_ulong2INTEGER would
+* free and malloc the buffer behind the arena's back)
+*/
+static void
+FillArenaInteger (Asn1Arena &arena, INTEGER_t *integer, unsigned long value)
+{
+  uint8_t bytes[sizeof (unsigned long) + 1];
+  size_t size = 0;
+  do
+    {
+      bytes[sizeof (bytes) - 1 - size++] = value & 0xff;
+      value >>= 8;
+    }
+  while (value != 0);
+  // keep the value positive
+  if (bytes[sizeof (bytes) - size] & 0x80)
+    {
+      bytes[sizeof (bytes) - 1 - size++] = 0;
+    }
+  integer->buf = arena.CopyBytes (bytes + sizeof (bytes) - size, size);
+  integer->size = size;
+}
+
+static void
+FillArenaBitString (Asn1Arena &arena, BIT_STRING_t *dst, const uint8_t *src, size_t size,
+                    int bitsUnused)
+{
+  dst->buf = arena.CopyBytes (src, size);
+  dst->size = size;
+  dst->bits_unused = bitsUnused;
+}
+
+static void
+FillArenaPlmnIdentity (Asn1Arena &arena, PLMNIdentity_t *dst, uint16_t mcc, uint16_t mnc,
+                       uint8_t mncDigitLength)
+{
+  uint8_t plmn[3];
+  plmn[0] = (((mcc / 10) % 10) << 4) | (mcc / 100);
+  plmn[1] = ((mncDigitLength == 2 ? 15 : mnc / 100) << 4) | (mcc % 10);
+  plmn[2] = ((mnc % 10) << 4) | ((mnc / 10) % 10);
+  dst->buf = arena.CopyBytes (plmn, sizeof (plmn));
+  dst->size = sizeof (plmn);
+}
+
+static const uint16_t DEFAULT_UE_MCC = 111;
+static const uint16_t DEFAULT_UE_MNC = 11;
+static const uint64_t MAX_AMF_UE_NGAP_ID = (1ULL << 40) - 1;
+
+static const size_t IMSI_DIGITS = 15;
+static const size_t MAX_NUMERIC_UE_ID_DIGITS = 19; //!< fits in 64 bits
+
+/**
+* A cached gNB UE ID, in an arena of its own so that it can be evicted
+*/
+struct CachedUeId
+{
+  CachedUeId () : m_arena (256), m_ueId (nullptr), m_references (0), m_evicted (false)
+  {
+  }
+
+  Asn1Arena m_arena;
+  UEID_GNB_t *m_ueId;
+  uint64_t m_references; //!< taken by Acquire
+  bool m_evicted; //!< freed once unreferenced
+};
+
+static std::mutex g_ueIdCacheMutex;
+static std::unordered_map<uint64_t, std::unique_ptr<CachedUeId>> g_ueIdCache;
+
+KpmUeIdCache::UeIdentity
+KpmUeIdCache::GetIdentity (const std::string &ueId)
+{
+  UeIdentity identity;
+  bool isNumeric =
+      !ueId.empty () && ueId.size () <= MAX_NUMERIC_UE_ID_DIGITS &&
+      std::all_of (ueId.begin (), ueId.end (), [] (char c) { return c >= '0' && c <= '9'; });
+  if (isNumeric)
+    {
+      identity.m_imsi = std::stoull (ueId);
+      if (ueId.size () == IMSI_DIGITS)
+        {
+          identity.m_mcc = std::stoi (ueId.substr (0, 3));
+          identity.m_mnc = std::stoi (ueId.substr (3, 2));
+          identity.m_amfUeNgapId = std::stoull (ueId.substr (5));
+        }
+      else
+        {
+          identity.m_mcc = DEFAULT_UE_MCC;
+          identity.m_mnc = DEFAULT_UE_MNC;
+          identity.m_amfUeNgapId = identity.m_imsi & MAX_AMF_UE_NGAP_ID;
+        }
+    }
+  else
+    {
+      // FNV-1a, stable across runs and platforms
+      uint64_t hash = 0xcbf29ce484222325ULL;
+      for (char c : ueId)
+        {
+          hash = (hash ^ (uint8_t) c) * 0x100000001b3ULL;
+        }
+      identity.m_imsi = hash;
+      identity.m_mcc = DEFAULT_UE_MCC;
+      identity.m_mnc = DEFAULT_UE_MNC;
+      identity.m_amfUeNgapId = hash & MAX_AMF_UE_NGAP_ID;
+    }
+  return identity;
+}
+
+UEID_GNB_t *
+KpmUeIdCache::Acquire (const std::string &ueId)
+{
+  UeIdentity identity = GetIdentity (ueId);
+  std::lock_guard<std::mutex> lock (g_ueIdCacheMutex);
+  std::unique_ptr<CachedUeId> &cached = g_ueIdCache[identity.m_imsi];
+  if (cached)
+    {
+      // reported again, or by another tree
+      cached->m_evicted = false;
+      cached->m_references++;
+      return cached->m_ueId;
+    }
+
+  NS_LOG_LOGIC ("Building the UE ID of UE " << ueId);
+  cached.reset (new CachedUeId ());
+  cached->m_references = 1;
+  Asn1Arena &arena = cached->m_arena;
+  UEID_GNB_t *gnbUeId = arena.New<UEID_GNB_t> ();
+  cached->m_ueId = gnbUeId;
+  FillArenaInteger (arena, &gnbUeId->amf_UE_NGAP_ID, identity.m_amfUeNgapId);
+
+  const uint8_t zeros[2] = {0, 0};
+  FillArenaBitString (arena, &gnbUeId->guami.aMFPointer, zeros, 1, 2);
+  FillArenaBitString (arena, &gnbUeId->guami.aMFSetID, zeros, 2, 6);
+  FillArenaBitString (arena, &gnbUeId->guami.aMFRegionID, zeros, 1, 0);
+  FillArenaPlmnIdentity (arena, &gnbUeId->guami.pLMNIdentity, identity.m_mcc, identity.m_mnc, 2);
+
+  uint8_t ranUeId[8];
+  for (size_t i = 0; i < sizeof (ranUeId); ++i)
+    {
+      ranUeId[i] = identity.m_imsi >> (8 * (sizeof (ranUeId) - 1 - i));
+    }
+  gnbUeId->ran_UEID = arena.New<RANUEID_t> ();
+  gnbUeId->ran_UEID->buf = arena.CopyBytes (ranUeId, sizeof (ranUeId));
+  gnbUeId->ran_UEID->size = sizeof (ranUeId);
+  return gnbUeId;
 }
 
-//update by jlee
 void
-KpmIndicationMessage::FillAndEncodeKpmIndicationMessage (E2SM_KPM_IndicationMessage_t *descriptor,
-                                                         KpmIndicationMessageValues values)
-{
- /* KPM_Indication_Message (descriptor)
-  - present
-    - E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_NOTHING
-    - E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format1,
-    - E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format2,
-    - E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format3,
-  - choice
-    - choice.indicationMessage_Format1 
-    - choice.indicationMessage_Format2 
-    - choice.indicationMessage_Format3 
+KpmUeIdCache::Release (const std::string &ueId, bool evict)
+{
+  UeIdentity identity = GetIdentity (ueId);
+  std::lock_guard<std::mutex> lock (g_ueIdCacheMutex);
+  auto it = g_ueIdCache.find (identity.m_imsi);
+  NS_ASSERT_MSG (it != g_ueIdCache.end () && it->second->m_references > 0,
+                 "UE ID of UE " << ueId << " released but not acquired");
+  CachedUeId &cached = *it->second;
+  cached.m_references--;
+  cached.m_evicted = cached.m_evicted || evict;
+  if (cached.m_references == 0 && cached.m_evicted)
+    {
+      NS_LOG_LOGIC ("Evicting the UE ID of UE " << ueId);
+      g_ueIdCache.erase (it);
+    }
+}
 
+size_t
+KpmUeIdCache::GetSize ()
+{
+  std::lock_guard<std::mutex> lock (g_ueIdCacheMutex);
+  return g_ueIdCache.size ();
+}
+
+/**
+* Points the UE ID of a UE measurement report item to the cached gNB UE ID
 */
+static void
+SetUeId (UEID_t *ueId, UEID_GNB_t *gnbUeId)
+{
+  ueId->present = UEID_PR_gNB_UEID;
+  ueId->choice.gNB_UEID = gnbUeId;
+}
 
-/*
-indicationMessage_Format3
- - ueMeasReportList
-   - list (UEMeasurementReportItem)
-     - ueID
-     - measReport (Format1)
-
-indicationMessage_Format1
-  - measData->list (item 별로)->measRecodr->list (1개만 사용)-> (present, choice.integer/real) <== 값 적용  
-  - *measInfoList-> (item 별로)->measType->list (1개만 사용)-> 
-     -> measType (present, choice.measName/measID : measName 부터 사용), labelInfoList.nolabel= 0
+static const size_t NOT_FOUND = static_cast<size_t> (-1);
+
+static std::atomic<bool> g_histogramLabels (true);
+
+void
+KpmIndicationMessage::SetHistogramLabels (bool enable)
+{
+  g_histogramLabels = enable;
+}
+
+/**
+* How a column of a KPI table is encoded, found once per message rather
+* than once per UE
 */
-      /* Format 1 Message*/
-      /*
-      format1message
-       - measData
-         - list (MeasurementDataItem : measRecord)
-           - measRecord
-             - list (MeasurementRecordItem)
-                - present (MeasurementRecordItem_PR_integer, MeasurementRecordItem_PR_real)
-                - choice (integer, double)
-       - *measInfoList (option)
-          - list (MeasurementInfoItem : measType + labelInfoList)
-            - measType
-              - present (MeasurementType_PR_measName, MeasurementType_PR_measID)
-              - choice (measName, measID)
-            - labelInfoList
-              - list (LabelInfoItem: measLabel)
-                 - measLabel 
-                   - *noLabel = 0      
-      */
+struct ColumnEncoding
+{
+  const MeasurementTypeName_t *m_name; //!< interned measurement name, the histogram's for a bin
+  long m_measId; //!< measurement ID, if the RIC subscribed the KPI by ID, 0 to encode the name
+  long m_bin; //!< distBinX label of a histogram bin, 0 for any other KPI
+  size_t m_group; //!< first column of the histogram of a bin, the column itself otherwise
+};
+
+/**
+* \param kpis the KPIs of the message
+* \param subscription the subscription of the message, if any
+* \return the encoding of each column of kpis
+*/
+static std::vector<ColumnEncoding>
+GetColumnEncodings (const KpiTable &kpis, Ptr<KpmSubscriptionFilter> subscription)
+{
+  std::vector<ColumnEncoding> encodings (kpis.GetColumnCount ());
+  std::vector<std::pair<const KpiHistogram *, size_t>> groups;
+  for (size_t column = 0; column < kpis.GetColumnCount (); ++column)
+    {
+      const std::string &name = kpis.GetColumnName (column);
+      ColumnEncoding &encoding = encodings[column];
+      encoding.m_measId = 0;
+      encoding.m_bin = 0;
+      encoding.m_group = column;
+      kpi::Id id = FindKpi (name);
+      if (id == kpi::COUNT)
+        {
+          encoding.m_name = &MeasurementNameRegistry::Intern (name);
+          continue;
+        }
+      encoding.m_name = &MeasurementNameRegistry::Get (id);
+      bool byMeasId = subscription && subscription->IsSubscribedByMeasId (id);
+      if (byMeasId)
+        {
+          encoding.m_measId = GetMeasId (id);
+        }
 
-  const bool ENABLE_FORMAT_ONE = false; // To be deteted
+      const KpiHistogram *histogram = g_histogramLabels ? FindKpiHistogram (id) : nullptr;
+      if (histogram != nullptr)
+        {
+          encoding.m_name = &MeasurementNameRegistry::Intern (histogram->m_name);
+          encoding.m_measId = byMeasId ? GetHistogramMeasId (*histogram) : 0;
+          encoding.m_bin = histogram->m_binLabels[id - histogram->m_firstBin];
+          auto group = std::find_if (
+              groups.begin (), groups.end (),
+              [histogram] (const std::pair<const KpiHistogram *, size_t> &g) {
+                return g.first == histogram;
+              });
+          if (group == groups.end ())
+            {
+              groups.emplace_back (histogram, column);
+            }
+          else
+            {
+              encoding.m_group = group->second;
+            }
+        }
+    }
+  return encodings;
+}
 
-  if (ENABLE_FORMAT_ONE)
+/**
+* Lists the selected columns with a value in the slot, grouped by
+* measurement: the bins of a histogram follow each other, in column
+* order, and the measurements come in the order of their first column.
+*
+* \param columns the columns, in the order of their records
+* \param itemSizes the number of columns of each measurement
+*/
+static void
+GroupColumns (const KpiTable &kpis, size_t slot, const std::vector<uint8_t> &selected,
+              const std::vector<ColumnEncoding> &encodings, std::vector<size_t> &columns,
+              std::vector<size_t> &itemSizes)
+{
+  columns.clear ();
+  itemSizes.clear ();
+  for (size_t column = 0; column < kpis.GetColumnCount (); ++column)
     {
- 
-      printf ("\n\n  ENABLE_FORMAT_ONE\n ");
+      if (!kpis.HasValue (slot, column) || (!selected.empty () && !selected[column]))
+        {
+          continue;
+        }
+      size_t group = encodings[column].m_group;
+      size_t begin = 0;
+      size_t item = 0;
+      // the bins are usually adjacent columns, so the search is short
+      if (encodings[column].m_bin != 0)
+        {
+          for (; item < itemSizes.size (); ++item)
+            {
+              if (encodings[columns[begin]].m_group == group)
+                {
+                  break;
+                }
+              begin += itemSizes[item];
+            }
+        }
+      else
+        {
+          item = itemSizes.size ();
+        }
 
-      E2SM_KPM_IndicationMessage_t *kpmindmessage = (E2SM_KPM_IndicationMessage_t *) calloc (1, sizeof (E2SM_KPM_IndicationMessage_t));
+      if (item < itemSizes.size ())
+        {
+          columns.insert (columns.begin () + begin + itemSizes[item], column);
+          itemSizes[item]++;
+        }
+      else
+        {
+          columns.push_back (column);
+          itemSizes.push_back (1);
+        }
+    }
+}
 
-      E2SM_KPM_IndicationMessage_Format1_t *format1message = (E2SM_KPM_IndicationMessage_Format1_t *) calloc ( 1, sizeof (E2SM_KPM_IndicationMessage_Format1_t));
+// scratch of the report builders, per thread since the UE reports may be
+// built by the workers
+static thread_local std::vector<size_t> t_columns;
+static thread_local std::vector<size_t> t_itemSizes;
 
-      MeasurementRecord_t *measrecord = (MeasurementRecord_t *) calloc (1, sizeof (MeasurementRecord_t));
-      MeasurementRecordItem_t *measrecorditem = (MeasurementRecordItem_t *) calloc (1, sizeof (MeasurementRecordItem_t));
-      measrecorditem->present = MeasurementRecordItem_PR_integer;
-      measrecorditem->choice.integer = 1;
+/**
+* Sets the record to the value of the KPI in the slot
+*/
+static void
+FillRecord (MeasurementRecordItem_t *record, const KpiTable &kpis, size_t slot, size_t column)
+{
+  if (kpis.GetColumnType (column) == KpiTable::INTEGER)
+    {
+      NS_LOG_DEBUG ("Measurement " << kpis.GetColumnName (column) << " value "
+                                   << kpis.GetInteger (slot, column));
+      record->present = MeasurementRecordItem_PR_integer;
+      record->choice.integer = kpis.GetInteger (slot, column);
+    }
+  else
+    {
+      NS_LOG_DEBUG ("Measurement " << kpis.GetColumnName (column) << " value "
+                                   << kpis.GetReal (slot, column));
+      record->present = MeasurementRecordItem_PR_real;
+      record->choice.real = kpis.GetReal (slot, column);
+    }
+}
 
-      ASN_SEQUENCE_ADD (&measrecord->list, measrecorditem);
+/**
+* Fills the measurement info items of the grouped columns, with a noLabel
+* label for a plain KPI and a distBinX label per bin for a histogram
+*/
+static void
+FillArenaMeasInfoList (Asn1Arena &arena, E2SM_KPM_IndicationMessage_Format1_t *measReport,
+                       const std::vector<ColumnEncoding> &encodings,
+                       const std::vector<size_t> &columns, const std::vector<size_t> &itemSizes)
+{
+  MeasurementInfoItem_t *infoItems = arena.NewArray<MeasurementInfoItem_t> (itemSizes.size ());
+  LabelInfoItem_t *labelItems = arena.NewArray<LabelInfoItem_t> (columns.size ());
+  long *noLabel = arena.New<long> ();
+  *noLabel = MeasurementLabel__noLabel_true;
+
+  measReport->measInfoList = arena.New<MeasurementInfoList_t> ();
+  arena.ReserveList (&measReport->measInfoList->list, itemSizes.size ());
+  size_t i = 0;
+  for (size_t item = 0; item < itemSizes.size (); ++item)
+    {
+      MeasurementInfoItem_t &info = infoItems[item];
+      const ColumnEncoding &encoding = encodings[columns[i]];
+      if (encoding.m_measId != 0)
+        {
+          info.measType.present = MeasurementType_PR_measID;
+          info.measType.choice.measID = encoding.m_measId;
+        }
+      else
+        {
+          info.measType.present = MeasurementType_PR_measName;
+          info.measType.choice.measName = *encoding.m_name;
+        }
+      arena.ReserveList (&info.labelInfoList.list, itemSizes[item]);
+      for (size_t end = i + itemSizes[item]; i < end; ++i)
+        {
+          long bin = encodings[columns[i]].m_bin;
+          if (bin != 0)
+            {
+              labelItems[i].measLabel.distBinX = arena.New<long> ();
+              *labelItems[i].measLabel.distBinX = bin;
+            }
+          else
+            {
+              // the noLabel value is read-only, a single instance serves every item
+              labelItems[i].measLabel.noLabel = noLabel;
+            }
+          ASN_SEQUENCE_ADD (&info.labelInfoList.list, &labelItems[i]);
+        }
+      ASN_SEQUENCE_ADD (&measReport->measInfoList->list, &info);
+    }
+}
 
-      MeasurementDataItem_t *measdataitem = (MeasurementDataItem_t *) calloc (1, sizeof (MeasurementDataItem_t));
+/**
+* Fills a Format 1 measurement report with one measurement info item per
+* selected KPI that has a value in the slot, and a single data item, the
+* collection period, holding their records in the order of the
+* measurement info list: one for a plain KPI, one per bin for a
+* histogram. The measurement names point to the interned names.
+*
+* \return the records, in the order of GroupColumns
+*/
+static MeasurementRecordItem_t *
+FillArenaMeasReport (Asn1Arena &arena, E2SM_KPM_IndicationMessage_Format1_t *measReport,
+                     const KpiTable &kpis, size_t slot, const std::vector<uint8_t> &selected,
+                     const std::vector<ColumnEncoding> &encodings)
+{
+  GroupColumns (kpis, slot, selected, encodings, t_columns, t_itemSizes);
+  size_t count = t_columns.size ();
+  MeasurementDataItem_t *dataItem = arena.New<MeasurementDataItem_t> ();
+  MeasurementRecordItem_t *recordItems = arena.NewArray<MeasurementRecordItem_t> (count);
+
+  arena.ReserveList (&measReport->measData.list, 1);
+  arena.ReserveList (&dataItem->measRecord.list, count);
+  for (size_t i = 0; i < count; ++i)
+    {
+      FillRecord (&recordItems[i], kpis, slot, t_columns[i]);
+      ASN_SEQUENCE_ADD (&dataItem->measRecord.list, &recordItems[i]);
+    }
+  ASN_SEQUENCE_ADD (&measReport->measData.list, dataItem);
+  FillArenaMeasInfoList (arena, measReport, encodings, t_columns, t_itemSizes);
+  return recordItems;
+}
+
+/**
+* The granularity periods of a batched report, with the column of each KPI
+* of the merged table in every period, looked up once per message
+*/
+struct KpiHistory
+{
+  /**
+  * \param merged the KPIs of every period, see MergeKpiHistory
+  * \param latest the KPIs of the latest period
+  * \param periods the KPIs of the earlier periods, oldest first
+  */
+  KpiHistory (const KpiTable &merged, const KpiTable &latest, const std::vector<KpiTable> &periods)
+  {
+    for (const KpiTable &period : periods)
+      {
+        m_periods.push_back (&period);
+      }
+    m_periods.push_back (&latest);
+    m_columns.resize (m_periods.size ());
+    for (size_t p = 0; p < m_periods.size (); ++p)
+      {
+        m_columns[p].resize (merged.GetColumnCount (), NOT_FOUND);
+        for (size_t column = 0; column < merged.GetColumnCount (); ++column)
+          {
+            m_periods[p]->FindColumn (merged.GetColumnName (column), m_columns[p][column]);
+          }
+      }
+  }
 
-      measdataitem->measRecord = *measrecord;
+  std::vector<const KpiTable *> m_periods; //!< oldest first, the latest one last
+  std::vector<std::vector<size_t>> m_columns; //!< per period, the column of each merged column
+};
 
-      MeasurementData_t *measdata =(MeasurementData_t *) calloc (1, sizeof (MeasurementData_t));
+/**
+* Fills a Format 1 measurement report as FillArenaMeasReport does, with
+* one data item per granularity period, oldest first, instead of a single
+* one. A KPI missing from an earlier period is encoded as noValue, so that
+* the records of every item match the measurement info list.
+*/
+static void
+FillArenaBatchedMeasReport (Asn1Arena &arena, E2SM_KPM_IndicationMessage_Format1_t *measReport,
+                            const KpiTable &kpis, size_t slot,
+                            const std::vector<uint8_t> &selected,
+                            const std::vector<ColumnEncoding> &encodings,
+                            const KpiHistory &history, uint32_t granularityPeriod)
+{
+  GroupColumns (kpis, slot, selected, encodings, t_columns, t_itemSizes);
+  size_t count = t_columns.size ();
+  size_t periodCount = history.m_periods.size ();
+
+  MeasurementDataItem_t *dataItems = arena.NewArray<MeasurementDataItem_t> (periodCount);
+  MeasurementRecordItem_t *recordItems =
+      arena.NewArray<MeasurementRecordItem_t> (periodCount * count);
+  arena.ReserveList (&measReport->measData.list, periodCount);
+  for (size_t p = 0; p < periodCount; ++p)
+    {
+      const KpiTable &table = *history.m_periods[p];
+      size_t periodSlot;
+      if (!table.FindSlot (kpis.GetId (slot), periodSlot))
+        {
+          periodSlot = NOT_FOUND;
+        }
+      arena.ReserveList (&dataItems[p].measRecord.list, count);
+      for (size_t i = 0; i < count; ++i)
+        {
+          MeasurementRecordItem_t *record = &recordItems[p * count + i];
+          size_t column = history.m_columns[p][t_columns[i]];
+          if (periodSlot == NOT_FOUND || column == NOT_FOUND || !table.HasValue (periodSlot, column))
+            {
+              record->present = MeasurementRecordItem_PR_noValue;
+            }
+          else
+            {
+              FillRecord (record, table, periodSlot, column);
+            }
+          ASN_SEQUENCE_ADD (&dataItems[p].measRecord.list, record);
+        }
+      ASN_SEQUENCE_ADD (&measReport->measData.list, &dataItems[p]);
+    }
+  FillArenaMeasInfoList (arena, measReport, encodings, t_columns, t_itemSizes);
 
-      ASN_SEQUENCE_ADD (&measdata->list, measdataitem);
+  if (granularityPeriod > 0)
+    {
+      measReport->granulPeriod = arena.New<GranularityPeriod_t> ();
+      *measReport->granulPeriod = granularityPeriod;
+    }
+}
 
-      format1message->measData = *measdata;
+/**
+* Worker threads building the UE measurement report items of a Format 3
+* message. The calling thread takes part in the build as worker 0. Each
+* worker owns an arena that lives until the next build, so the items it
+* fills stay valid until the message has been encoded.
+*/
+class UeReportWorkerPool
+{
+public:
+  typedef std::function<void (Asn1Arena &arena, size_t begin, size_t end)> Job;
+
+  UeReportWorkerPool (uint32_t workers)
+      : m_generation (0), m_pending (0), m_stop (false), m_count (0)
+  {
+    for (uint32_t i = 0; i < workers; ++i)
+      {
+        m_arenas.emplace_back (new Asn1Arena ());
+      }
+    for (uint32_t i = 1; i < workers; ++i)
+      {
+        m_threads.emplace_back (&UeReportWorkerPool::WorkerLoop, this, i);
+      }
+  }
 
-      kpmindmessage->indicationMessage_formats.present = E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format1;
-      kpmindmessage->indicationMessage_formats.choice.indicationMessage_Format1 = format1message;
+  ~UeReportWorkerPool ()
+  {
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stop = true;
+    }
+    m_start.notify_all ();
+    for (auto &thread : m_threads)
+      {
+        thread.join ();
+      }
+  }
 
-      // ASN_SEQUENCE_ADD(&ind_message->indicationMessage_formats.choice.indicationMessage_Format1, test_kpm_ind_message) ;
+  uint32_t
+  GetSize () const
+  {
+    return m_arenas.size ();
+  }
 
-      Encode (kpmindmessage);
+  /**
+  * Splits [0, count) in one contiguous range per worker and runs job on
+  * every range, returning once all of them are done
+  */
+  void
+  Run (size_t count, const Job &job)
+  {
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_job = job;
+      m_count = count;
+      m_pending = m_threads.size ();
+      m_generation++;
+    }
+    m_start.notify_all ();
+
+    RunRange (0);
+
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_done.wait (lock, [this] { return m_pending == 0; });
+    m_job = nullptr;
+  }
+
+private:
+  void
+  RunRange (uint32_t worker)
+  {
+    size_t begin = m_count * worker / GetSize ();
+    size_t end = m_count * (worker + 1) / GetSize ();
+    m_arenas[worker]->Reset ();
+    m_job (*m_arenas[worker], begin, end);
+  }
+
+  void
+  WorkerLoop (uint32_t worker)
+  {
+    uint64_t seen = 0;
+    while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          m_start.wait (lock, [this, seen] { return m_stop || m_generation != seen; });
+          if (m_stop)
+            {
+              return;
+            }
+          seen = m_generation;
+        }
+
+        RunRange (worker);
+
+        {
+          std::lock_guard<std::mutex> lock (m_mutex);
+          m_pending--;
+        }
+        m_done.notify_one ();
+      }
+  }
+
+  std::vector<std::unique_ptr<Asn1Arena>> m_arenas; //!< one arena per worker
+  std::vector<std::thread> m_threads; //!< workers 1 to n-1
+  std::mutex m_mutex;
+  std::condition_variable m_start;
+  std::condition_variable m_done;
+  uint64_t m_generation; //!< incremented at every build
+  size_t m_pending; //!< worker threads still running the current build
+  bool m_stop;
+  Job m_job;
+  size_t m_count;
+};
+
+static std::atomic<uint32_t> g_buildWorkers (1);
+static std::atomic<uint32_t> g_minUesPerWorker (64);
+// serializes the parallel builds, held until the message is encoded since
+// the tree lives in the worker arenas
+static std::mutex g_workerPoolMutex;
+static std::unique_ptr<UeReportWorkerPool> g_workerPool;
+
+void
+KpmIndicationMessage::SetParallelBuild (uint32_t workers, uint32_t minUesPerWorker)
+{
+  NS_ABORT_MSG_IF (minUesPerWorker == 0, "At least one UE per worker is needed");
+  g_buildWorkers = workers > 1 ? workers : 1;
+  g_minUesPerWorker = minUesPerWorker;
+}
+
+KpiTable
+KpmIndicationMessage::MergeLegacyUeIndications (const KpmIndicationMessageValues &values)
+{
+  KpiTable merged = values.m_ueKpis;
+  for (const auto &ueIndication : values.m_ueIndications)
+    {
+      OCTET_STRING_t id = ueIndication->GetId ();
+      AddToKpiTable (ueIndication, merged, merged.GetSlot (std::string ((char *) id.buf, id.size)));
+    }
+  return merged;
+}
+
+KpmIndicationMessage::KpmIndicationMessageValues
+KpmIndicationMessage::BatchGranularityPeriods (
+    const std::vector<KpmIndicationMessageValues> &samples, uint32_t granularityPeriod)
+{
+  NS_ABORT_MSG_IF (samples.empty (), "No granularity period to batch");
+  KpmIndicationMessageValues batch = samples.back ();
+  batch.m_ueKpiHistory.clear ();
+  batch.m_cellKpiHistory.clear ();
+  for (size_t i = 0; i + 1 < samples.size (); ++i)
+    {
+      const KpmIndicationMessageValues &sample = samples[i];
+      batch.m_ueKpiHistory.push_back (sample.m_ueIndications.empty ()
+                                          ? sample.m_ueKpis
+                                          : MergeLegacyUeIndications (sample));
+      batch.m_cellKpiHistory.push_back (sample.m_cellKpis);
+      if (sample.m_cellMeasurementItems)
+        {
+          KpiTable &cellKpis = batch.m_cellKpiHistory.back ();
+          AddToKpiTable (sample.m_cellMeasurementItems, cellKpis, cellKpis.GetSlot (""));
+        }
+    }
+  batch.m_granularityPeriod = granularityPeriod;
+  return batch;
+}
+
+void
+KpmIndicationMessage::FillAndEncodeKpmIndicationMessage (E2SM_KPM_IndicationMessage_t *descriptor,
+                                                         const KpmIndicationMessageValues &values,
+                                                         const std::vector<size_t> *ueSlots)
+{
+  /*
+  indicationMessage_Format3
+    - ueMeasReportList
+      - list (UEMeasurementReportItem)
+        - ueID
+        - measReport (Format1)
+          - measData->list (MeasurementDataItem)->measRecord->list (MeasurementRecordItem)
+          - *measInfoList->list (MeasurementInfoItem: measType + labelInfoList)
+
+  The whole tree is built in a per-message arena and dropped in one shot
+  once the message has been encoded.
+  */
+  Asn1Arena arena;
+
+  E2SM_KPM_IndicationMessage_Format3_t *format3 =
+      arena.New<E2SM_KPM_IndicationMessage_Format3_t> ();
+
+  // legacy MeasurementItemList inputs are folded into the UE KPIs
+  const KpiTable *ueKpis = &values.m_ueKpis;
+  KpiTable mergedUeKpis;
+  if (!values.m_ueIndications.empty ())
+    {
+      mergedUeKpis = MergeLegacyUeIndications (values);
+      ueKpis = &mergedUeKpis;
+    }
+  // a UE reported in any of the batched periods is reported, with noValue
+  // records for the periods it missed
+  const KpiTable *latestUeKpis = ueKpis;
+  KpiTable batchedUeKpis;
+  if (!values.m_ueKpiHistory.empty ())
+    {
+      batchedUeKpis = MergeKpiHistory (*ueKpis, values.m_ueKpiHistory);
+      ueKpis = &batchedUeKpis;
+    }
+
+  // UEs whose KPIs were all filtered out by the reduced profile or the
+  // subscription are skipped
+  std::vector<uint8_t> selected = SelectColumns (*ueKpis, values.m_subscription);
+  std::vector<ColumnEncoding> encodings = GetColumnEncodings (*ueKpis, values.m_subscription);
+  KpiHistory history (*ueKpis, *latestUeKpis, values.m_ueKpiHistory);
+  std::vector<size_t> slots;
+  std::vector<UEID_GNB_t *> ueIds;
+  size_t candidates = ueSlots != nullptr ? ueSlots->size () : ueKpis->GetSlotCount ();
+  for (size_t i = 0; i < candidates; ++i)
+    {
+      size_t slot = ueSlots != nullptr ? (*ueSlots)[i] : i;
+      if (CountSelectedValues (*ueKpis, slot, selected) > 0)
+        {
+          slots.push_back (slot);
+          ueIds.push_back (KpmUeIdCache::Acquire (ueKpis->GetId (slot)));
+        }
+    }
+
+  std::unique_lock<std::mutex> poolLock;
+  if (!slots.empty ())
+    {
+      size_t ueCount = slots.size ();
+      UEMeasurementReportItem_t *ueReports = arena.NewArray<UEMeasurementReportItem_t> (ueCount);
+      arena.ReserveList (&format3->ueMeasReportList.list, ueCount);
+
+      auto buildReports = [&] (Asn1Arena &itemArena, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+          {
+            NS_LOG_DEBUG ("Encoding UE " << ueKpis->GetId (slots[i]) << " with "
+                                         << ueKpis->GetValueCount (slots[i]) << " measurements");
+            SetUeId (&ueReports[i].ueID, ueIds[i]);
+            if (values.m_ueKpiHistory.empty ())
+              {
+                FillArenaMeasReport (itemArena, &ueReports[i].measReport, *ueKpis, slots[i],
+                                     selected, encodings);
+              }
+            else
+              {
+                FillArenaBatchedMeasReport (itemArena, &ueReports[i].measReport, *ueKpis,
+                                            slots[i], selected, encodings, history,
+                                            values.m_granularityPeriod);
+              }
+          }
+      };
+
+      uint32_t workers = std::min<size_t> (g_buildWorkers, ueCount / g_minUesPerWorker);
+      if (workers > 1)
+        {
+          poolLock = std::unique_lock<std::mutex> (g_workerPoolMutex);
+          if (!g_workerPool || g_workerPool->GetSize () != workers)
+            {
+              g_workerPool.reset ();
+              g_workerPool.reset (new UeReportWorkerPool (workers));
+            }
+          NS_LOG_LOGIC ("Building " << ueCount << " UE reports on " << workers << " workers");
+          g_workerPool->Run (ueCount, buildReports);
+        }
+      else
+        {
+          buildReports (arena, 0, ueCount);
+        }
+
+      // the list is filled in UE order whatever the partitioning
+      for (size_t i = 0; i < ueCount; ++i)
+        {
+          ASN_SEQUENCE_ADD (&format3->ueMeasReportList.list, &ueReports[i]);
+        }
     }
   else
     {
-      printf ("\n\n FORMAT_THREE_Message_Decoding\n "); 
-      E2SM_KPM_IndicationMessage_t *kpmindmessage = (E2SM_KPM_IndicationMessage_t *) calloc (1, sizeof (E2SM_KPM_IndicationMessage_t));
-
-      // Create Format 3
-      /*
-      indicationMessage_Format3
-        - ueMeasReportList
-        - list (UEMeasurementReportItem)
-            - ueID
-            - measReport (Format1)
-     */
-      E2SM_KPM_IndicationMessage_Format3_t *format_3 = (E2SM_KPM_IndicationMessage_Format3_t *) calloc (1, sizeof (E2SM_KPM_IndicationMessage_Format3_t));
-      assert (format_3 != nullptr && "Memory exhausted");
-      // TODOL Multi UEs
-      if(values.m_UeMeasItems.size() > 0) {
-          UEMeasurementReportList_t* m_ueMeasReportList = (UEMeasurementReportList_t *) calloc (values.m_UeMeasItems.size(), sizeof (UEMeasurementReportList_t));
-          int _index = 0;
-          for(auto ueitem : values.m_UeMeasItems) {
-              UEMeasurementReportItem_t *ueMeasItem = (UEMeasurementReportItem_t *) calloc (1, sizeof (UEMeasurementReportItem_t));
-              // Set UE ID Information
-              UEID_GNB_t *gnb_asn = (UEID_GNB_t *) calloc (1, sizeof (UEID_GNB_t));
-              assert (gnb_asn != NULL && "Memory exhausted");
-
-              gnb_asn->amf_UE_NGAP_ID.buf = (uint8_t *) calloc (5, sizeof (uint8_t));
-              assert (gnb_asn->amf_UE_NGAP_ID.buf != NULL && "Memory exhausted");
-              //0103 Update 
-              //asn_ulong2INTEGER (&gnb_asn->amf_UE_NGAP_ID,
-              //static_cast<unsigned long>(KpmIndicationHeader::octet_string_to_int_64(ueIndication->GetId())));
-              asn_ulong2INTEGER (&gnb_asn->amf_UE_NGAP_ID, 1);
-              printf (" \n[Jlee-Encoding] UE ID : %s", ueitem.ueID.c_str());
-
-              gnb_asn->guami.aMFPointer = cp_amf_ptr_to_bit_string ((rand () % 2 ^ 6) + 0);
-              gnb_asn->guami.aMFSetID = cp_amf_set_id_to_bit_string ((rand () % 2 ^ 10) + 0);
-              gnb_asn->guami.aMFRegionID = cp_amf_region_id_to_bit_string ((rand () % 2 ^ 8) + 0);
-              gnb_asn->guami.pLMNIdentity = cp_plmn_identity_to_octant_string (rand() % 505, rand() % 99, 2);
-              gnb_asn->ran_UEID = (RANUEID_t *) calloc(1, sizeof(*gnb_asn->ran_UEID));
-              gnb_asn->ran_UEID->buf = (uint8_t *) calloc(8, sizeof(*gnb_asn->ran_UEID->buf));
-              uint8_t ran_ue_id[8] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-              memcpy(gnb_asn->ran_UEID->buf, ran_ue_id, 8);
-              gnb_asn->ran_UEID->size = 8;
-              UEID_t *ueid = (UEID_t *) calloc (1, sizeof (UEID_t));
-              ueid->present = UEID_PR_gNB_UEID;
-              ueid->choice.gNB_UEID = gnb_asn;
-              ueMeasItem->ueID = *ueid;
- 
-              // create Indication Message Format 1 list
-              // measreport (format1) = 
-              //                measdata (list (measdataitem), measrecord, list (measrecodritem))
-              //              + measinfolist (list, (meastype, labelinfolist->list))
-              E2SM_KPM_IndicationMessage_Format1_t *measreport =  (E2SM_KPM_IndicationMessage_Format1_t *) calloc (1, sizeof (E2SM_KPM_IndicationMessage_Format1_t));
-              MeasurementData_t *measdata = (MeasurementData_t *) calloc (1, sizeof (MeasurementData_t));
-              MeasurementInfoList_t * measinfolist =  (MeasurementInfoList_t *) calloc (1, sizeof (MeasurementInfoList_t));          
-
-              for (auto mesitem : ueitem.measItems) {
-                  // 1) fill up measdata
-                  // measdata (list (measdataitem), measrecord, list (measrecodritem))
-                  MeasurementDataItem_t *measdataitem = (MeasurementDataItem_t *) calloc (1, sizeof (MeasurementDataItem_t));
-                  // 2) fill up measdataitem
-                  MeasurementRecord_t *measrecord = (MeasurementRecord_t *) calloc (1, sizeof (MeasurementRecord_t)); 
-                  // 3) fill up measredocrd
-                  MeasurementRecordItem_t *measrecorditem = (MeasurementRecordItem_t *) calloc (1, sizeof (MeasurementRecordItem_t));
-              
-                  measrecorditem->present = MeasurementRecordItem_PR_integer; // to be change according to the meas data type
-                  measrecorditem->choice.integer =  mesitem.measValue; // mease value
-                  ASN_SEQUENCE_ADD (&measrecord->list, measrecorditem);
-                  measdataitem->measRecord = *measrecord;
-                  ASN_SEQUENCE_ADD (&measdata->list, measdataitem);
-        
-                  // 2-1) fill up measinfolist
-                  // measinfolist (list, (meastype, labelinfolist->list))
-                  MeasurementInfoItem_t * measinfoitem = (MeasurementInfoItem_t *) calloc (1, sizeof (MeasurementInfoItem_t));
-                  MeasurementType_t * meastype = (MeasurementType_t *) calloc (1, sizeof (MeasurementType_t));
-                  // 2-2) fill up meas type
-                  meastype->present = MeasurementType_PR_measName; // to be change measID
-                  std::string meas_name = mesitem.measName; // to be updating : measurementItem?     
-                  MeasurementTypeName_t * meastypename = (MeasurementTypeName_t *) calloc (1, sizeof (MeasurementTypeName_t));
-                  meastypename->buf = (uint8_t *) calloc (1, sizeof (OCTET_STRING));
-                  meastypename->size = meas_name.length ();
-                  memcpy (meastypename->buf, meas_name.c_str (), meastypename->size);
-                  meastype->choice.measName = *meastypename;
-                  // for loging
-                  printf (" \n [Jlee-Encoding] Mesaurement Label : %s ", mesitem.measName.c_str());
-                  printf (" \n [Jlee-Encoding] Mesaurement Label : %ld ", mesitem.measValue);
-
-
-                  // 2-3) fill up labelinfolist
-                  LabelInfoList_t * labelinfolist = (LabelInfoList_t *) calloc (1, sizeof (LabelInfoList_t));
-                  LabelInfoItem_t * labelinfoitem = (LabelInfoItem_t *) calloc (1, sizeof (LabelInfoItem_t));
-                  MeasurementLabel_t * measlabel = (MeasurementLabel_t *) calloc(1, sizeof(MeasurementLabel_t));
-                  measlabel->noLabel = (long *) malloc (sizeof(long));
-                  *measlabel->noLabel = 0;
-                  labelinfoitem->measLabel = *measlabel;
-                  assert (measlabel->noLabel != NULL && "Memory exhausted");
-                  ASN_SEQUENCE_ADD (&labelinfolist->list, labelinfoitem);  
-                  measinfoitem->measType = *meastype;
-                  measinfoitem->labelInfoList = *labelinfolist;
-                  ASN_SEQUENCE_ADD (&measinfolist->list, measinfoitem);
-              } // end for measurment
-
-              measreport->measData = *measdata;
-              measreport->measInfoList = measinfolist;
-              // Print ASN from Indication Message, format 1.
-              NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_KPM_IndicationMessage_Format1, measreport));
-              ueMeasItem->measReport = *measreport;
-
-              ASN_SEQUENCE_ADD(&m_ueMeasReportList[_index++].list, ueMeasItem);
+      NS_LOG_DEBUG ("No UE measurements, sending a placeholder report");
+      KpiTable placeholder;
+      placeholder.SetReal (placeholder.GetSlot (""), "DRB.RlcSduDelayDl", 0);
+      UEMeasurementReportItem_t *ueReport = arena.New<UEMeasurementReportItem_t> ();
+      SetUeId (&ueReport->ueID, KpmUeIdCache::Acquire (""));
+      FillArenaMeasReport (arena, &ueReport->measReport, placeholder, 0, {},
+                           GetColumnEncodings (placeholder, nullptr));
+      arena.ReserveList (&format3->ueMeasReportList.list, 1);
+      ASN_SEQUENCE_ADD (&format3->ueMeasReportList.list, ueReport);
+    }
+
+  descriptor->indicationMessage_formats.present =
+      E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format3;
+  descriptor->indicationMessage_formats.choice.indicationMessage_Format3 = format3;
+
+  NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_KPM_IndicationMessage, descriptor));
+  Encode (descriptor);
+  NS_LOG_LOGIC ("KPM indication encoded in " << m_size << " bytes, arena used "
+                                             << arena.GetUsedBytes () << " bytes");
+
+  for (size_t slot : slots)
+    {
+      KpmUeIdCache::Release (ueKpis->GetId (slot));
+    }
+  if (slots.empty ())
+    {
+      KpmUeIdCache::Release ("");
+    }
+}
+
+/**
+* The report item of a UE, in an arena of its own so that the item can be
+* rebuilt without touching the other UEs
+*/
+struct KpmReportTree::UeReport
+{
+  explicit UeReport (const std::string &ueId)
+    : m_arena (1024),
+      m_ueId (ueId),
+      m_gnbUeId (KpmUeIdCache::Acquire (ueId)),
+      m_item (nullptr),
+      m_records (nullptr),
+      m_generation (0)
+  {
+  }
+
+  ~UeReport ()
+  {
+    KpmUeIdCache::Release (m_ueId, true);
+  }
+
+  Asn1Arena m_arena;
+  std::string m_ueId;
+  UEID_GNB_t *m_gnbUeId; //!< held until the UE leaves the report
+  UEMeasurementReportItem_t *m_item;
+  MeasurementRecordItem_t *m_records; //!< records of the item, in m_kpis order
+  std::vector<uint32_t> m_kpis; //!< KPI IDs of the records, in record order
+  /// encoding of the records, in record order, m_group being the index of their item
+  std::vector<ColumnEncoding> m_encodings;
+  uint64_t m_generation; //!< generation of the last Update reporting the UE
+};
+
+KpmReportTree::KpmReportTree () : m_generation (0), m_builds (0)
+{
+}
+
+KpmReportTree::~KpmReportTree ()
+{
+}
+
+size_t
+KpmReportTree::Update (const KpmIndicationMessage::KpmIndicationMessageValues &values)
+{
+  const KpiTable *ueKpis = &values.m_ueKpis;
+  KpiTable mergedUeKpis;
+  if (!values.m_ueIndications.empty ())
+    {
+      mergedUeKpis = KpmIndicationMessage::MergeLegacyUeIndications (values);
+      ueKpis = &mergedUeKpis;
+    }
+  std::vector<uint8_t> selected = SelectColumns (*ueKpis, values.m_subscription);
+  std::vector<ColumnEncoding> encodings = GetColumnEncodings (*ueKpis, values.m_subscription);
+
+  // the columns of the table may come in any order, the records of a UE are
+  // matched on the KPIs they carry
+  m_columnKpis.resize (ueKpis->GetColumnCount ());
+  for (size_t column = 0; column < ueKpis->GetColumnCount (); ++column)
+    {
+      auto inserted = m_kpiIds.emplace (ueKpis->GetColumnName (column), m_kpiIds.size ());
+      m_columnKpis[column] = inserted.first->second;
+    }
+
+  m_generation++;
+  m_reports.clear ();
+  for (size_t slot = 0; slot < ueKpis->GetSlotCount (); ++slot)
+    {
+      // in record order, as FillArenaMeasReport groups them
+      GroupColumns (*ueKpis, slot, selected, encodings, m_columns, t_itemSizes);
+      if (m_columns.empty ())
+        {
+          continue;
+        }
+
+      std::unique_ptr<UeReport> &ue = m_ues[ueKpis->GetId (slot)];
+      bool rebuild = !ue || ue->m_kpis.size () != m_columns.size ();
+      if (!ue)
+        {
+          ue.reset (new UeReport (ueKpis->GetId (slot)));
+        }
+      // the encoding of a KPI changes with the subscription and the
+      // histogram labels, and so does the layout of the item
+      size_t item = 0;
+      size_t itemEnd = t_itemSizes[0];
+      for (size_t i = 0; !rebuild && i < m_columns.size (); ++i)
+        {
+          if (i == itemEnd)
+            {
+              itemEnd += t_itemSizes[++item];
             }
-            format_3->ueMeasReportList = *m_ueMeasReportList;
-           // ASN_SEQUENCE_ADD (&format_3->ueMeasReportList.list, m_ueMeasReportList);
-      } else {
-            printf ("values.m_ueIndications.size() == 0 \n ");
-            UEMeasurementReportItem_t *ueMeasItem =  (UEMeasurementReportItem_t *) calloc (1, sizeof (UEMeasurementReportItem_t));
-            // To 수정
-            UEID_GNB_t *gnb_asn = (UEID_GNB_t *) calloc (1, sizeof (UEID_GNB_t));
-            assert (gnb_asn != NULL && "Memory exhausted");
-            gnb_asn->amf_UE_NGAP_ID.buf = (uint8_t *) calloc (5, sizeof (uint8_t));
-            assert (gnb_asn->amf_UE_NGAP_ID.buf != NULL && "Memory exhausted");
-            asn_ulong2INTEGER (&gnb_asn->amf_UE_NGAP_ID, 1);
-            gnb_asn->guami.aMFPointer = cp_amf_ptr_to_bit_string (0);
-            gnb_asn->guami.aMFSetID = cp_amf_set_id_to_bit_string (1);
-            gnb_asn->guami.aMFRegionID = cp_amf_region_id_to_bit_string (2 + 0);
-            gnb_asn->guami.pLMNIdentity = cp_plmn_identity_to_octant_string (rand() % 505, rand() % 99, 2);
-            gnb_asn->ran_UEID = (RANUEID_t *) calloc(1, sizeof(*gnb_asn->ran_UEID));
-            gnb_asn->ran_UEID->buf = (uint8_t *) calloc(8, sizeof(*gnb_asn->ran_UEID->buf));
-            uint8_t ran_ue_id[8] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-            memcpy(gnb_asn->ran_UEID->buf, ran_ue_id, 8);
-            gnb_asn->ran_UEID->size = 8;
-
-            UEID_t *ueid = (UEID_t *) calloc (1, sizeof (UEID_t));
-            ueid->present = UEID_PR_gNB_UEID;
-            ueid->choice.gNB_UEID = gnb_asn;
-
-            ueMeasItem->ueID = *ueid;
-
-            MeasurementRecord_t *measrecord = (MeasurementRecord_t *) calloc (1, sizeof (MeasurementRecord_t));
-            MeasurementRecordItem_t *measrecorditem = (MeasurementRecordItem_t *) calloc (1, sizeof (MeasurementRecordItem_t));
-            measrecorditem->present = MeasurementRecordItem_PR_real;
-            measrecorditem->choice.real = 0;//(rand() % 256) + 0.1;
-            ASN_SEQUENCE_ADD (&measrecord->list, measrecorditem);
-
-            MeasurementDataItem_t *measdataitem = (MeasurementDataItem_t *) calloc (1, sizeof (MeasurementDataItem_t));
-            measdataitem->measRecord = *measrecord;
-
-            MeasurementData_t *measdata = (MeasurementData_t *) calloc (1, sizeof (MeasurementData_t));
-            ASN_SEQUENCE_ADD (&measdata->list, measdataitem);
-
-            MeasurementType_t * meastype = (MeasurementType_t *) calloc (1, sizeof (MeasurementType_t));
-            meastype->present = MeasurementType_PR_measName;
-            // DRB.RlcSduDelayDl
-            std::string name = "DRB.RlcSduDelayDl";
-            MeasurementTypeName_t * measname = (MeasurementTypeName_t *) calloc (1, sizeof (MeasurementTypeName_t));
-            measname->buf = (uint8_t *) calloc (1, sizeof (OCTET_STRING));
-            measname->size = name.length ();
-            memcpy (measname->buf, name.c_str (), measname->size);
-            meastype->choice.measName = *measname;
-
-            MeasurementLabel_t * measlabel = (MeasurementLabel_t *) calloc(1, sizeof(MeasurementLabel_t));
-            measlabel->noLabel = (long *) malloc (sizeof(long));
-            assert (measlabel->noLabel != NULL && "Memory exhausted");
-            *measlabel->noLabel = 0;
-
-
-            LabelInfoItem_t * labelinfoitem = (LabelInfoItem_t *) calloc (1, sizeof (LabelInfoItem_t));
-            labelinfoitem->measLabel = *measlabel;
-
-            LabelInfoList_t * labelinfolist = (LabelInfoList_t *) calloc (1, sizeof (LabelInfoList_t));
-            ASN_SEQUENCE_ADD (&labelinfolist->list, labelinfoitem);
-
-            MeasurementInfoItem_t * infoitem = (MeasurementInfoItem_t *) calloc (1, sizeof (MeasurementInfoItem_t));
-            infoitem->labelInfoList = *labelinfolist;
-            infoitem->measType = *meastype;
-
-            MeasurementInfoList_t * infolist = (MeasurementInfoList_t *) calloc (1, sizeof (MeasurementInfoList_t));
-            ASN_SEQUENCE_ADD (&infolist->list, infoitem);
-
-
-            // 4. create Indication Message Format 1
-            E2SM_KPM_IndicationMessage_Format1_t *measreport = (E2SM_KPM_IndicationMessage_Format1_t *) calloc ( 1, sizeof (E2SM_KPM_IndicationMessage_Format1_t));
-
-            measreport->measData = *measdata;
-            measreport->measInfoList = infolist;
-            // Print ASN from Indication Message, format 1.
-            NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_KPM_IndicationMessage_Format1, measreport));
-            ueMeasItem->measReport = *measreport;
-
-            // equivelent to code below -- old  code
-            // ASN_SEQUENCE_ADD (&UE_data_list->list,UE_data);
-            // format_3->ueMeasReportList = *UE_data_list ;
-            ASN_SEQUENCE_ADD (&format_3->ueMeasReportList.list, ueMeasItem);
-          }
-      NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_KPM_IndicationMessage_Format3, format_3));
-      kpmindmessage->indicationMessage_formats.present = E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format3;
-      kpmindmessage->indicationMessage_formats.choice.indicationMessage_Format3 = format_3;
+          const ColumnEncoding &encoding = encodings[m_columns[i]];
+          const ColumnEncoding &built = ue->m_encodings[i];
+          rebuild = ue->m_kpis[i] != m_columnKpis[m_columns[i]] ||
+                    built.m_name != encoding.m_name || built.m_measId != encoding.m_measId ||
+                    built.m_bin != encoding.m_bin || built.m_group != item;
+        }
+
+      if (rebuild)
+        {
+          NS_LOG_LOGIC ("Building the report of UE " << ueKpis->GetId (slot) << " with "
+                                                     << m_columns.size () << " measurements");
+          ue->m_arena.Reset ();
+          ue->m_item = ue->m_arena.New<UEMeasurementReportItem_t> ();
+          SetUeId (&ue->m_item->ueID, ue->m_gnbUeId);
+          ue->m_records = FillArenaMeasReport (ue->m_arena, &ue->m_item->measReport, *ueKpis,
+                                               slot, selected, encodings);
+          ue->m_kpis.clear ();
+          ue->m_encodings.clear ();
+          item = 0;
+          itemEnd = t_itemSizes[0];
+          for (size_t i = 0; i < m_columns.size (); ++i)
+            {
+              if (i == itemEnd)
+                {
+                  itemEnd += t_itemSizes[++item];
+                }
+              ue->m_kpis.push_back (m_columnKpis[m_columns[i]]);
+              ue->m_encodings.push_back (encodings[m_columns[i]]);
+              ue->m_encodings.back ().m_group = item;
+            }
+          m_builds++;
+        }
+      else
+        {
+          for (size_t i = 0; i < m_columns.size (); ++i)
+            {
+              FillRecord (&ue->m_records[i], *ueKpis, slot, m_columns[i]);
+            }
+        }
+      ue->m_generation = m_generation;
+      m_reports.push_back (ue->m_item);
+    }
+
+  // the UEs not reported this time have detached, or lost all their KPIs
+  for (auto it = m_ues.begin (); it != m_ues.end ();)
+    {
+      if (it->second->m_generation != m_generation)
+        {
+          NS_LOG_LOGIC ("Dropping the report of UE " << it->first);
+          it = m_ues.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+  return m_reports.size ();
+}
+
+void
+KpmReportTree::RemoveUe (const std::string &ueId)
+{
+  auto found = m_ues.find (ueId);
+  if (found == m_ues.end ())
+    {
+      return;
+    }
+  m_reports.erase (std::remove (m_reports.begin (), m_reports.end (), found->second->m_item),
+                   m_reports.end ());
+  m_ues.erase (found);
+}
+
+size_t
+KpmReportTree::GetUeCount () const
+{
+  return m_ues.size ();
+}
+
+uint64_t
+KpmReportTree::GetBuildCount () const
+{
+  return m_builds;
+}
+
+void
+KpmIndicationMessage::FillAndEncodeKpmCellIndicationMessage (
+    E2SM_KPM_IndicationMessage_t *descriptor, const KpmIndicationMessageValues &values)
+{
+  /*
+  indicationMessage_Format1
+    - measData->list (MeasurementDataItem)->measRecord->list (MeasurementRecordItem)
+    - *measInfoList->list (MeasurementInfoItem: measType + labelInfoList)
+
+  The same measurement report as a single UE of the Format 3 message,
+  built from the cell KPIs.
+  */
+  Asn1Arena arena (4096);
+
+  // the legacy cell MeasurementItemList input is folded into the cell KPIs
+  const KpiTable *cellKpis = &values.m_cellKpis;
+  KpiTable mergedCellKpis;
+  if (values.m_cellMeasurementItems)
+    {
+      mergedCellKpis = values.m_cellKpis;
+      AddToKpiTable (values.m_cellMeasurementItems, mergedCellKpis, mergedCellKpis.GetSlot (""));
+      cellKpis = &mergedCellKpis;
+    }
+  const KpiTable *latestCellKpis = cellKpis;
+  KpiTable batchedCellKpis;
+  if (!values.m_cellKpiHistory.empty ())
+    {
+      batchedCellKpis = MergeKpiHistory (*cellKpis, values.m_cellKpiHistory);
+      cellKpis = &batchedCellKpis;
+    }
+
+  E2SM_KPM_IndicationMessage_Format1_t *format1 =
+      arena.New<E2SM_KPM_IndicationMessage_Format1_t> ();
+  std::vector<uint8_t> selected = SelectColumns (*cellKpis, values.m_subscription);
+  if (cellKpis->GetSlotCount () > 0 && CountSelectedValues (*cellKpis, 0, selected) > 0)
+    {
+      NS_LOG_DEBUG ("Encoding " << CountSelectedValues (*cellKpis, 0, selected)
+                                << " cell measurements over " << values.m_cellKpiHistory.size () + 1
+                                << " granularity periods");
+      if (values.m_cellKpiHistory.empty ())
+        {
+          FillArenaMeasReport (arena, format1, *cellKpis, 0, selected,
+                               GetColumnEncodings (*cellKpis, values.m_subscription));
+        }
+      else
+        {
+          FillArenaBatchedMeasReport (arena, format1, *cellKpis, 0, selected,
+                                      GetColumnEncodings (*cellKpis, values.m_subscription),
+                                      KpiHistory (*cellKpis, *latestCellKpis,
+                                                  values.m_cellKpiHistory),
+                                      values.m_granularityPeriod);
+        }
+    }
+  else
+    {
+      NS_LOG_DEBUG ("No cell measurements, sending a placeholder report");
+      KpiTable placeholder;
+      placeholder.SetReal (placeholder.GetSlot (""), "DRB.RlcSduDelayDl", 0);
+      FillArenaMeasReport (arena, format1, placeholder, 0, {},
+                           GetColumnEncodings (placeholder, nullptr));
+    }
+
+  descriptor->indicationMessage_formats.present =
+      E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format1;
+  descriptor->indicationMessage_formats.choice.indicationMessage_Format1 = format1;
 
-      NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_KPM_IndicationMessage, kpmindmessage));
-      Encode (kpmindmessage);
-      printf (" \n *** Done Encoding INDICATION Message ****** \n ");
+  NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_KPM_IndicationMessage, descriptor));
+  Encode (descriptor);
+  NS_LOG_LOGIC ("Cell KPM indication encoded in " << m_size << " bytes");
+}
+
+void
+KpmIndicationMessage::AddToKpiTable (Ptr<MeasurementItemList> list, KpiTable &table, size_t slot)
+{
+  for (const auto &item : list->GetItems ())
+    {
+      PM_Info_Item_t *pmItem = item->GetPointer ();
+      std::string name ((char *) pmItem->pmType.choice.measName.buf,
+                        pmItem->pmType.choice.measName.size);
+      switch (pmItem->pmVal.present)
+        {
+        case MeasurementValue_PR_valueInt:
+          table.SetInteger (slot, name, pmItem->pmVal.choice.valueInt);
+          break;
+        case MeasurementValue_PR_valueReal:
+          table.SetReal (slot, name, pmItem->pmVal.choice.valueReal);
+          break;
+        default:
+          NS_LOG_LOGIC ("Measurement " << name << " has no KPI representation, skipped");
+          break;
+        }
+    }
+}
+
+/**
+* Adds the KPIs of a slot to a legacy list of Measurement Information Items
+*/
+static void
+AddKpisToList (const KpiTable &kpis, size_t slot, Ptr<MeasurementItemList> list)
+{
+  for (size_t column = 0; column < kpis.GetColumnCount (); ++column)
+    {
+      if (!kpis.HasValue (slot, column))
+        {
+          continue;
+        }
+      if (kpis.GetColumnType (column) == KpiTable::INTEGER)
+        {
+          list->AddItem<long> (kpis.GetColumnName (column), kpis.GetInteger (slot, column));
+        }
+      else
+        {
+          list->AddItem<double> (kpis.GetColumnName (column), kpis.GetReal (slot, column));
+        }
+    }
+}
+
+std::set<Ptr<MeasurementItemList>>
+KpmIndicationMessage::BuildLegacyUeIndications (const KpmIndicationMessageValues &values)
+{
+  std::set<Ptr<MeasurementItemList>> ueIndications;
+  for (size_t slot = 0; slot < values.m_ueKpis.GetSlotCount (); ++slot)
+    {
+      Ptr<MeasurementItemList> ueVal = Create<MeasurementItemList> (values.m_ueKpis.GetId (slot));
+      AddKpisToList (values.m_ueKpis, slot, ueVal);
+      ueIndications.insert (ueVal);
+    }
+  return ueIndications;
+}
+
+Ptr<MeasurementItemList>
+KpmIndicationMessage::BuildLegacyCellMeasurementItems (const KpmIndicationMessageValues &values)
+{
+  Ptr<MeasurementItemList> cellVal = Create<MeasurementItemList> ();
+  for (size_t slot = 0; slot < values.m_cellKpis.GetSlotCount (); ++slot)
+    {
+      AddKpisToList (values.m_cellKpis, slot, cellVal);
     }
+  return cellVal;
 }
 
 MeasurementItemList::MeasurementItemList ()
@@ -31,9 +31,14 @@
 #ifndef KPM_INDICATION_H
 #define KPM_INDICATION_H
 
+#include <functional>
 #include <thread>
 #include "ns3/object.h"
+#include "ns3/kpi-table.h"
+#include "ns3/kpm-subscription-filter.h"
+#include <memory>
 #include <set>
+#include <unordered_map>
 
 #include <vector>
 #include <stdint.h>
@@ -50,22 +55,13 @@ extern "C" {
   #include "OCUCP-PF-Container.h"
   #include "ODU-PF-Container.h"
   #include "PF-ContainerListItem.h"
+  #include "UEID-GNB.h"
+  #include "UEMeasurementReportItem.h"
   #include "asn1c-types.h"
 
 //===================================
 
 }
-/** Create New Vector for test to be delted */
-/*Measure Type : present,  */
-struct MeasItem {
-  std::string measName;
-  long measValue;
-};
-struct ueMeasItem{
-  std::string ueID ;
-  std::vector <MeasItem> measItems;
-};
-/**/
 namespace ns3 {
 
   class KpmIndicationHeader : public SimpleRefCount<KpmIndicationHeader>
@@ -119,6 +115,19 @@ namespace ns3 {
     KpmIndicationHeader (GlobalE2nodeType nodeType,KpmRicIndicationHeaderValues values);
     ~KpmIndicationHeader ();
 
+    /**
+    * Enables the cross-check of every header built from a cached template
+    * against a full asn1c encoding of the same values. A mismatch is fatal.
+    *
+    * \param validate true to enable the cross-check
+    */
+    static void SetTemplateValidation (bool validate);
+
+    /**
+    * Drops every cached header template
+    */
+    static void ClearTemplateCache ();
+
     uint64_t time_now_us_clck();
     OCTET_STRING_t get_time_now_us();
     static uint64_t octet_string_to_int_64(OCTET_STRING_t asn);
@@ -126,6 +135,7 @@ namespace ns3 {
 
     void* m_buffer;
     size_t m_size;
+    size_t m_capacity; //!< allocated size of m_buffer, see EncodeBufferPool
     
   private: 
     /**
@@ -138,6 +148,22 @@ namespace ns3 {
     */
     void FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHeader_t* descriptor, 
                                               KpmRicIndicationHeaderValues values);
+
+    /**
+    * Fills m_buffer with the full asn1c encoding of the header
+    *
+    * \param values struct holding the values to be used to fill the header
+    */
+    void EncodeWithAsn1c (const KpmRicIndicationHeaderValues &values);
+
+    /**
+    * Fills m_buffer by copying the cached encoding of the header for the
+    * same node and patching the collection timestamp in place. The template
+    * is built on first use.
+    *
+    * \param values struct holding the values to be used to fill the header
+    */
+    void EncodeFromTemplate (const KpmRicIndicationHeaderValues &values);
     
     void Encode (E2SM_KPM_IndicationHeader_t* descriptor);
 
@@ -247,6 +273,17 @@ namespace ns3 {
     std::set<Ptr<CellResourceReport>> m_cellResourceReportItems;
   };
 
+  class KpmReportTree;
+
+  /**
+  * E2SM-KPM indication message. Every measurement report, of a UE in
+  * Format 3 or of the cell in Format 1, follows the E2SM-KPM layout: the
+  * measInfoList has one item per KPI, or per histogram with one label per
+  * bin, and measData has one MeasurementDataItem per collection period,
+  * oldest first, whose records follow the labels of the measInfoList. A
+  * report holds a single data item, or one per granularity period when
+  * the periods are batched, see BatchGranularityPeriods.
+  */
   class KpmIndicationMessage : public SimpleRefCount<KpmIndicationMessage>
   {
   public:
@@ -258,19 +295,155 @@ namespace ns3 {
     {
       std::string m_cellObjectId; //!< Cell Object ID
       Ptr<PmContainerValues> m_pmContainerValues; //!< struct containing values to be inserted in the PM Container
-      Ptr<MeasurementItemList> m_cellMeasurementItems; //!< list of cell-specific Measurement Information Items
-      std::set<Ptr<MeasurementItemList>> m_ueIndications; //!< list of Measurement Information Items
-
-      /** Create New Vector for test to be delted */
-      std::vector<ueMeasItem> m_UeMeasItems;
-      std::vector <MeasItem> m_CellMeasItems;
+      Ptr<MeasurementItemList> m_cellMeasurementItems; //!< legacy input, list of cell-specific Measurement Information Items
+      std::set<Ptr<MeasurementItemList>> m_ueIndications; //!< legacy input, folded into the UE KPIs when encoding
+
+      KpiTable m_ueKpis; //!< UE KPIs, one slot per UE IMSI, the store filled by the indication message helpers
+      KpiTable m_cellKpis; //!< cell KPIs, a single slot with an empty ID
+      Ptr<KpmSubscriptionFilter> m_subscription; //!< KPIs subscribed by the RIC, null to encode every KPI
+
+      /**
+      * KPIs of the granularity periods before the one in m_ueKpis and
+      * m_cellKpis, oldest first. When not empty, each UE (or the cell)
+      * is encoded with one MeasurementDataItem per granularity period,
+      * see E2Termination BatchGranularityPeriods. A UE reported in any
+      * period is reported, with noValue records for the periods it
+      * missed, for instance after a detach.
+      */
+      std::vector<KpiTable> m_ueKpiHistory;
+      std::vector<KpiTable> m_cellKpiHistory;
+      uint32_t m_granularityPeriod = 0; //!< granularity period in ms, 0 if not encoded
     };
 
-    KpmIndicationMessage (KpmIndicationMessageValues values);
+    /**
+    * Encodes the UE KPIs in a Format 3 message, or the cell KPIs in a
+    * Format 1 message if the subscription is cell-level, see
+    * KpmSubscriptionFilter::IsCellLevel
+    *
+    * \param values the message values
+    */
+    KpmIndicationMessage (const KpmIndicationMessageValues &values);
+
+    /**
+    * Encodes only the given slots of values.m_ueKpis, in the given order.
+    * With batched granularity periods, the UEs found only in the earlier
+    * periods take the slots following the ones of m_ueKpis, in the order
+    * of BuildIndications. Legacy m_ueIndications are not supported here,
+    * see BuildIndications.
+    *
+    * \param values the message values
+    * \param ueSlots the UE slots to encode
+    */
+    KpmIndicationMessage (const KpmIndicationMessageValues &values,
+                          const std::vector<size_t> &ueSlots);
+
+    /**
+    * Encodes a range of the UE reports of a tree brought up to date with
+    * KpmReportTree::Update. An empty range encodes the placeholder report.
+    *
+    * \param tree the UE reports
+    * \param begin the first UE report
+    * \param count the number of UE reports
+    */
+    KpmIndicationMessage (Ptr<KpmReportTree> tree, size_t begin, size_t count);
     ~KpmIndicationMessage ();
+
+    /**
+    * Encodes the UE KPIs of values as a sequence of indication messages,
+    * each holding at most maxUes UEs and at most maxSize encoded bytes.
+    * When a message is too large, it is rebuilt with fewer UEs, scaled on
+    * its measured size per UE. A single UE exceeding maxSize is still
+    * sent alone. Every message is handed to sink as soon as it is encoded
+    * and is not kept afterwards, so the messages are never all alive at
+    * the same time. A cell-level subscription takes a single Format 1
+    * message.
+    *
+    * \param values the message values
+    * \param maxUes maximum number of UEs per message, 0 for no limit
+    * \param maxSize maximum encoded size per message, 0 for no limit
+    * \param sink function receiving the messages in UE order
+    * \param tree if set, the UE reports are kept in the tree from one call
+    *        to the next and only updated, see KpmReportTree. Not used for
+    *        batched granularity periods, which are rebuilt every time.
+    * \return the number of messages
+    */
+    static uint32_t BuildIndications (const KpmIndicationMessageValues &values, uint32_t maxUes,
+                                      uint32_t maxSize,
+                                      std::function<void (Ptr<KpmIndicationMessage>)> sink,
+                                      Ptr<KpmReportTree> tree = nullptr);
+
+    /**
+    * Enables building the UE measurement report items of Format 3 messages
+    * on a pool of worker threads, each filling a contiguous range of UEs
+    * into its own arena. The output is byte-identical to the sequential
+    * build. The APER encoding itself stays on the calling thread.
+    *
+    * \param workers number of threads taking part in the build, including
+    *        the calling one; 0 or 1 disables the parallel build
+    * \param minUesPerWorker minimum number of UEs handed to a worker, so
+    *        that small reports are built sequentially
+    */
+    static void SetParallelBuild (uint32_t workers, uint32_t minUesPerWorker = 64);
+
+    /**
+    * Chooses how the bins of the histogram KPIs of KPI_HISTOGRAMS are
+    * encoded. Enabled by default, the bins of a histogram are a single
+    * measurement, named after the histogram, with one distBinX label and
+    * one record per bin. Disabled, each bin is a measurement of its own,
+    * named after the bin, for RICs matching the bin names.
+    *
+    * \param enable true to encode the histograms with labels
+    */
+    static void SetHistogramLabels (bool enable);
+
+    /**
+    * Adds a legacy list of Measurement Information Items to a slot of a KPI
+    * table. Integer and real values keep their type, L3 RRC containers
+    * have no KPI representation and are skipped.
+    *
+    * \param list the legacy list
+    * \param table the KPI table
+    * \param slot the slot receiving the values
+    */
+    static void AddToKpiTable (Ptr<MeasurementItemList> list, KpiTable &table, size_t slot);
+
+    /**
+    * Combines the values of consecutive granularity periods into the
+    * values of a single report: the latest sample, with the KPIs of the
+    * others as its history. Legacy inputs of the earlier samples are
+    * folded into their KPI tables.
+    *
+    * \param samples the values of each granularity period, oldest first
+    * \param granularityPeriod the granularity period in ms
+    * \return the values of the batched report
+    */
+    static KpmIndicationMessageValues
+    BatchGranularityPeriods (const std::vector<KpmIndicationMessageValues> &samples,
+                             uint32_t granularityPeriod);
+
+    /**
+    * Builds, on demand, the legacy per-UE MeasurementItemList view of the
+    * UE KPIs for consumers that still expect m_ueIndications
+    *
+    * \param values the message values holding the KPIs
+    * \return one list per UE
+    */
+    static std::set<Ptr<MeasurementItemList>>
+    BuildLegacyUeIndications (const KpmIndicationMessageValues &values);
+
+    /**
+    * Builds, on demand, the legacy MeasurementItemList view of the cell
+    * KPIs
+    *
+    * \param values the message values holding the KPIs
+    * \return the cell list
+    */
+    static Ptr<MeasurementItemList>
+    BuildLegacyCellMeasurementItems (const KpmIndicationMessageValues &values);
     
     void* m_buffer;
     size_t m_size;
+    size_t m_capacity; //!< allocated size of m_buffer, see EncodeBufferPool
 // ======================================================================================
     BIT_STRING_t cp_amf_region_id_to_bit_string(uint8_t src)
     {
@@ -342,7 +515,16 @@ OCTET_STRING_t cp_plmn_identity_to_octant_string (uint8_t src)
 
     
   private:
-    static void CheckConstraints (KpmIndicationMessageValues values);
+    friend class KpmReportTree;
+
+    /**
+    * BuildIndications on the first ueCount UE reports of an updated tree
+    */
+    static uint32_t BuildIndications (Ptr<KpmReportTree> tree, size_t ueCount, uint32_t maxUes,
+                                      uint32_t maxSize,
+                                      std::function<void (Ptr<KpmIndicationMessage>)> sink);
+
+    static void CheckConstraints (const KpmIndicationMessageValues &values);
     /*
     void FillPmContainer (PF_Container_t *ranContainer, 
                           Ptr<PmContainerValues> values);
@@ -353,10 +535,148 @@ OCTET_STRING_t cp_plmn_identity_to_octant_string (uint8_t src)
     //void FillODuContainer (PF_Container_t *ranContainer, 
                            Ptr<ODuContainerValues> values);
     */
+    /**
+    * \return a copy of values.m_ueKpis with values.m_ueIndications added
+    */
+    static KpiTable MergeLegacyUeIndications (const KpmIndicationMessageValues &values);
+
+    /**
+    * Fills and encodes a Format 1 message with the subscribed cell KPIs
+    */
+    void FillAndEncodeKpmCellIndicationMessage (E2SM_KPM_IndicationMessage_t *descriptor,
+                                                const KpmIndicationMessageValues &values);
+
+    /**
+    * \param ueSlots the UE slots to encode, or nullptr for every UE
+    */
     void FillAndEncodeKpmIndicationMessage (E2SM_KPM_IndicationMessage_t *descriptor,
-                                            KpmIndicationMessageValues values);
+                                            const KpmIndicationMessageValues &values,
+                                            const std::vector<size_t> *ueSlots);
     void Encode (E2SM_KPM_IndicationMessage_t *descriptor);
   };
+
+  /**
+  * gNB UE IDs of the UEs reported in the KPM indications, built once per UE
+  * and shared by every report of the UE. The IDs are derived from the
+  * numeric UE ID, typically the IMSI, so that an xApp can follow a UE from
+  * one report to the next and address it in a RIC Control:
+  * - the PLMN identity of the GUAMI is the MCC and 2-digit MNC of a
+  *   15-digit IMSI, MCC 111 and MNC 11 otherwise
+  * - the AMF-UE-NGAP-ID is the MSIN of a 15-digit IMSI, the digits after
+  *   the MNC, and the low 40 bits of the number otherwise
+  * - the RAN UE ID is the number, as a 64-bit big-endian number
+  * - the AMF region, set and pointer are 0, the simulated core having a
+  *   single AMF, as in MockRic::SendControl
+  * UE IDs which are not numbers of at most 19 digits are hashed into the
+  * number. IDs differing only by leading zeros share the same gNB UE ID.
+  *
+  * A KpmReportTree holds the IDs of its UEs, and evicts them when the UEs
+  * leave its report. The IDs of UEs only encoded without a tree stay
+  * cached, which costs about 100 bytes per such UE. The cache is
+  * thread-safe.
+  */
+  class KpmUeIdCache
+  {
+  public:
+    /**
+    * The values encoded in the UE ID of a UE
+    */
+    struct UeIdentity
+    {
+      uint64_t m_imsi; //!< cache key, the numeric UE ID or the hash of another UE ID
+      uint16_t m_mcc;
+      uint16_t m_mnc;
+      uint64_t m_amfUeNgapId;
+    };
+
+    /**
+    * \param ueId the UE ID, as in the slots of the UE KPI table
+    * \return the values of the UE ID of the UE
+    */
+    static UeIdentity GetIdentity (const std::string &ueId);
+
+    /**
+    * \param ueId the UE ID, as in the slots of the UE KPI table
+    * \return the gNB UE ID of the UE, built if not cached, which must not
+    *         be modified nor freed, and stays valid until the matching
+    *         Release
+    */
+    static UEID_GNB_t *Acquire (const std::string &ueId);
+
+    /**
+    * Drops a reference taken by Acquire
+    *
+    * \param ueId the UE ID
+    * \param evict if true, the UE left a report and its gNB UE ID is freed
+    *        once no reference is left, otherwise it stays cached
+    */
+    static void Release (const std::string &ueId, bool evict = false);
+
+    /**
+    * \return the number of cached UE IDs
+    */
+    static size_t GetSize ();
+  };
+
+  /**
+  * Format 3 UE measurement reports kept from one indication to the next,
+  * for a node whose UEs and KPIs stay the same over many reporting
+  * periods. Update builds the report items of the UEs that appeared,
+  * drops the ones of the UEs no longer reported, rebuilds the items of a
+  * UE whose set of KPIs, or their encoding, changed, and only overwrites the measurement
+  * record values of every other UE, so that a report costs in proportion
+  * to the churn instead of to the UEs times the KPIs.
+  *
+  * A tree serves a single stream of reports, typically one subscription,
+  * and is not thread-safe.
+  */
+  class KpmReportTree : public SimpleRefCount<KpmReportTree>
+  {
+  public:
+    KpmReportTree ();
+    ~KpmReportTree ();
+
+    /**
+    * Brings the UE reports in line with the UE KPIs of values. As in
+    * KpmIndicationMessage, the reports follow the slot order and UEs whose
+    * KPIs are all filtered out are skipped.
+    *
+    * \param values the message values
+    * \return the number of UE reports
+    */
+    size_t Update (const KpmIndicationMessage::KpmIndicationMessageValues &values);
+
+    /**
+    * Drops the report of a UE right away, for instance on detach, instead
+    * of at the next Update
+    *
+    * \param ueId the UE ID, as in the slots of the UE KPI table
+    */
+    void RemoveUe (const std::string &ueId);
+
+    /**
+    * \return the number of UE reports
+    */
+    size_t GetUeCount () const;
+
+    /**
+    * \return the number of UE report items built, or rebuilt, so far
+    */
+    uint64_t GetBuildCount () const;
+
+  private:
+    friend class KpmIndicationMessage;
+
+    struct UeReport;
+
+    std::unordered_map<std::string, std::unique_ptr<UeReport>> m_ues;
+    std::vector<UEMeasurementReportItem_t *> m_reports; //!< in slot order, as last updated
+    std::unordered_map<std::string, uint32_t> m_kpiIds; //!< stable ID of each KPI name
+    std::vector<uint32_t> m_columnKpis; //!< KPI ID of each column of the last table
+    std::vector<size_t> m_columns; //!< scratch, the columns of a UE report
+    uint64_t m_generation; //!< incremented at every Update
+    uint64_t m_builds;
+  };
 }
 
 #endif /* KPM_INDICATION_H */
\ No newline at end of file
@@ -0,0 +1,258 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/kpm-subscription-filter.h>
+#include <ns3/log.h>
+
+extern "C" {
+#include "E2SM-KPM-ActionDefinition.h"
+#include "E2SM-KPM-ActionDefinition-Format1.h"
+#include "E2SM-KPM-ActionDefinition-Format2.h"
+#include "E2SM-KPM-ActionDefinition-Format3.h"
+#include "E2SM-KPM-ActionDefinition-Format4.h"
+#include "E2SM-KPM-ActionDefinition-Format5.h"
+#include "MeasurementInfoItem.h"
+#include "MeasurementCondItem.h"
+#include "MeasurementType.h"
+}
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpmSubscriptionFilter");
+
+KpmSubscriptionFilter::KpmSubscriptionFilter () : m_granularityPeriod (0)
+{
+}
+
+kpi::Id
+KpmSubscriptionFilter::GetKpiFromMeasId (long measId)
+{
+  if (measId < 1 || measId > kpi::COUNT)
+    {
+      return kpi::COUNT;
+    }
+  return static_cast<kpi::Id> (measId - 1);
+}
+
+const KpiHistogram *
+KpmSubscriptionFilter::GetHistogramFromMeasId (long measId)
+{
+  long index = measId - GetHistogramMeasId (KPI_HISTOGRAMS[0]);
+  if (index < 0 || index >= (long) (sizeof (KPI_HISTOGRAMS) / sizeof (KPI_HISTOGRAMS[0])))
+    {
+      return nullptr;
+    }
+  return &KPI_HISTOGRAMS[index];
+}
+
+void
+KpmSubscriptionFilter::AddKpi (kpi::Id id, bool byMeasId)
+{
+  m_ids.set (id);
+  if (byMeasId)
+    {
+      m_byMeasId.set (id);
+    }
+  m_names.insert (std::string (KPI_SCHEMA[id].m_name, KPI_SCHEMA[id].m_nameSize));
+}
+
+void
+KpmSubscriptionFilter::AddName (const std::string &name)
+{
+  const KpiHistogram *histogram = FindKpiHistogram (name);
+  if (histogram != nullptr)
+    {
+      // a histogram stands for all of its bins
+      for (uint8_t bin = 0; bin < histogram->m_binCount; ++bin)
+        {
+          AddKpi (static_cast<kpi::Id> (histogram->m_firstBin + bin), false);
+        }
+      return;
+    }
+
+  kpi::Id id = FindKpi (name);
+  if (id == kpi::COUNT)
+    {
+      NS_LOG_LOGIC ("Subscribed KPI " << name << " is not in the schema");
+      m_names.insert (name);
+      return;
+    }
+  AddKpi (id, false);
+}
+
+void
+KpmSubscriptionFilter::AddMeasId (long measId)
+{
+  const KpiHistogram *histogram = GetHistogramFromMeasId (measId);
+  if (histogram != nullptr)
+    {
+      for (uint8_t bin = 0; bin < histogram->m_binCount; ++bin)
+        {
+          AddKpi (static_cast<kpi::Id> (histogram->m_firstBin + bin), true);
+        }
+      return;
+    }
+
+  kpi::Id id = GetKpiFromMeasId (measId);
+  if (id == kpi::COUNT)
+    {
+      NS_LOG_WARN ("Ignoring unknown measurement ID " << measId);
+      return;
+    }
+  AddKpi (id, true);
+}
+
+bool
+KpmSubscriptionFilter::IsSubscribed (const std::string &name) const
+{
+  return m_names.count (name) != 0;
+}
+
+size_t
+KpmSubscriptionFilter::GetSize () const
+{
+  return m_names.size ();
+}
+
+bool
+KpmSubscriptionFilter::IsCellLevel () const
+{
+  // names outside the schema have no known scope
+  if (m_ids.none () || m_ids.count () != m_names.size ())
+    {
+      return false;
+    }
+  for (size_t id = 0; id < kpi::COUNT; ++id)
+    {
+      if (m_ids.test (id) && KPI_SCHEMA[id].m_scope != KpiScope::CELL)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+* Adds the KPI of a measurement type to the filter
+*/
+static void
+AddMeasurementType (KpmSubscriptionFilter &filter, const MeasurementType_t &measType)
+{
+  switch (measType.present)
+    {
+    case MeasurementType_PR_measName:
+      filter.AddName (std::string ((const char *) measType.choice.measName.buf,
+                                   measType.choice.measName.size));
+      break;
+    case MeasurementType_PR_measID:
+      filter.AddMeasId (measType.choice.measID);
+      break;
+    default:
+      NS_LOG_WARN ("Ignoring an empty measurement type");
+      break;
+    }
+}
+
+static void
+AddMeasurementInfoList (KpmSubscriptionFilter &filter,
+                        const E2SM_KPM_ActionDefinition_Format1_t &subscription)
+{
+  for (int i = 0; i < subscription.measInfoList.list.count; ++i)
+    {
+      AddMeasurementType (filter, subscription.measInfoList.list.array[i]->measType);
+    }
+  filter.SetGranularityPeriod (subscription.granulPeriod);
+}
+
+void
+KpmSubscriptionFilter::SetGranularityPeriod (uint32_t period)
+{
+  m_granularityPeriod = period;
+}
+
+uint32_t
+KpmSubscriptionFilter::GetGranularityPeriod () const
+{
+  return m_granularityPeriod;
+}
+
+Ptr<KpmSubscriptionFilter>
+KpmSubscriptionFilter::Decode (const uint8_t *buffer, size_t size)
+{
+  if (buffer == nullptr || size == 0)
+    {
+      NS_LOG_LOGIC ("No action definition, every KPI is reported");
+      return nullptr;
+    }
+
+  E2SM_KPM_ActionDefinition_t *definition = nullptr;
+  asn_dec_rval_t decoded = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER,
+                                       &asn_DEF_E2SM_KPM_ActionDefinition,
+                                       (void **) &definition, buffer, size);
+  if (decoded.code != RC_OK)
+    {
+      NS_LOG_WARN ("Cannot decode the KPM action definition, every KPI is reported");
+      ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_ActionDefinition, definition);
+      return nullptr;
+    }
+
+  Ptr<KpmSubscriptionFilter> filter = Create<KpmSubscriptionFilter> ();
+  auto &formats = definition->actionDefinition_formats;
+  switch (formats.present)
+    {
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format1:
+      AddMeasurementInfoList (*filter, *formats.choice.actionDefinition_Format1);
+      break;
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format2:
+      AddMeasurementInfoList (*filter, formats.choice.actionDefinition_Format2->subscriptInfo);
+      break;
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format3:
+      {
+        const MeasurementCondList_t &conditions =
+            formats.choice.actionDefinition_Format3->measCondList;
+        for (int i = 0; i < conditions.list.count; ++i)
+          {
+            AddMeasurementType (*filter, conditions.list.array[i]->measType);
+          }
+        filter->SetGranularityPeriod (formats.choice.actionDefinition_Format3->granulPeriod);
+        break;
+      }
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format4:
+      AddMeasurementInfoList (*filter, formats.choice.actionDefinition_Format4->subscriptionInfo);
+      break;
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format5:
+      AddMeasurementInfoList (*filter, formats.choice.actionDefinition_Format5->subscriptionInfo);
+      break;
+    default:
+      break;
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_ActionDefinition, definition);
+
+  if (filter->GetSize () == 0)
+    {
+      NS_LOG_WARN ("No measurement in the KPM action definition, every KPI is reported");
+      return nullptr;
+    }
+  NS_LOG_DEBUG ("KPM subscription to " << filter->GetSize () << " KPIs, granularity period "
+                                       << filter->GetGranularityPeriod () << " ms");
+  return filter;
+}
+
+} // namespace ns3
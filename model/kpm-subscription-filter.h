@@ -0,0 +1,158 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef KPM_SUBSCRIPTION_FILTER_H
+#define KPM_SUBSCRIPTION_FILTER_H
+
+#include "ns3/object.h"
+#include "ns3/kpi-schema.h"
+
+#include <bitset>
+#include <string>
+#include <unordered_set>
+
+namespace ns3 {
+
+/**
+* Set of KPIs a RIC subscription asked for, decoded from the measurement
+* list of its E2SM-KPM action definition. KPIs of KPI_SCHEMA are matched
+* through a bitset indexed by kpi::Id, so the helpers can drop an
+* unsubscribed KPI before computing it; other names are kept in a hash
+* set. A null filter stands for "every KPI", as before subscriptions were
+* decoded.
+*/
+class KpmSubscriptionFilter : public SimpleRefCount<KpmSubscriptionFilter>
+{
+public:
+  /**
+  * Creates an empty filter, which accepts no KPI
+  */
+  KpmSubscriptionFilter ();
+
+  /**
+  * Decodes an APER encoded E2SM-KPM action definition. Formats 1, 2, 4
+  * and 5 contribute their measurement info list, Format 3 its measurement
+  * condition list.
+  *
+  * \param buffer the encoded action definition
+  * \param size the size of the buffer
+  * \return the filter, or nullptr if the buffer is empty or cannot be
+  *         decoded, in which case every KPI is reported
+  */
+  static Ptr<KpmSubscriptionFilter> Decode (const uint8_t *buffer, size_t size);
+
+  /**
+  * \param measId a measurement ID
+  * \return the KPI of KPI_SCHEMA with that measurement ID, or kpi::COUNT
+  *         if there is none. The measurement ID of a KPI is its kpi::Id
+  *         plus one, since measID 0 is not allowed.
+  */
+  static kpi::Id GetKpiFromMeasId (long measId);
+
+  /**
+  * \param measId a measurement ID
+  * \return the histogram of KPI_HISTOGRAMS with that measurement ID, see
+  *         GetHistogramMeasId, or nullptr if there is none
+  */
+  static const KpiHistogram *GetHistogramFromMeasId (long measId);
+
+  /**
+  * Subscribes a KPI by name, or all the bins of a histogram of
+  * KPI_HISTOGRAMS by the histogram name
+  *
+  * \param name the measurement name
+  */
+  void AddName (const std::string &name);
+
+  /**
+  * Subscribes a KPI of KPI_SCHEMA, or all the bins of a histogram, by
+  * measurement ID. Unknown IDs are ignored.
+  *
+  * \param measId the measurement ID
+  */
+  void AddMeasId (long measId);
+
+  /**
+  * \param id a KPI of KPI_SCHEMA
+  * \return true if the KPI is subscribed
+  */
+  bool
+  IsSubscribed (kpi::Id id) const
+  {
+    return m_ids.test (id);
+  }
+
+  /**
+  * \param name a measurement name
+  * \return true if the KPI is subscribed
+  */
+  bool IsSubscribed (const std::string &name) const;
+
+  /**
+  * \param id a KPI of KPI_SCHEMA
+  * \return true if the RIC subscribed the KPI by measurement ID, in which
+  *         case the KPI is reported with its ID rather than its name
+  */
+  bool
+  IsSubscribedByMeasId (kpi::Id id) const
+  {
+    return m_byMeasId.test (id);
+  }
+
+  /**
+  * \return the number of subscribed KPIs
+  */
+  size_t GetSize () const;
+
+  /**
+  * \return true if every subscribed KPI is a cell KPI of KPI_SCHEMA, in
+  *         which case the subscription is reported with a single cell-level
+  *         Format 1 indication message instead of the UE reports
+  */
+  bool IsCellLevel () const;
+
+  /**
+  * \param period the granularity period of the action definition, in ms
+  */
+  void SetGranularityPeriod (uint32_t period);
+
+  /**
+  * \return the granularity period in ms, 0 if not set
+  */
+  uint32_t GetGranularityPeriod () const;
+
+private:
+  /**
+  * Subscribes a KPI of KPI_SCHEMA
+  *
+  * \param id the KPI
+  * \param byMeasId true if subscribed by measurement ID
+  */
+  void AddKpi (kpi::Id id, bool byMeasId);
+
+  std::bitset<kpi::COUNT> m_ids; //!< subscribed KPIs of KPI_SCHEMA
+  std::bitset<kpi::COUNT> m_byMeasId; //!< KPIs of m_ids subscribed by measurement ID
+  std::unordered_set<std::string> m_names; //!< every subscribed measurement name
+  uint32_t m_granularityPeriod; //!< granularity period in ms, 0 if not set
+};
+
+} // namespace ns3
+
+#endif /* KPM_SUBSCRIPTION_FILTER_H */
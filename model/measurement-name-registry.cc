@@ -0,0 +1,96 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/measurement-name-registry.h>
+#include <ns3/log.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MeasurementNameRegistry");
+
+namespace {
+
+struct Registry
+{
+  Registry ()
+  {
+    for (size_t i = 0; i < kpi::COUNT; ++i)
+      {
+        MeasurementTypeName_t &name = m_schemaNames[i];
+        name.buf = (uint8_t *) KPI_SCHEMA[i].m_name;
+        name.size = KPI_SCHEMA[i].m_nameSize;
+        m_names.emplace (std::string (KPI_SCHEMA[i].m_name, KPI_SCHEMA[i].m_nameSize), name);
+      }
+  }
+
+  MeasurementTypeName_t m_schemaNames[kpi::COUNT] = {};
+  std::mutex m_mutex;
+  // the nodes never move, so the names of the map can be handed out and the
+  // names outside the schema point to the key of their node
+  std::unordered_map<std::string, MeasurementTypeName_t> m_names;
+};
+
+/**
+* Never destroyed, since messages may be encoded until the very end of the
+* process
+*/
+Registry &
+GetRegistry ()
+{
+  static Registry *registry = new Registry ();
+  return *registry;
+}
+
+} // namespace
+
+const MeasurementTypeName_t &
+MeasurementNameRegistry::Get (kpi::Id id)
+{
+  NS_ASSERT (id < kpi::COUNT);
+  return GetRegistry ().m_schemaNames[id];
+}
+
+const MeasurementTypeName_t &
+MeasurementNameRegistry::Intern (const std::string &name)
+{
+  Registry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.m_mutex);
+  auto inserted = registry.m_names.emplace (name, MeasurementTypeName_t ());
+  if (inserted.second)
+    {
+      NS_LOG_LOGIC ("Interning measurement name " << name);
+      inserted.first->second.buf = (uint8_t *) inserted.first->first.data ();
+      inserted.first->second.size = name.size ();
+    }
+  return inserted.first->second;
+}
+
+size_t
+MeasurementNameRegistry::GetSize ()
+{
+  Registry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.m_mutex);
+  return registry.m_names.size ();
+}
+
+} // namespace ns3
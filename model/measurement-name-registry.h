@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MEASUREMENT_NAME_REGISTRY_H
+#define MEASUREMENT_NAME_REGISTRY_H
+
+#include <ns3/kpi-schema.h>
+
+#include <string>
+
+extern "C" {
+#include "MeasurementTypeName.h"
+}
+
+namespace ns3 {
+
+/**
+* Interned measurement names, shared by every message carrying them.
+*
+* Each name is held once, in an immutable buffer of the right size, for
+* the whole process: the names of KPI_SCHEMA are the schema's own string
+* literals and any other name is copied on its first use. The encoders
+* point the measurement names of the messages they build at these
+* buffers, which must therefore never be freed with the message, e.g.,
+* by ASN_STRUCT_FREE. The registry is thread-safe.
+*/
+class MeasurementNameRegistry
+{
+public:
+  /**
+  * \param id a KPI of KPI_SCHEMA
+  * \return the measurement name of the KPI, without any lookup
+  */
+  static const MeasurementTypeName_t &Get (kpi::Id id);
+
+  /**
+  * \param name the measurement name
+  * \return the interned measurement name, added on first use
+  */
+  static const MeasurementTypeName_t &Intern (const std::string &name);
+
+  /**
+  * \return the number of interned names, the KPI_SCHEMA ones included
+  */
+  static size_t GetSize ();
+};
+
+} // namespace ns3
+
+#endif /* MEASUREMENT_NAME_REGISTRY_H */
@@ -0,0 +1,697 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/mock-ric.h>
+#include <ns3/asn1c-arena.h>
+#include <ns3/encode-buffer-pool.h>
+#include <ns3/kpi-schema.h>
+
+#include <ns3/double.h>
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+
+#include <chrono>
+#include "encode_e2apv1.hpp"
+
+extern "C" {
+#include "E2SM-KPM-ActionDefinition.h"
+#include "E2SM-KPM-ActionDefinition-Format1.h"
+#include "E2SM-KPM-EventTriggerDefinition.h"
+#include "E2SM-KPM-EventTriggerDefinition-Format1.h"
+#include "MeasurementInfoItem.h"
+#include "LabelInfoItem.h"
+#include "E2SM-RC-ControlHeader.h"
+#include "E2SM-RC-ControlHeader-Format1.h"
+#include "E2SM-RC-ControlMessage.h"
+#include "E2SM-RC-ControlMessage-Format1.h"
+#include "E2SM-RC-ControlMessage-Format1-Item.h"
+#include "RANParameter-ValueType.h"
+#include "RANParameter-ValueType-Choice-ElementTrue.h"
+#include "RANParameter-Value.h"
+#include "UEID.h"
+#include "UEID-GNB.h"
+#include "RICsubscriptionRequest.h"
+#include "RICsubscriptionDetails.h"
+#include "RICaction-ToBeSetup-Item.h"
+#include "RICcontrolRequest.h"
+#include "RICindication.h"
+#include "ProtocolIE-Field.h"
+#include "InitiatingMessage.h"
+#include "SuccessfulOutcome.h"
+}
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MockRic");
+
+NS_OBJECT_ENSURE_REGISTERED (MockRic);
+
+TypeId
+MockRic::GetTypeId ()
+{
+  static TypeId tid =
+      TypeId ("ns3::MockRic")
+          .SetParent<Object> ()
+          .AddConstructor<MockRic> ()
+          .AddAttribute ("HandoverControlRate",
+                         "Handover RIC Control Requests sent per second once the E2 Setup is "
+                         "complete. 0 sends none.",
+                         DoubleValue (0),
+                         MakeDoubleAccessor (&MockRic::m_handoverRate),
+                         MakeDoubleChecker<double> (0))
+          .AddAttribute ("QosControlRate",
+                         "QoS RIC Control Requests sent per second once the E2 Setup is "
+                         "complete. 0 sends none.",
+                         DoubleValue (0),
+                         MakeDoubleAccessor (&MockRic::m_qosRate),
+                         MakeDoubleChecker<double> (0))
+          .AddAttribute ("ControlRanFunctionId",
+                         "RAN function of the E2SM-RC RIC Control Requests",
+                         UintegerValue (300),
+                         MakeUintegerAccessor (&MockRic::m_controlRanFunctionId),
+                         MakeUintegerChecker<uint32_t> ())
+          .AddAttribute ("ControlUeCount",
+                         "The periodic controls cycle over the UEs with AMF UE NGAP ID 1 to "
+                         "ControlUeCount",
+                         UintegerValue (1),
+                         MakeUintegerAccessor (&MockRic::m_controlUes),
+                         MakeUintegerChecker<uint32_t> (1))
+          .AddAttribute ("HandoverTargetCell",
+                         "Target cell of the periodic handover controls",
+                         UintegerValue (2),
+                         MakeUintegerAccessor (&MockRic::m_targetCell),
+                         MakeUintegerChecker<uint16_t> (0, 9));
+  return tid;
+}
+
+MockRic::MockRic ()
+  : m_handoverRate (0),
+    m_qosRate (0),
+    m_controlRanFunctionId (300),
+    m_controlUes (1),
+    m_targetCell (2),
+    m_setup (false),
+    m_stop (false),
+    m_nextInstanceId (1),
+    m_setupRequests (0),
+    m_subscriptionResponses (0),
+    m_indications (0),
+    m_indicationBytes (0),
+    m_decodeErrors (0),
+    m_controlsSent (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MockRic::~MockRic ()
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+}
+
+void
+MockRic::DoDispose ()
+{
+  Stop ();
+  m_transport = nullptr;
+  Object::DoDispose ();
+}
+
+void
+MockRic::SetTransport (Ptr<E2Transport> transport)
+{
+  m_transport = transport;
+}
+
+void
+MockRic::SetIndicationCallback (IndicationCallback callback)
+{
+  m_indicationCallback = callback;
+}
+
+std::vector<uint8_t>
+MockRic::EncodeEventTrigger (uint32_t reportingPeriod)
+{
+  Asn1Arena arena;
+  E2SM_KPM_EventTriggerDefinition_Format1_t *format1 =
+      arena.New<E2SM_KPM_EventTriggerDefinition_Format1_t> ();
+  format1->reportingPeriod = reportingPeriod;
+  E2SM_KPM_EventTriggerDefinition_t *trigger = arena.New<E2SM_KPM_EventTriggerDefinition_t> ();
+  trigger->eventDefinition_formats.present =
+      E2SM_KPM_EventTriggerDefinition__eventDefinition_formats_PR_eventDefinition_Format1;
+  trigger->eventDefinition_formats.choice.eventDefinition_Format1 = format1;
+
+  void *buffer = nullptr;
+  size_t capacity = 0;
+  asn_enc_rval_t encoded = EncodeBufferPool::Encode (&asn_DEF_E2SM_KPM_EventTriggerDefinition,
+                                                     trigger, &buffer, &capacity);
+  NS_ABORT_MSG_IF (encoded.encoded < 0, "Cannot encode the event trigger definition");
+  std::vector<uint8_t> bytes ((uint8_t *) buffer, (uint8_t *) buffer + encoded.encoded);
+  EncodeBufferPool::Release (buffer, capacity);
+  return bytes;
+}
+
+std::vector<uint8_t>
+MockRic::EncodeActionDefinition (const std::vector<std::string> &measurements,
+                                 uint32_t granularityPeriod, bool byMeasId)
+{
+  Asn1Arena arena;
+  E2SM_KPM_ActionDefinition_Format1_t *format1 = arena.New<E2SM_KPM_ActionDefinition_Format1_t> ();
+  MeasurementInfoItem_t *items = arena.NewArray<MeasurementInfoItem_t> (measurements.size ());
+  LabelInfoItem_t *label = arena.New<LabelInfoItem_t> ();
+  label->measLabel.noLabel = arena.New<long> ();
+  *label->measLabel.noLabel = MeasurementLabel__noLabel_true;
+  arena.ReserveList (&format1->measInfoList.list, measurements.size ());
+  for (size_t i = 0; i < measurements.size (); ++i)
+    {
+      kpi::Id id = byMeasId ? FindKpi (measurements[i]) : kpi::COUNT;
+      const KpiHistogram *histogram = byMeasId ? FindKpiHistogram (measurements[i]) : nullptr;
+      if (id != kpi::COUNT || histogram != nullptr)
+        {
+          items[i].measType.present = MeasurementType_PR_measID;
+          items[i].measType.choice.measID =
+              histogram != nullptr ? GetHistogramMeasId (*histogram) : GetMeasId (id);
+        }
+      else
+        {
+          items[i].measType.present = MeasurementType_PR_measName;
+          items[i].measType.choice.measName.buf =
+              arena.CopyBytes (measurements[i].data (), measurements[i].size ());
+          items[i].measType.choice.measName.size = measurements[i].size ();
+        }
+      // the label is only read by the encoder, it can be shared
+      arena.ReserveList (&items[i].labelInfoList.list, 1);
+      ASN_SEQUENCE_ADD (&items[i].labelInfoList.list, label);
+      ASN_SEQUENCE_ADD (&format1->measInfoList.list, &items[i]);
+    }
+  format1->granulPeriod = granularityPeriod;
+
+  E2SM_KPM_ActionDefinition_t *definition = arena.New<E2SM_KPM_ActionDefinition_t> ();
+  definition->ric_Style_Type = 1;
+  definition->actionDefinition_formats.present =
+      E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format1;
+  definition->actionDefinition_formats.choice.actionDefinition_Format1 = format1;
+
+  void *buffer = nullptr;
+  size_t capacity = 0;
+  asn_enc_rval_t encoded = EncodeBufferPool::Encode (&asn_DEF_E2SM_KPM_ActionDefinition,
+                                                     definition, &buffer, &capacity);
+  NS_ABORT_MSG_IF (encoded.encoded < 0, "Cannot encode the action definition");
+  std::vector<uint8_t> bytes ((uint8_t *) buffer, (uint8_t *) buffer + encoded.encoded);
+  EncodeBufferPool::Release (buffer, capacity);
+  return bytes;
+}
+
+void
+MockRic::AddSubscription (long ranFunctionId, const std::vector<uint8_t> &eventTrigger,
+                          const std::vector<uint8_t> &actionDefinition)
+{
+  Subscription subscription = {ranFunctionId, eventTrigger, actionDefinition};
+  std::unique_lock<std::mutex> lock (m_mutex);
+  if (!m_setup)
+    {
+      m_subscriptions.push_back (subscription);
+      return;
+    }
+  lock.unlock ();
+  SendSubscription (subscription);
+}
+
+void
+MockRic::Start ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (!m_transport, "Set the transport first");
+  if (!m_transport->Connect (
+          [this] (const uint8_t *buffer, size_t size) { Receive (buffer, size); }))
+    {
+      NS_FATAL_ERROR ("Cannot connect the mock RIC transport");
+    }
+  if (m_handoverRate > 0 || m_qosRate > 0)
+    {
+      m_controlThread = std::thread (&MockRic::RunControls, this);
+    }
+}
+
+void
+MockRic::Stop ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+    m_cv.notify_all ();
+  }
+  if (m_controlThread.joinable ())
+    {
+      m_controlThread.join ();
+    }
+  if (m_transport)
+    {
+      m_transport->Close ();
+    }
+}
+
+void
+MockRic::Send (const E2AP_PDU_t *pdu)
+{
+  void *buffer = nullptr;
+  size_t capacity = 0;
+  asn_enc_rval_t encoded = EncodeBufferPool::Encode (&asn_DEF_E2AP_PDU, pdu, &buffer, &capacity);
+  if (encoded.encoded < 0)
+    {
+      NS_LOG_ERROR ("Cannot encode the E2 message of the mock RIC");
+      EncodeBufferPool::Release (buffer, capacity);
+      return;
+    }
+  m_transport->Send ((const uint8_t *) buffer, encoded.encoded);
+  EncodeBufferPool::Release (buffer, capacity);
+}
+
+void
+MockRic::Receive (const uint8_t *buffer, size_t size)
+{
+  E2AP_PDU_t *pdu = nullptr;
+  asn_dec_rval_t decoded =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, (void **) &pdu, buffer, size);
+  if (decoded.code != RC_OK)
+    {
+      NS_LOG_ERROR ("Cannot decode a message of the E2 node");
+      m_decodeErrors++;
+      ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+      return;
+    }
+
+  if (pdu->present == E2AP_PDU_PR_initiatingMessage &&
+      pdu->choice.initiatingMessage->procedureCode == ProcedureCode_id_E2setup)
+    {
+      NS_LOG_DEBUG ("E2 Setup Request received");
+      m_setupRequests++;
+      E2AP_PDU *response = (E2AP_PDU *) calloc (1, sizeof (E2AP_PDU));
+      encoding::generate_e2apv1_setup_response (response);
+      Send (response);
+      ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, response);
+
+      std::vector<Subscription> pending;
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_setup = true;
+        pending.swap (m_subscriptions);
+        m_cv.notify_all ();
+      }
+      for (const Subscription &subscription : pending)
+        {
+          SendSubscription (subscription);
+        }
+    }
+  else if (pdu->present == E2AP_PDU_PR_initiatingMessage &&
+           pdu->choice.initiatingMessage->procedureCode == ProcedureCode_id_RICindication)
+    {
+      HandleIndication (pdu, size);
+    }
+  else if (pdu->present == E2AP_PDU_PR_successfulOutcome &&
+           pdu->choice.successfulOutcome->procedureCode == ProcedureCode_id_RICsubscription)
+    {
+      NS_LOG_DEBUG ("RIC Subscription Response received");
+      m_subscriptionResponses++;
+    }
+  else
+    {
+      NS_LOG_WARN ("Ignoring E2 message of type " << pdu->present);
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+}
+
+void
+MockRic::HandleIndication (E2AP_PDU_t *pdu, size_t size)
+{
+  RICindication_t &indication = pdu->choice.initiatingMessage->value.choice.RICindication;
+  long ranFunctionId = -1;
+  long instanceId = -1;
+  long sequenceNumber = -1;
+  E2SM_KPM_IndicationHeader_t *header = nullptr;
+  E2SM_KPM_IndicationMessage_t *message = nullptr;
+  bool decoded = true;
+  for (int i = 0; i < indication.protocolIEs.list.count; ++i)
+    {
+      RICindication_IEs_t *ie = indication.protocolIEs.list.array[i];
+      switch (ie->value.present)
+        {
+        case RICindication_IEs__value_PR_RICrequestID:
+          instanceId = ie->value.choice.RICrequestID.ricInstanceID;
+          break;
+        case RICindication_IEs__value_PR_RANfunctionID:
+          ranFunctionId = ie->value.choice.RANfunctionID;
+          break;
+        case RICindication_IEs__value_PR_RICindicationSN:
+          sequenceNumber = ie->value.choice.RICindicationSN;
+          break;
+        case RICindication_IEs__value_PR_RICindicationHeader:
+          {
+            RICindicationHeader_t &buffer = ie->value.choice.RICindicationHeader;
+            decoded = decoded && asn_decode (nullptr, ATS_ALIGNED_BASIC_PER,
+                                             &asn_DEF_E2SM_KPM_IndicationHeader,
+                                             (void **) &header, buffer.buf, buffer.size)
+                                         .code == RC_OK;
+            break;
+          }
+        case RICindication_IEs__value_PR_RICindicationMessage:
+          {
+            RICindicationMessage_t &buffer = ie->value.choice.RICindicationMessage;
+            decoded = decoded && asn_decode (nullptr, ATS_ALIGNED_BASIC_PER,
+                                             &asn_DEF_E2SM_KPM_IndicationMessage,
+                                             (void **) &message, buffer.buf, buffer.size)
+                                         .code == RC_OK;
+            break;
+          }
+        default:
+          break;
+        }
+    }
+
+  if (!decoded || header == nullptr || message == nullptr)
+    {
+      NS_LOG_ERROR ("Cannot decode the KPM content of a RIC Indication");
+      m_decodeErrors++;
+    }
+  else
+    {
+      if (m_indicationCallback)
+        {
+          m_indicationCallback (ranFunctionId, instanceId, sequenceNumber, header, message);
+        }
+      m_indicationBytes += size;
+      // counted last, so that WaitForIndications returns after the callback
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_indications++;
+      m_cv.notify_all ();
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationHeader, header);
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, message);
+}
+
+void
+MockRic::SendSubscription (const Subscription &subscription)
+{
+  long instanceId;
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    instanceId = m_nextInstanceId++;
+  }
+  NS_LOG_DEBUG ("Send RIC Subscription Request " << instanceId << " to RAN function "
+                                                 << subscription.m_ranFunctionId);
+
+  Asn1Arena arena;
+  RICsubscriptionRequest_IEs_t *ies = arena.NewArray<RICsubscriptionRequest_IEs_t> (3);
+  ies[0].id = ProtocolIE_ID_id_RICrequestID;
+  ies[0].criticality = Criticality_reject;
+  ies[0].value.present = RICsubscriptionRequest_IEs__value_PR_RICrequestID;
+  ies[0].value.choice.RICrequestID.ricRequestorID = 1;
+  ies[0].value.choice.RICrequestID.ricInstanceID = instanceId;
+
+  ies[1].id = ProtocolIE_ID_id_RANfunctionID;
+  ies[1].criticality = Criticality_reject;
+  ies[1].value.present = RICsubscriptionRequest_IEs__value_PR_RANfunctionID;
+  ies[1].value.choice.RANfunctionID = subscription.m_ranFunctionId;
+
+  ies[2].id = ProtocolIE_ID_id_RICsubscriptionDetails;
+  ies[2].criticality = Criticality_reject;
+  ies[2].value.present = RICsubscriptionRequest_IEs__value_PR_RICsubscriptionDetails;
+  RICsubscriptionDetails_t &details = ies[2].value.choice.RICsubscriptionDetails;
+  details.ricEventTriggerDefinition.buf =
+      arena.CopyBytes (subscription.m_eventTrigger.data (), subscription.m_eventTrigger.size ());
+  details.ricEventTriggerDefinition.size = subscription.m_eventTrigger.size ();
+
+  RICaction_ToBeSetup_ItemIEs_t *action = arena.New<RICaction_ToBeSetup_ItemIEs_t> ();
+  action->id = ProtocolIE_ID_id_RICaction_ToBeSetup_Item;
+  action->criticality = Criticality_ignore;
+  action->value.present = RICaction_ToBeSetup_ItemIEs__value_PR_RICaction_ToBeSetup_Item;
+  RICaction_ToBeSetup_Item_t &item = action->value.choice.RICaction_ToBeSetup_Item;
+  item.ricActionID = 1;
+  item.ricActionType = RICactionType_report;
+  if (!subscription.m_actionDefinition.empty ())
+    {
+      item.ricActionDefinition = arena.New<RICactionDefinition_t> ();
+      item.ricActionDefinition->buf = arena.CopyBytes (subscription.m_actionDefinition.data (),
+                                                       subscription.m_actionDefinition.size ());
+      item.ricActionDefinition->size = subscription.m_actionDefinition.size ();
+    }
+  arena.ReserveList (&details.ricAction_ToBeSetup_List.list, 1);
+  ASN_SEQUENCE_ADD (&details.ricAction_ToBeSetup_List.list,
+                    (ProtocolIE_SingleContainer_t *) action);
+
+  InitiatingMessage_t *message = arena.New<InitiatingMessage_t> ();
+  message->procedureCode = ProcedureCode_id_RICsubscription;
+  message->criticality = Criticality_reject;
+  message->value.present = InitiatingMessage__value_PR_RICsubscriptionRequest;
+  RICsubscriptionRequest_t &request = message->value.choice.RICsubscriptionRequest;
+  arena.ReserveList (&request.protocolIEs.list, 3);
+  for (int i = 0; i < 3; ++i)
+    {
+      ASN_SEQUENCE_ADD (&request.protocolIEs.list, &ies[i]);
+    }
+
+  E2AP_PDU_t *pdu = arena.New<E2AP_PDU_t> ();
+  pdu->present = E2AP_PDU_PR_initiatingMessage;
+  pdu->choice.initiatingMessage = message;
+  Send (pdu);
+}
+
+/**
+* Encodes an E2SM structure built in the arena into an octet string of
+* the arena
+*/
+static bool
+EncodeIntoArena (Asn1Arena &arena, const asn_TYPE_descriptor_t *type, const void *structure,
+                 OCTET_STRING_t *dst)
+{
+  void *buffer = nullptr;
+  size_t capacity = 0;
+  asn_enc_rval_t encoded = EncodeBufferPool::Encode (type, structure, &buffer, &capacity);
+  if (encoded.encoded >= 0)
+    {
+      dst->buf = arena.CopyBytes (buffer, encoded.encoded);
+      dst->size = encoded.encoded;
+    }
+  EncodeBufferPool::Release (buffer, capacity);
+  return encoded.encoded >= 0;
+}
+
+void
+MockRic::SendControl (ControlType type, uint64_t ue, uint16_t targetCell)
+{
+  Asn1Arena arena;
+
+  // E2SM-RC header, the UE with a fixed GUAMI
+  UEID_GNB_t *gnbUeId = arena.New<UEID_GNB_t> ();
+  uint8_t ueBytes[sizeof (uint64_t) + 1];
+  size_t ueSize = 0;
+  for (uint64_t value = ue; ueSize == 0 || value != 0; value >>= 8)
+    {
+      ueBytes[sizeof (ueBytes) - 1 - ueSize++] = value & 0xff;
+    }
+  if (ueBytes[sizeof (ueBytes) - ueSize] & 0x80)
+    {
+      ueBytes[sizeof (ueBytes) - 1 - ueSize++] = 0;
+    }
+  gnbUeId->amf_UE_NGAP_ID.buf = arena.CopyBytes (ueBytes + sizeof (ueBytes) - ueSize, ueSize);
+  gnbUeId->amf_UE_NGAP_ID.size = ueSize;
+  const uint8_t plmn[3] = {0x11, 0xf1, 0x11};
+  gnbUeId->guami.pLMNIdentity.buf = arena.CopyBytes (plmn, sizeof (plmn));
+  gnbUeId->guami.pLMNIdentity.size = sizeof (plmn);
+  const uint8_t zeros[2] = {0, 0};
+  gnbUeId->guami.aMFRegionID.buf = arena.CopyBytes (zeros, 1);
+  gnbUeId->guami.aMFRegionID.size = 1;
+  gnbUeId->guami.aMFSetID.buf = arena.CopyBytes (zeros, 2);
+  gnbUeId->guami.aMFSetID.size = 2;
+  gnbUeId->guami.aMFSetID.bits_unused = 6;
+  gnbUeId->guami.aMFPointer.buf = arena.CopyBytes (zeros, 1);
+  gnbUeId->guami.aMFPointer.size = 1;
+  gnbUeId->guami.aMFPointer.bits_unused = 2;
+
+  E2SM_RC_ControlHeader_Format1_t *headerFormat1 = arena.New<E2SM_RC_ControlHeader_Format1_t> ();
+  headerFormat1->ueID.present = UEID_PR_gNB_UEID;
+  headerFormat1->ueID.choice.gNB_UEID = gnbUeId;
+  E2SM_RC_ControlHeader_t *header = arena.New<E2SM_RC_ControlHeader_t> ();
+  header->ric_controlHeader_formats.present =
+      E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_controlHeader_Format1;
+  header->ric_controlHeader_formats.choice.controlHeader_Format1 = headerFormat1;
+
+  // E2SM-RC message, a single RAN parameter
+  RANParameter_ValueType_Choice_ElementTrue_t *element =
+      arena.New<RANParameter_ValueType_Choice_ElementTrue_t> ();
+  long requestorId;
+  if (type == HANDOVER)
+    {
+      // connected mode mobility, handover control, target primary cell ID
+      requestorId = 1001;
+      headerFormat1->ric_Style_Type = 3;
+      headerFormat1->ric_ControlAction_ID = 1;
+      // the CGI is the PLMN followed by the cell ID, see RicControlMessage
+      std::string cgi = "111" + std::to_string (targetCell);
+      element->ranParameter_value.present = RANParameter_Value_PR_valueOctS;
+      element->ranParameter_value.choice.valueOctS.buf = arena.CopyBytes (cgi.data (), cgi.size ());
+      element->ranParameter_value.choice.valueOctS.size = cgi.size ();
+    }
+  else
+    {
+      // radio bearer control, QoS flow mapping configuration
+      requestorId = 1002;
+      headerFormat1->ric_Style_Type = 1;
+      headerFormat1->ric_ControlAction_ID = 2;
+      element->ranParameter_value.present = RANParameter_Value_PR_valueInt;
+      element->ranParameter_value.choice.valueInt = targetCell;
+    }
+  E2SM_RC_ControlMessage_Format1_Item_t *parameter =
+      arena.New<E2SM_RC_ControlMessage_Format1_Item_t> ();
+  parameter->ranParameter_ID = 1;
+  parameter->ranParameter_valueType.present = RANParameter_ValueType_PR_ranP_Choice_ElementTrue;
+  parameter->ranParameter_valueType.choice.ranP_Choice_ElementTrue = element;
+  E2SM_RC_ControlMessage_Format1_t *messageFormat1 =
+      arena.New<E2SM_RC_ControlMessage_Format1_t> ();
+  arena.ReserveList (&messageFormat1->ranP_List.list, 1);
+  ASN_SEQUENCE_ADD (&messageFormat1->ranP_List.list, parameter);
+  E2SM_RC_ControlMessage_t *controlMessage = arena.New<E2SM_RC_ControlMessage_t> ();
+  controlMessage->ric_controlMessage_formats.present =
+      E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format1;
+  controlMessage->ric_controlMessage_formats.choice.controlMessage_Format1 = messageFormat1;
+
+  // E2AP RIC Control Request
+  RICcontrolRequest_IEs_t *ies = arena.NewArray<RICcontrolRequest_IEs_t> (5);
+  ies[0].id = ProtocolIE_ID_id_RICrequestID;
+  ies[0].criticality = Criticality_reject;
+  ies[0].value.present = RICcontrolRequest_IEs__value_PR_RICrequestID;
+  ies[0].value.choice.RICrequestID.ricRequestorID = requestorId;
+  ies[0].value.choice.RICrequestID.ricInstanceID = 0;
+  ies[1].id = ProtocolIE_ID_id_RANfunctionID;
+  ies[1].criticality = Criticality_reject;
+  ies[1].value.present = RICcontrolRequest_IEs__value_PR_RANfunctionID;
+  ies[1].value.choice.RANfunctionID = m_controlRanFunctionId;
+  ies[2].id = ProtocolIE_ID_id_RICcontrolHeader;
+  ies[2].criticality = Criticality_reject;
+  ies[2].value.present = RICcontrolRequest_IEs__value_PR_RICcontrolHeader;
+  ies[3].id = ProtocolIE_ID_id_RICcontrolMessage;
+  ies[3].criticality = Criticality_reject;
+  ies[3].value.present = RICcontrolRequest_IEs__value_PR_RICcontrolMessage;
+  ies[4].id = ProtocolIE_ID_id_RICcontrolAckRequest;
+  ies[4].criticality = Criticality_reject;
+  ies[4].value.present = RICcontrolRequest_IEs__value_PR_RICcontrolAckRequest;
+  ies[4].value.choice.RICcontrolAckRequest = RICcontrolAckRequest_noAck;
+  if (!EncodeIntoArena (arena, &asn_DEF_E2SM_RC_ControlHeader, header,
+                        &ies[2].value.choice.RICcontrolHeader) ||
+      !EncodeIntoArena (arena, &asn_DEF_E2SM_RC_ControlMessage, controlMessage,
+                        &ies[3].value.choice.RICcontrolMessage))
+    {
+      NS_LOG_ERROR ("Cannot encode the E2SM-RC control");
+      return;
+    }
+
+  InitiatingMessage_t *message = arena.New<InitiatingMessage_t> ();
+  message->procedureCode = ProcedureCode_id_RICcontrol;
+  message->criticality = Criticality_reject;
+  message->value.present = InitiatingMessage__value_PR_RICcontrolRequest;
+  RICcontrolRequest_t &request = message->value.choice.RICcontrolRequest;
+  arena.ReserveList (&request.protocolIEs.list, 5);
+  for (int i = 0; i < 5; ++i)
+    {
+      ASN_SEQUENCE_ADD (&request.protocolIEs.list, &ies[i]);
+    }
+
+  E2AP_PDU_t *pdu = arena.New<E2AP_PDU_t> ();
+  pdu->present = E2AP_PDU_PR_initiatingMessage;
+  pdu->choice.initiatingMessage = message;
+  Send (pdu);
+  m_controlsSent++;
+}
+
+void
+MockRic::RunControls ()
+{
+  typedef std::chrono::steady_clock Clock;
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_cv.wait (lock, [this] { return m_setup || m_stop; });
+
+  Clock::duration handoverInterval =
+      m_handoverRate > 0 ? std::chrono::duration_cast<Clock::duration> (
+                               std::chrono::duration<double> (1 / m_handoverRate))
+                         : Clock::duration::max ();
+  Clock::duration qosInterval =
+      m_qosRate > 0 ? std::chrono::duration_cast<Clock::duration> (
+                          std::chrono::duration<double> (1 / m_qosRate))
+                    : Clock::duration::max ();
+  Clock::time_point now = Clock::now ();
+  Clock::time_point nextHandover =
+      m_handoverRate > 0 ? now + handoverInterval : Clock::time_point::max ();
+  Clock::time_point nextQos = m_qosRate > 0 ? now + qosInterval : Clock::time_point::max ();
+  uint64_t handovers = 0;
+  uint64_t qosControls = 0;
+
+  while (!m_stop)
+    {
+      Clock::time_point next = std::min (nextHandover, nextQos);
+      if (m_cv.wait_until (lock, next, [this] { return m_stop; }))
+        {
+          break;
+        }
+      lock.unlock ();
+      // late controls are sent at once, so that the mean rate is kept
+      now = Clock::now ();
+      while (nextHandover <= now)
+        {
+          SendControl (HANDOVER, 1 + handovers++ % m_controlUes, m_targetCell);
+          nextHandover += handoverInterval;
+        }
+      while (nextQos <= now)
+        {
+          SendControl (QOS, 1 + qosControls++ % m_controlUes, 1);
+          nextQos += qosInterval;
+        }
+      lock.lock ();
+    }
+}
+
+bool
+MockRic::WaitForSetup (uint32_t timeout)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  return m_cv.wait_for (lock, std::chrono::milliseconds (timeout), [this] { return m_setup; });
+}
+
+bool
+MockRic::WaitForIndications (uint64_t count, uint32_t timeout)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  return m_cv.wait_for (lock, std::chrono::milliseconds (timeout),
+                        [this, count] { return m_indications >= count; });
+}
+
+MockRic::Stats
+MockRic::GetStats () const
+{
+  Stats stats;
+  stats.m_setupRequests = m_setupRequests;
+  stats.m_subscriptionResponses = m_subscriptionResponses;
+  stats.m_indications = m_indications;
+  stats.m_indicationBytes = m_indicationBytes;
+  stats.m_decodeErrors = m_decodeErrors;
+  stats.m_controlsSent = m_controlsSent;
+  return stats;
+}
+
+} // namespace ns3
@@ -0,0 +1,222 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MOCK_RIC_H
+#define MOCK_RIC_H
+
+#include "ns3/object.h"
+#include "ns3/e2-transport.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "E2AP-PDU.h"
+#include "E2SM-KPM-IndicationHeader.h"
+#include "E2SM-KPM-IndicationMessage.h"
+}
+
+namespace ns3 {
+
+/**
+* Stand-in for a near-RT RIC, on the other end of an E2Transport, to run
+* and time the whole E2 path without a RIC deployment. It answers the E2
+* Setup Request, then sends the configured RIC Subscription Requests,
+* decodes the KPM RIC Indications it receives, and sends E2SM-RC RIC
+* Control Requests at the configured rates from a thread of its own.
+*
+* Received messages are handled on the E2IoReactor threads.
+*/
+class MockRic : public Object
+{
+public:
+  /**
+  * RIC Control Requests understood by RicControlMessage
+  */
+  enum ControlType
+  {
+    HANDOVER, //!< RIC requestor 1001, the TS xApp
+    QOS //!< RIC requestor 1002, the QoS xApp
+  };
+
+  /**
+  * Called with each decoded KPM indication, on a reactor thread, with the
+  * RIC instance ID of its subscription and its RIC Indication SN. The
+  * structures are freed when it returns.
+  */
+  typedef std::function<void (long ranFunctionId, long instanceId, long sequenceNumber,
+                              const E2SM_KPM_IndicationHeader_t *header,
+                              const E2SM_KPM_IndicationMessage_t *message)>
+      IndicationCallback;
+
+  /**
+  * Counters of the mock RIC
+  */
+  struct Stats
+  {
+    uint64_t m_setupRequests;
+    uint64_t m_subscriptionResponses;
+    uint64_t m_indications; //!< RIC Indications decoded
+    uint64_t m_indicationBytes; //!< E2AP bytes of the decoded RIC Indications
+    uint64_t m_decodeErrors;
+    uint64_t m_controlsSent;
+  };
+
+  static TypeId GetTypeId ();
+
+  MockRic ();
+  virtual ~MockRic ();
+
+  /**
+  * \param transport the RIC end of the association, for instance the
+  *        second end of an InProcessE2Transport pair
+  */
+  void SetTransport (Ptr<E2Transport> transport);
+
+  void SetIndicationCallback (IndicationCallback callback);
+
+  /**
+  * Adds a RIC Subscription Request, sent once the E2 Setup is complete,
+  * or right away if it already is
+  *
+  * \param ranFunctionId the RAN function
+  * \param eventTrigger the encoded RIC event trigger definition
+  * \param actionDefinition the encoded definition of the REPORT action,
+  *        empty for none
+  */
+  void AddSubscription (long ranFunctionId, const std::vector<uint8_t> &eventTrigger,
+                        const std::vector<uint8_t> &actionDefinition);
+
+  /**
+  * \param reportingPeriod in ms
+  * \return an APER encoded E2SM-KPM event trigger definition, Format 1
+  */
+  static std::vector<uint8_t> EncodeEventTrigger (uint32_t reportingPeriod);
+
+  /**
+  * \param measurements the measurement names
+  * \param granularityPeriod in ms
+  * \param byMeasId if true, the KPIs and histograms of the schema are
+  *        subscribed by the measurement IDs of the RAN function description
+  * \return an APER encoded E2SM-KPM action definition, Format 1
+  */
+  static std::vector<uint8_t> EncodeActionDefinition (const std::vector<std::string> &measurements,
+                                                      uint32_t granularityPeriod,
+                                                      bool byMeasId = false);
+
+  /**
+  * Connects the transport and starts the control thread if a control
+  * rate is set
+  */
+  void Start ();
+
+  /**
+  * Stops the control thread and closes the transport
+  */
+  void Stop ();
+
+  /**
+  * Sends a RIC Control Request to the ControlRanFunctionId RAN function
+  *
+  * \param type the control
+  * \param ue the AMF UE NGAP ID of the target UE
+  * \param targetCell the handover target cell, or the QoS value
+  */
+  void SendControl (ControlType type, uint64_t ue, uint16_t targetCell);
+
+  /**
+  * \param timeout in ms
+  * \return false if no E2 Setup Request was received in time
+  */
+  bool WaitForSetup (uint32_t timeout);
+
+  /**
+  * \param count the number of RIC Indications
+  * \param timeout in ms
+  * \return false if fewer indications were decoded in time
+  */
+  bool WaitForIndications (uint64_t count, uint32_t timeout);
+
+  Stats GetStats () const;
+
+protected:
+  virtual void DoDispose ();
+
+private:
+  struct Subscription
+  {
+    long m_ranFunctionId;
+    std::vector<uint8_t> m_eventTrigger;
+    std::vector<uint8_t> m_actionDefinition;
+  };
+
+  /**
+  * Receive callback of the transport
+  */
+  void Receive (const uint8_t *buffer, size_t size);
+
+  void HandleIndication (E2AP_PDU_t *pdu, size_t size);
+
+  /**
+  * Encodes a PDU built in an arena and sends it
+  */
+  void Send (const E2AP_PDU_t *pdu);
+
+  void SendSubscription (const Subscription &subscription);
+
+  /**
+  * Loop of the control thread
+  */
+  void RunControls ();
+
+  Ptr<E2Transport> m_transport;
+  IndicationCallback m_indicationCallback;
+
+  double m_handoverRate; //!< handover controls per second
+  double m_qosRate; //!< QoS controls per second
+  uint32_t m_controlRanFunctionId;
+  uint32_t m_controlUes; //!< controls cycle over the UEs 1 to m_controlUes
+  uint16_t m_targetCell;
+
+  mutable std::mutex m_mutex; //!< protects the members below, signals m_cv
+  std::condition_variable m_cv;
+  bool m_setup; //!< an E2 Setup Request was answered
+  bool m_stop;
+  std::vector<Subscription> m_subscriptions;
+  long m_nextInstanceId;
+  std::thread m_controlThread;
+
+  std::atomic<uint64_t> m_setupRequests;
+  std::atomic<uint64_t> m_subscriptionResponses;
+  std::atomic<uint64_t> m_indications;
+  std::atomic<uint64_t> m_indicationBytes;
+  std::atomic<uint64_t> m_decodeErrors;
+  std::atomic<uint64_t> m_controlsSent;
+};
+
+} // namespace ns3
+
+#endif /* MOCK_RIC_H */
@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+* Bounded lock-free queue with any number of producers and a single
+* consumer. Each cell of the ring carries a sequence number telling
+* whether it is free for the producer of a given position or holds a
+* value for the consumer, so producers only contend on the head index
+* and never wait for each other.
+*
+* Defined in the header since it is a template.
+*/
+template <class T>
+class MpscQueue
+{
+public:
+  /**
+  * \param capacity the maximum number of queued values, rounded up to a
+  *        power of two
+  */
+  explicit MpscQueue (size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity)
+      {
+        size <<= 1;
+      }
+    m_mask = size - 1;
+    m_cells.reset (new Cell[size]);
+    for (size_t i = 0; i < size; ++i)
+      {
+        m_cells[i].m_sequence.store (i, std::memory_order_relaxed);
+      }
+    m_head.store (0, std::memory_order_relaxed);
+    m_tail = 0;
+  }
+
+  MpscQueue (const MpscQueue &) = delete;
+  MpscQueue &operator= (const MpscQueue &) = delete;
+
+  /**
+  * Enqueues a value. May be called by any thread.
+  *
+  * \param value the value
+  * \return false if the queue is full, in which case value is untouched
+  */
+  bool
+  TryPush (T &value)
+  {
+    size_t position = m_head.load (std::memory_order_relaxed);
+    Cell *cell;
+    for (;;)
+      {
+        cell = &m_cells[position & m_mask];
+        size_t sequence = cell->m_sequence.load (std::memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) position;
+        if (diff == 0)
+          {
+            if (m_head.compare_exchange_weak (position, position + 1,
+                                              std::memory_order_relaxed))
+              {
+                break;
+              }
+          }
+        else if (diff < 0)
+          {
+            return false;
+          }
+        else
+          {
+            position = m_head.load (std::memory_order_relaxed);
+          }
+      }
+    cell->m_value = std::move (value);
+    cell->m_sequence.store (position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+  * Dequeues the oldest value. Must only be called by the consumer thread.
+  *
+  * \param value receives the value
+  * \return false if the queue is empty
+  */
+  bool
+  TryPop (T &value)
+  {
+    Cell &cell = m_cells[m_tail & m_mask];
+    size_t sequence = cell.m_sequence.load (std::memory_order_acquire);
+    if ((intptr_t) sequence - (intptr_t) (m_tail + 1) < 0)
+      {
+        return false;
+      }
+    value = std::move (cell.m_value);
+    cell.m_sequence.store (m_tail + m_mask + 1, std::memory_order_release);
+    ++m_tail;
+    return true;
+  }
+
+  /**
+  * \return true if no value is ready for the consumer. Must only be
+  *         called by the consumer thread.
+  */
+  bool
+  IsEmpty () const
+  {
+    const Cell &cell = m_cells[m_tail & m_mask];
+    return (intptr_t) cell.m_sequence.load (std::memory_order_acquire) - (intptr_t) (m_tail + 1) <
+           0;
+  }
+
+  size_t
+  GetCapacity () const
+  {
+    return m_mask + 1;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> m_sequence;
+    T m_value;
+  };
+
+  static const size_t CACHE_LINE = 64;
+
+  std::unique_ptr<Cell[]> m_cells;
+  size_t m_mask;
+  // the indices sit on separate cache lines, so that producers and the
+  // consumer do not invalidate each other's line
+  char m_headPadding[CACHE_LINE];
+  std::atomic<size_t> m_head; //!< next position to push, shared by the producers
+  char m_tailPadding[CACHE_LINE - sizeof (std::atomic<size_t>)];
+  size_t m_tail; //!< next position to pop, owned by the consumer
+};
+
+} // namespace ns3
+
+#endif /* MPSC_QUEUE_H */
@@ -24,8 +24,13 @@
 
 #include <ns3/oran-interface.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/encode-buffer-pool.h>
  
+#include <ns3/boolean.h>
 #include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+#include <algorithm>
 #include <thread>
 #include "encode_e2apv1.hpp"
 #include<unistd.h>
@@ -34,6 +39,10 @@ extern "C" {
   #include "RICactionType.h"
   #include "ProtocolIE-Field.h"
   #include "InitiatingMessage.h"
+  #include "E2SM-KPM-EventTriggerDefinition.h"
+  #include "E2SM-KPM-EventTriggerDefinition-Format1.h"
+  #include "RICcontrolRequest.h"
+  #include "SuccessfulOutcome.h"
 }
 
 namespace ns3 {
@@ -46,7 +55,60 @@ TypeId E2Termination::GetTypeId ()
 {
   static TypeId tid = TypeId ("ns3::E2Termination")
     .SetParent<Object>()
-    .AddConstructor<E2Termination>();
+    .AddConstructor<E2Termination>()
+    .AddAttribute ("MaxUesPerIndication",
+                   "Maximum number of UEs reported in a single RIC Indication, "
+                   "larger reports are split. 0 means no limit.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&E2Termination::m_maxUesPerIndication),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxIndicationSize",
+                   "Maximum size in bytes of the encoded indication message of a single "
+                   "RIC Indication, larger reports are split. 0 means no limit.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&E2Termination::m_maxIndicationSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("PersistentReportTrees",
+                   "Keep the UE measurement reports of each subscription from one reporting "
+                   "period to the next and only update their values, rebuilding the report "
+                   "of a UE when it attaches or its KPIs change.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&E2Termination::m_persistentReportTrees),
+                   MakeBooleanChecker ())
+    .AddAttribute ("BatchGranularityPeriods",
+                   "Sample the KPIs of a subscription every granularity period of its action "
+                   "definition and send the samples of a reporting period in a single "
+                   "indication, with one measurement data item per granularity period. Only "
+                   "applies when the reporting period is a multiple of the granularity period.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&E2Termination::m_batchGranularityPeriods),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SendQueueSize",
+                   "Capacity of the queue of E2 messages encoded and sent by a dedicated "
+                   "sender thread, see QueueE2Message. 0 sends messages on the calling thread.",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&E2Termination::m_sendQueueSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("InboundQueueSize",
+                   "Capacity of the queue handing the messages received by e2sim over to the "
+                   "simulator thread, which runs the callbacks. 0 runs the callbacks on the "
+                   "e2sim thread.",
+                   UintegerValue (256),
+                   MakeUintegerAccessor (&E2Termination::m_inboundQueueSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("InboundQueueTimeout",
+                   "Maximum time a receiving thread waits for the simulator thread to make "
+                   "room in a full inbound queue, after which the message is dropped.",
+                   TimeValue (Seconds (5)),
+                   MakeTimeAccessor (&E2Termination::m_inboundQueueTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("UseIoReactor",
+                   "Open the SCTP association with the RIC in the simulator, served by the "
+                   "E2IoReactor shared by every E2Termination of the process, instead of a "
+                   "dedicated e2sim thread. Ignored if a transport is set.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&E2Termination::m_useIoReactor),
+                   MakeBooleanChecker ());
   return tid;
 }
 
@@ -64,7 +126,31 @@ E2Termination::E2Termination(const std::string ricAddress,
     m_ricPort (ricPort),
     m_clientPort (clientPort),
     m_gnbId (gnbId),
-    m_plmnId(plmnId)
+    m_plmnId(plmnId),
+    m_maxUesPerIndication (0),
+    m_maxIndicationSize (0),
+    m_persistentReportTrees (true),
+    m_batchGranularityPeriods (false),
+    m_sendQueueSize (1024),
+    m_senderStop (false),
+    m_senderWaiting (false),
+    m_enqueuedPdus (0),
+    m_sentPdus (0),
+    m_droppedPdus (0),
+    m_queuedPdus (0),
+    m_maxQueuedPdus (0),
+    m_totalSendLatency (0),
+    m_maxSendLatency (0),
+    m_inboundQueueSize (256),
+    m_inboundScheduled (false),
+    m_inboundQueueTimeout (Seconds (5)),
+    m_inboundWaiters (0),
+    m_receivedMessages (0),
+    m_dispatchedMessages (0),
+    m_droppedMessages (0),
+    m_totalInboundLatency (0),
+    m_maxInboundLatency (0),
+    m_useIoReactor (false)
 {
   NS_LOG_FUNCTION (this);
   m_e2sim = new E2Sim;
@@ -85,6 +171,7 @@ E2Termination::RegisterFunctionDescToE2Sm (long ranFunctionId, Ptr<FunctionDescr
   memcpy (rfdBuf->buf, ranFunctionDescription->m_buffer, ranFunctionDescription->m_size);
 
   m_e2sim->register_e2sm (ranFunctionId, rfdBuf);
+  m_ranFunctions[ranFunctionId] = rfdBuf;
 }
 
 void
@@ -92,20 +179,23 @@ E2Termination::RegisterKpmCallbackToE2Sm (long ranFunctionId, Ptr<FunctionDescri
                              SubscriptionCallback sbCb)
 {
   RegisterFunctionDescToE2Sm (ranFunctionId,ranFunctionDescription);
-  m_e2sim->register_subscription_callback (ranFunctionId, sbCb);
+  m_e2sim->register_subscription_callback (ranFunctionId, DispatchOnSimulatorThread (sbCb));
+  m_subscriptionCallbacks[ranFunctionId] = &m_inboundCallbacks.back ();
 }
 
 void
 E2Termination::RegisterSmCallbackToE2Sm (long ranFunctionId, Ptr<FunctionDescription> ranFunctionDescription, SmCallback smCb)
 {
   RegisterFunctionDescToE2Sm (ranFunctionId,ranFunctionDescription);
-  m_e2sim->register_sm_callback (ranFunctionId, smCb);
+  m_e2sim->register_sm_callback (ranFunctionId, DispatchOnSimulatorThread (smCb));
+  m_smCallbacks[ranFunctionId] = &m_inboundCallbacks.back ();
 }
 
 void
 E2Termination::RegisterCallbackFunctionToE2Sm (long functionId,CallbackFunction CbFun)
 {
-  m_e2sim->register_callback (functionId, CbFun);
+  m_e2sim->register_callback (functionId, DispatchOnSimulatorThread (CbFun));
+  m_e2simCallbacks.insert (functionId);
 }
 
 void E2Termination::Start ()
@@ -113,6 +203,26 @@ void E2Termination::Start ()
   NS_LOG_FUNCTION (this);
 
   NS_ABORT_MSG_IF(m_ricAddress.empty(), "Set the RIC information first");
+
+  if (m_sendQueueSize > 0 && !m_sendQueue)
+    {
+      m_sendQueue.reset (new MpscQueue<QueuedPdu> (m_sendQueueSize));
+      m_senderThread = std::thread (&E2Termination::RunSender, this);
+    }
+  if (m_inboundQueueSize > 0 && !m_inboundQueue)
+    {
+      m_inboundQueue.reset (new MpscQueue<InboundMessage> (m_inboundQueueSize));
+    }
+
+  if (!m_transport && m_useIoReactor)
+    {
+      m_transport = Create<SctpE2Transport> (m_ricAddress, m_ricPort, m_clientPort);
+    }
+  if (m_transport)
+    {
+      StartOnTransport ();
+      return;
+    }
   
   // create a thread to host e2sim execution
   std::thread e2simThread (&E2Termination::DoStart, this);
@@ -146,6 +256,19 @@ void E2Termination::DoStart ()
 E2Termination::~E2Termination ()
 {
   NS_LOG_FUNCTION (this);
+  if (m_transport)
+    {
+      m_transport->Close ();
+    }
+  StopSender ();
+  if (m_inboundQueue)
+    {
+      InboundMessage message;
+      while (m_inboundQueue->TryPop (message))
+        {
+          EncodeBufferPool::Release (message.m_buffer, message.m_capacity);
+        }
+    }
   delete m_e2sim;
 }
 
@@ -176,6 +299,8 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
   uint16_t reqInstanceId {};
   uint16_t ranFuncionId {};
   uint8_t reqActionId {};
+  Ptr<KpmSubscriptionFilter> subscription;
+  uint32_t reportingPeriod {};
   
   std::vector<long> actionIdsAccept;
   std::vector<long> actionIdsReject;
@@ -214,16 +339,11 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
           
           // RIC Event Trigger Definition
           RICeventTriggerDefinition_t triggerDef = subDetails.ricEventTriggerDefinition;
-
-          // TODO How to decode this field?
-          uint8_t size = 20;  
-          uint8_t *buf = (uint8_t *)calloc(1,size);
-          memcpy(buf, &triggerDef, size);
-          NS_LOG_DEBUG ("RIC Event Trigger Definition " << std::to_string (*buf));
+          reportingPeriod = DecodeReportingPeriod (triggerDef.buf, triggerDef.size);
+          NS_LOG_DEBUG ("RIC Event Trigger reporting period " << reportingPeriod << " ms");
                     
           // Sequence of actions
           RICactions_ToBeSetup_List_t actionList = subDetails.ricAction_ToBeSetup_List;
-          // TODO We are ignoring the trigger definition
   
           int actionCount = actionList.list.count;
           NS_LOG_DEBUG ("Number of actions " << actionCount);
@@ -236,6 +356,7 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
             auto *next_item = item_array[i];
             RICactionID_t actionId = ((RICaction_ToBeSetup_ItemIEs*)next_item)->value.choice.RICaction_ToBeSetup_Item.ricActionID;
             RICactionType_t actionType = ((RICaction_ToBeSetup_ItemIEs*)next_item)->value.choice.RICaction_ToBeSetup_Item.ricActionType;
+            RICactionDefinition_t *actionDef = ((RICaction_ToBeSetup_ItemIEs*)next_item)->value.choice.RICaction_ToBeSetup_Item.ricActionDefinition;
                         
             //We identify the first action whose type is REPORT
             //That is the only one accepted; all others are rejected
@@ -244,6 +365,10 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
               reqActionId = actionId;
               actionIdsAccept.push_back(reqActionId);
               NS_LOG_DEBUG ("Action ID " << actionId << " accepted");
+              if (actionDef != nullptr)
+                {
+                  subscription = KpmSubscriptionFilter::Decode (actionDef->buf, actionDef->size);
+                }
               foundAction = true;
             } 
             else 
@@ -276,21 +401,679 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
   encoding::generate_e2apv1_subscription_response_success(e2ap_pdu, accept_array, reject_array, accept_size, reject_size, reqRequestorId, reqInstanceId);
 
   NS_LOG_DEBUG ("Send RIC Subscription Response");
-  m_e2sim->encode_and_send_sctp_data(e2ap_pdu);
+  SendToRic (e2ap_pdu);
 
   RicSubscriptionRequest_rval_s reqParams;
   reqParams.requestorId = reqRequestorId;
   reqParams.instanceId = reqInstanceId;
   reqParams.ranFuncionId = ranFuncionId;
   reqParams.actionId = reqActionId;
+  reqParams.subscription = subscription;
+  reqParams.reportingPeriod = reportingPeriod;
+
+  // the subscription table is only accessed by the simulator thread
+  if (reportingPeriod > 0 && !actionIdsAccept.empty ())
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                      &E2Termination::AddSubscription, this, reqParams);
+    }
   return reqParams;
 }
 
+uint32_t
+E2Termination::DecodeReportingPeriod (const uint8_t *buffer, size_t size)
+{
+  if (buffer == nullptr || size == 0)
+    {
+      return 0;
+    }
+
+  E2SM_KPM_EventTriggerDefinition_t *trigger = nullptr;
+  asn_dec_rval_t decoded = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER,
+                                       &asn_DEF_E2SM_KPM_EventTriggerDefinition,
+                                       (void **) &trigger, buffer, size);
+  uint32_t period = 0;
+  if (decoded.code == RC_OK &&
+      trigger->eventDefinition_formats.present ==
+          E2SM_KPM_EventTriggerDefinition__eventDefinition_formats_PR_eventDefinition_Format1)
+    {
+      period = trigger->eventDefinition_formats.choice.eventDefinition_Format1->reportingPeriod;
+    }
+  else
+    {
+      NS_LOG_WARN ("Cannot decode the KPM event trigger definition");
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_EventTriggerDefinition, trigger);
+  return period;
+}
+
+void
+E2Termination::RegisterKpmReportProvider (long ranFunctionId, KpmReportProvider provider)
+{
+  m_reportProviders[ranFunctionId] = provider;
+}
+
+void
+E2Termination::AddSubscription (RicSubscriptionRequest_rval_s params)
+{
+  NS_LOG_FUNCTION (this << params.requestorId << params.instanceId << params.ranFuncionId);
+  if (m_reportProviders.find (params.ranFuncionId) == m_reportProviders.end ())
+    {
+      NS_LOG_LOGIC ("No report provider for RAN function " << params.ranFuncionId
+                                                           << ", reports are left to the user");
+      return;
+    }
+
+  SubscriptionKey key (params.requestorId, params.instanceId, params.ranFuncionId);
+  auto it = m_subscriptions.find (key);
+  if (it != m_subscriptions.end ())
+    {
+      // a new request for the same subscription replaces it
+      DoRemoveSubscription (it->second);
+    }
+  m_subscriptions.emplace (key, params);
+
+  uint32_t period = GetSamplingPeriod (params);
+  ReportGroup &group = m_reportGroups[period];
+  group.m_subscriptions.push_back (key);
+  if (group.m_subscriptions.size () == 1)
+    {
+      // the first report is at the next multiple of the period, so that
+      // subscriptions with the same period are reported together
+      int64_t now = Simulator::Now ().GetMilliSeconds ();
+      int64_t next = (now / period + 1) * period;
+      group.m_event = Simulator::Schedule (MilliSeconds (next - now),
+                                           &E2Termination::SendPeriodicReports, this, period);
+    }
+  NS_LOG_LOGIC ("Subscription added to the " << period << " ms reports, "
+                                             << group.m_subscriptions.size ()
+                                             << " subscriptions share the period");
+}
+
+void
+E2Termination::RemoveSubscription (const RicSubscriptionRequest_rval_s &params)
+{
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                  &E2Termination::DoRemoveSubscription, this, params);
+}
+
+void
+E2Termination::DoRemoveSubscription (RicSubscriptionRequest_rval_s params)
+{
+  SubscriptionKey key (params.requestorId, params.instanceId, params.ranFuncionId);
+  auto it = m_subscriptions.find (key);
+  if (it == m_subscriptions.end ())
+    {
+      return;
+    }
+
+  auto groupIt = m_reportGroups.find (GetSamplingPeriod (it->second));
+  NS_ASSERT (groupIt != m_reportGroups.end ());
+  std::vector<SubscriptionKey> &keys = groupIt->second.m_subscriptions;
+  keys.erase (std::find (keys.begin (), keys.end (), key));
+  if (keys.empty ())
+    {
+      groupIt->second.m_event.Cancel ();
+      m_reportGroups.erase (groupIt);
+    }
+  m_subscriptions.erase (it);
+  m_reportTrees.erase (key);
+  m_pendingSamples.erase (key);
+}
+
+uint32_t
+E2Termination::GetSamplingPeriod (const RicSubscriptionRequest_rval_s &params) const
+{
+  uint32_t granularity = params.subscription ? params.subscription->GetGranularityPeriod () : 0;
+  if (m_batchGranularityPeriods && granularity > 0 && params.reportingPeriod > granularity &&
+      params.reportingPeriod % granularity == 0)
+    {
+      return granularity;
+    }
+  return params.reportingPeriod;
+}
+
+size_t
+E2Termination::GetSubscriptionCount () const
+{
+  return m_subscriptions.size ();
+}
+
+void
+E2Termination::SendPeriodicReports (uint32_t period)
+{
+  auto groupIt = m_reportGroups.find (period);
+  NS_ASSERT (groupIt != m_reportGroups.end ());
+  NS_LOG_FUNCTION (this << period << groupIt->second.m_subscriptions.size ());
+
+  // the next reports are scheduled first, providers may remove subscriptions
+  groupIt->second.m_event = Simulator::Schedule (MilliSeconds (period),
+                                                 &E2Termination::SendPeriodicReports, this, period);
+
+  std::vector<SubscriptionKey> keys = groupIt->second.m_subscriptions;
+  for (const SubscriptionKey &key : keys)
+    {
+      auto it = m_subscriptions.find (key);
+      if (it == m_subscriptions.end ())
+        {
+          continue;
+        }
+      RicSubscriptionRequest_rval_s params = it->second;
+
+      Ptr<KpmIndicationHeader> header;
+      KpmIndicationMessage::KpmIndicationMessageValues values;
+      if (!m_reportProviders[params.ranFuncionId](params, header, values))
+        {
+          continue;
+        }
+      NS_ABORT_MSG_IF (!header, "The report provider did not set the indication header");
+      if (!values.m_subscription)
+        {
+          values.m_subscription = params.subscription;
+        }
+
+      if (period != params.reportingPeriod)
+        {
+          // one sample per granularity period, sent once the reporting
+          // period is complete, the latest sample carrying the others
+          std::vector<KpmIndicationMessage::KpmIndicationMessageValues> &samples =
+              m_pendingSamples[key];
+          samples.push_back (values);
+          if (samples.size () < params.reportingPeriod / period)
+            {
+              continue;
+            }
+          values = KpmIndicationMessage::BatchGranularityPeriods (samples, period);
+          m_pendingSamples.erase (key);
+          SendKpmIndications (params, header, values);
+          continue;
+        }
+
+      Ptr<KpmReportTree> tree;
+      // the provider may have removed the subscription
+      if (m_persistentReportTrees && m_subscriptions.count (key) > 0)
+        {
+          Ptr<KpmReportTree> &keyTree = m_reportTrees[key];
+          if (!keyTree)
+            {
+              keyTree = Create<KpmReportTree> ();
+            }
+          tree = keyTree;
+        }
+      SendKpmIndications (params, header, values, tree);
+    }
+}
+
+void
+E2Termination::DoDispose ()
+{
+  // waits for a receive callback running on a reactor thread
+  if (m_transport)
+    {
+      m_transport->Close ();
+    }
+  StopSender ();
+  for (auto &group : m_reportGroups)
+    {
+      group.second.m_event.Cancel ();
+    }
+  m_reportGroups.clear ();
+  m_subscriptions.clear ();
+  m_reportTrees.clear ();
+  m_pendingSamples.clear ();
+  m_reportProviders.clear ();
+  Object::DoDispose ();
+}
+
 void
 E2Termination::SendE2Message (E2AP_PDU* pdu)
 {
-  m_e2sim->encode_and_send_sctp_data (pdu);
+  SendToRic (pdu);
   // sleep(1); 
 }
 
+/**
+* Frees a PDU allocated with new and filled by the e2sim encoding
+* functions
+*/
+static void
+FreeE2Message (E2AP_PDU *pdu)
+{
+  ASN_STRUCT_FREE_CONTENTS_ONLY (asn_DEF_E2AP_PDU, pdu);
+  delete pdu;
+}
+
+void
+E2Termination::FreeSentE2Message (E2AP_PDU *pdu)
+{
+  if (!m_transport)
+    {
+      // e2ap_asn1c_encode_pdu already freed the contents
+      delete pdu;
+      return;
+    }
+  FreeE2Message (pdu);
+}
+
+static void
+UpdateMax (std::atomic<uint64_t> &max, uint64_t value)
+{
+  uint64_t current = max.load (std::memory_order_relaxed);
+  while (value > current && !max.compare_exchange_weak (current, value))
+    {
+    }
+}
+
+void
+E2Termination::QueueE2Message (E2AP_PDU *pdu)
+{
+  if (!m_sendQueue)
+    {
+      SendE2Message (pdu);
+      FreeSentE2Message (pdu);
+      return;
+    }
+
+  QueuedPdu item = {pdu, std::chrono::steady_clock::now ()};
+  if (!m_sendQueue->TryPush (item))
+    {
+      m_droppedPdus++;
+      NS_LOG_WARN ("Send queue full, E2 message dropped");
+      FreeE2Message (pdu);
+      return;
+    }
+  m_enqueuedPdus++;
+  UpdateMax (m_maxQueuedPdus, ++m_queuedPdus);
+
+  // pairs with the fence of RunSender, so that either the sender sees the
+  // message before sleeping or this thread sees it sleeping
+  std::atomic_thread_fence (std::memory_order_seq_cst);
+  if (m_senderWaiting.load (std::memory_order_relaxed))
+    {
+      std::lock_guard<std::mutex> lock (m_senderMutex);
+      m_senderCv.notify_one ();
+    }
+}
+
+void
+E2Termination::RunSender ()
+{
+  NS_LOG_FUNCTION (this);
+  QueuedPdu item;
+  while (true)
+    {
+      if (m_sendQueue->TryPop (item))
+        {
+          m_queuedPdus--;
+          if (!SendToRic (item.m_pdu))
+            {
+              m_droppedPdus++;
+              FreeSentE2Message (item.m_pdu);
+              continue;
+            }
+          uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds> (
+                                 std::chrono::steady_clock::now () - item.m_enqueued)
+                                 .count ();
+          m_sentPdus++;
+          m_totalSendLatency += latency;
+          UpdateMax (m_maxSendLatency, latency);
+          FreeSentE2Message (item.m_pdu);
+          continue;
+        }
+      if (m_senderStop)
+        {
+          break;
+        }
+
+      std::unique_lock<std::mutex> lock (m_senderMutex);
+      m_senderWaiting.store (true, std::memory_order_relaxed);
+      std::atomic_thread_fence (std::memory_order_seq_cst);
+      m_senderCv.wait (lock, [this] { return !m_sendQueue->IsEmpty () || m_senderStop; });
+      m_senderWaiting.store (false, std::memory_order_relaxed);
+    }
+}
+
+E2Termination::E2MessageCallback
+E2Termination::DispatchOnSimulatorThread (E2MessageCallback callback)
+{
+  m_inboundCallbacks.push_back (callback);
+  const E2MessageCallback *stored = &m_inboundCallbacks.back ();
+  return [this, stored] (E2AP_PDU_t *pdu) { Deliver (stored, pdu, nullptr, 0); };
+}
+
+void
+E2Termination::Deliver (const E2MessageCallback *callback, E2AP_PDU_t *pdu,
+                        const uint8_t *buffer, size_t size)
+{
+  if (!m_inboundQueue)
+    {
+      (*callback) (pdu);
+      return;
+    }
+
+  InboundMessage message;
+  if (buffer != nullptr)
+    {
+      // received on a transport, the bytes are copied as they are
+      message.m_buffer = EncodeBufferPool::Get ()->Acquire (size, &message.m_capacity);
+      memcpy (message.m_buffer, buffer, size);
+      message.m_size = size;
+    }
+  else
+    {
+      asn_enc_rval_t encoded = EncodeBufferPool::Encode (&asn_DEF_E2AP_PDU, pdu,
+                                                         &message.m_buffer, &message.m_capacity);
+      if (encoded.encoded < 0)
+        {
+          NS_LOG_ERROR ("Cannot copy the received E2 message, running its callback on the "
+                        "receiving thread");
+          EncodeBufferPool::Release (message.m_buffer, message.m_capacity);
+          (*callback) (pdu);
+          return;
+        }
+      message.m_size = encoded.encoded;
+    }
+  message.m_callback = callback;
+  message.m_received = std::chrono::steady_clock::now ();
+
+  // E2 messages must not be lost, wait for the simulator thread to
+  // make room, but not forever if it is stuck or not running
+  if (!m_inboundQueue->TryPush (message))
+    {
+      NS_LOG_WARN ("Inbound queue full, waiting for the simulator thread");
+      std::unique_lock<std::mutex> lock (m_inboundMutex);
+      m_inboundWaiters++;
+      // pairs with the fence of DispatchInbound, so that either this
+      // thread sees the room or the simulator thread sees it waiting
+      std::atomic_thread_fence (std::memory_order_seq_cst);
+      bool pushed = m_inboundCv.wait_for (
+          lock, std::chrono::nanoseconds (m_inboundQueueTimeout.GetNanoSeconds ()),
+          [this, &message] { return m_inboundQueue->TryPush (message); });
+      m_inboundWaiters--;
+      if (!pushed)
+        {
+          NS_LOG_ERROR ("Inbound queue full for " << m_inboundQueueTimeout.GetSeconds ()
+                                                  << " s, E2 message dropped");
+          EncodeBufferPool::Release (message.m_buffer, message.m_capacity);
+          m_droppedMessages++;
+          return;
+        }
+    }
+  m_receivedMessages++;
+
+  if (!m_inboundScheduled.exchange (true))
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                      &E2Termination::DispatchInbound, this);
+    }
+}
+
+void
+E2Termination::SetTransport (Ptr<E2Transport> transport)
+{
+  m_transport = transport;
+}
+
+void
+E2Termination::StartOnTransport ()
+{
+  NS_LOG_FUNCTION (this);
+
+  // HandleE2Message has no way to route the messages of these callbacks
+  NS_ABORT_MSG_IF (!m_e2simCallbacks.empty (),
+                   "The callback of function " << *m_e2simCallbacks.begin ()
+                                               << " is only called by e2sim, not on a transport");
+  if (!m_transport->Connect (
+          [this] (const uint8_t *buffer, size_t size) { ReceiveFromRic (buffer, size); }))
+    {
+      NS_FATAL_ERROR ("Cannot connect to the RIC at " << m_ricAddress << ":" << m_ricPort);
+    }
+
+  NS_LOG_INFO ("In ns3::E2Term:  GNB" << m_gnbId << ", clientPort " << m_clientPort << ", ricPort "
+                                 << m_ricPort << ", PlmnID " << m_plmnId << ", on the reactor");
+
+  // same E2 Setup Request as the e2sim main loop
+  std::vector<ran_func_info> functions;
+  for (const auto &function : m_ranFunctions)
+    {
+      ran_func_info info;
+      info.ranFunctionId = function.first;
+      info.ranFunctionDesc = function.second;
+      info.ranFunctionRev = 2;
+      info.ranFunctionOId = (PrintableString_t *) calloc (1, sizeof (PrintableString_t));
+      OCTET_STRING_fromString (info.ranFunctionOId, "OID123");
+      functions.push_back (info);
+    }
+  E2AP_PDU *setup = new E2AP_PDU ();
+  encoding::generate_e2apv1_setup_request_parameterized (setup, functions,
+                                                          (uint8_t *) m_gnbId.c_str (),
+                                                          (uint8_t *) m_plmnId.c_str ());
+  NS_LOG_DEBUG ("Send E2 Setup Request");
+  SendToRic (setup);
+  // the request shares the registered descriptions, only the top level is freed
+  delete setup;
+}
+
+void
+E2Termination::ReceiveFromRic (const uint8_t *buffer, size_t size)
+{
+  E2AP_PDU_t *pdu = nullptr;
+  asn_dec_rval_t decoded =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, (void **) &pdu, buffer, size);
+  if (decoded.code != RC_OK)
+    {
+      NS_LOG_ERROR ("Cannot decode a message of the RIC");
+    }
+  else
+    {
+      HandleE2Message (pdu, buffer, size);
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+}
+
+void
+E2Termination::HandleE2Message (E2AP_PDU_t *pdu, const uint8_t *buffer, size_t size)
+{
+  // the callback maps are filled before Start and read only afterwards
+  switch (pdu->present)
+    {
+    case E2AP_PDU_PR_initiatingMessage:
+      {
+        InitiatingMessage_t *message = pdu->choice.initiatingMessage;
+        if (message->procedureCode == ProcedureCode_id_RICsubscription)
+          {
+            long ranFunctionId = encoding::get_function_id_from_subscription (pdu);
+            auto it = m_subscriptionCallbacks.find (ranFunctionId);
+            if (it == m_subscriptionCallbacks.end ())
+              {
+                NS_LOG_WARN ("No subscription callback for RAN function " << ranFunctionId);
+                return;
+              }
+            Deliver (it->second, pdu, buffer, size);
+          }
+        else if (message->procedureCode == ProcedureCode_id_RICcontrol)
+          {
+            RICcontrolRequest_t &request = message->value.choice.RICcontrolRequest;
+            long ranFunctionId = -1;
+            for (int i = 0; i < request.protocolIEs.list.count; ++i)
+              {
+                RICcontrolRequest_IEs_t *ie = request.protocolIEs.list.array[i];
+                if (ie->value.present == RICcontrolRequest_IEs__value_PR_RANfunctionID)
+                  {
+                    ranFunctionId = ie->value.choice.RANfunctionID;
+                  }
+              }
+            auto it = m_smCallbacks.find (ranFunctionId);
+            if (it == m_smCallbacks.end ())
+              {
+                NS_LOG_WARN ("No SM callback for RAN function " << ranFunctionId);
+                return;
+              }
+            Deliver (it->second, pdu, buffer, size);
+          }
+        else
+          {
+            NS_LOG_WARN ("Ignoring initiating message " << message->procedureCode);
+          }
+        break;
+      }
+    case E2AP_PDU_PR_successfulOutcome:
+      if (pdu->choice.successfulOutcome->procedureCode == ProcedureCode_id_E2setup)
+        {
+          NS_LOG_INFO ("E2 Setup Response received");
+        }
+      break;
+    default:
+      NS_LOG_WARN ("Ignoring E2 message of type " << pdu->present);
+      break;
+    }
+}
+
+bool
+E2Termination::SendToRic (E2AP_PDU *pdu)
+{
+  if (!m_transport)
+    {
+      m_e2sim->encode_and_send_sctp_data (pdu);
+      return true;
+    }
+
+  void *buffer = nullptr;
+  size_t capacity = 0;
+  asn_enc_rval_t encoded = EncodeBufferPool::Encode (&asn_DEF_E2AP_PDU, pdu, &buffer, &capacity);
+  if (encoded.encoded < 0)
+    {
+      NS_LOG_ERROR ("Cannot encode the E2 message");
+      EncodeBufferPool::Release (buffer, capacity);
+      return false;
+    }
+  bool sent = m_transport->Send ((const uint8_t *) buffer, encoded.encoded);
+  EncodeBufferPool::Release (buffer, capacity);
+  return sent;
+}
+
+void
+E2Termination::DispatchInbound ()
+{
+  NS_LOG_FUNCTION (this);
+  // cleared before draining, so that a message pushed after the last pop
+  // schedules a new dispatch
+  m_inboundScheduled = false;
+
+  InboundMessage message;
+  while (m_inboundQueue->TryPop (message))
+    {
+      uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds> (
+                             std::chrono::steady_clock::now () - message.m_received)
+                             .count ();
+      std::atomic_thread_fence (std::memory_order_seq_cst);
+      if (m_inboundWaiters.load (std::memory_order_relaxed) > 0)
+        {
+          std::lock_guard<std::mutex> lock (m_inboundMutex);
+          m_inboundCv.notify_all ();
+        }
+
+      E2AP_PDU_t *pdu = nullptr;
+      asn_dec_rval_t decoded = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU,
+                                           (void **) &pdu, message.m_buffer, message.m_size);
+      EncodeBufferPool::Release (message.m_buffer, message.m_capacity);
+      if (decoded.code != RC_OK)
+        {
+          NS_LOG_ERROR ("Cannot decode the copy of a received E2 message");
+          ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+          continue;
+        }
+      m_totalInboundLatency += latency;
+      UpdateMax (m_maxInboundLatency, latency);
+      NS_LOG_LOGIC ("E2 message dispatched after " << latency << " us");
+      (*message.m_callback) (pdu);
+      ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+      m_dispatchedMessages++;
+    }
+}
+
+E2Termination::InboundQueueStats
+E2Termination::GetInboundQueueStats () const
+{
+  InboundQueueStats stats;
+  stats.m_received = m_receivedMessages;
+  stats.m_dispatched = m_dispatchedMessages;
+  stats.m_dropped = m_droppedMessages;
+  stats.m_meanLatency =
+      stats.m_dispatched > 0 ? (double) m_totalInboundLatency / stats.m_dispatched : 0;
+  stats.m_maxLatency = m_maxInboundLatency;
+  return stats;
+}
+
+void
+E2Termination::StopSender ()
+{
+  if (!m_senderThread.joinable ())
+    {
+      return;
+    }
+  {
+    std::lock_guard<std::mutex> lock (m_senderMutex);
+    m_senderStop = true;
+    m_senderCv.notify_one ();
+  }
+  m_senderThread.join ();
+
+  QueuedPdu item;
+  while (m_sendQueue->TryPop (item))
+    {
+      m_queuedPdus--;
+      m_droppedPdus++;
+      FreeE2Message (item.m_pdu);
+    }
+  m_sendQueue.reset ();
+}
+
+E2Termination::SendQueueStats
+E2Termination::GetSendQueueStats () const
+{
+  SendQueueStats stats;
+  stats.m_enqueued = m_enqueuedPdus;
+  stats.m_sent = m_sentPdus;
+  stats.m_dropped = m_droppedPdus;
+  stats.m_depth = m_queuedPdus;
+  stats.m_maxDepth = m_maxQueuedPdus;
+  stats.m_meanLatency = stats.m_sent > 0 ? (double) m_totalSendLatency / stats.m_sent : 0;
+  stats.m_maxLatency = m_maxSendLatency;
+  return stats;
+}
+
+long
+E2Termination::GetNextSequenceNumber (const RicSubscriptionRequest_rval_s &params)
+{
+  std::lock_guard<std::mutex> lock (m_sequenceNumbersMutex);
+  return ++m_sequenceNumbers[SubscriptionKey (params.requestorId, params.instanceId,
+                                              params.ranFuncionId)];
+}
+
+uint32_t
+E2Termination::SendKpmIndications (const RicSubscriptionRequest_rval_s &params,
+                                   Ptr<KpmIndicationHeader> header,
+                                   const KpmIndicationMessage::KpmIndicationMessageValues &values,
+                                   Ptr<KpmReportTree> tree)
+{
+  NS_LOG_FUNCTION (this);
+
+  auto send = [this, &params, header] (Ptr<KpmIndicationMessage> msg) {
+    long sequenceNumber = GetNextSequenceNumber (params);
+    NS_LOG_DEBUG ("Send RIC Indication SN " << sequenceNumber << " of " << msg->m_size
+                                            << " bytes");
+
+    E2AP_PDU *pdu = new E2AP_PDU ();
+    encoding::generate_e2apv1_indication_request_parameterized (
+        pdu, params.requestorId, params.instanceId, params.ranFuncionId, params.actionId,
+        sequenceNumber, (uint8_t *) header->m_buffer, header->m_size, (uint8_t *) msg->m_buffer,
+        msg->m_size);
+    QueueE2Message (pdu);
+  };
+
+  return KpmIndicationMessage::BuildIndications (values, m_maxUesPerIndication,
+                                                 m_maxIndicationSize, send, tree);
+}
+
 }
@@ -26,13 +26,30 @@
 #define ORAN_INTERFACE_H
 
 #include "ns3/object.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
 #include <ns3/kpm-indication.h>
 #include <ns3/kpm-function-description.h>
 #include <ns3/ric-control-function-description.h>
 // #include <ns3/ric-delete-function-description.h>
 #include <ns3/ric-control-message.h>
+#include <ns3/mpsc-queue.h>
+#include <ns3/e2-transport.h>
 #include "e2sim.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 namespace ns3 {
   
   class E2Termination : public Object 
@@ -67,8 +84,22 @@ namespace ns3 {
       * Start the E2 termination.
       * Create a separate thread to host the execution of e2sim. The thread will 
       * execute the method DoStart.  
+      * With a transport set by SetTransport, or an SCTP transport if the
+      * UseIoReactor attribute is set, the association with the RIC is
+      * instead opened on the calling thread and served by the E2IoReactor
+      * shared by every E2Termination of the process, see StartOnTransport.
+      * Callbacks must be registered before.
       */
       void Start ();
+
+      /**
+      * Replaces e2sim with another transport, for instance a Unix-domain
+      * socket or one end of an InProcessE2Transport pair. Must be called
+      * before Start.
+      *
+      * \param transport the transport towards the RIC
+      */
+      void SetTransport (Ptr<E2Transport> transport);
       
       /**
       * Register an E2 Service Model.
@@ -76,7 +107,8 @@ namespace ns3 {
       * for the SM, add it to the list of supported RAN functions, and 
       * register a callback.
       * Whenever a RIC Subscription Request to this RAN Function is received, 
-      * the callback is triggered.  
+      * the callback is triggered on the simulator thread, see
+      * DispatchOnSimulatorThread.
       *
       * \param ranFunctionId ID used to identify the KPM RAN Function
       * \param ranFunctionDescription 
@@ -93,7 +125,8 @@ namespace ns3 {
       * for the SM, add it to the list of supported RAN functions, and 
       * register a callback.
       * Whenever a Sm message to this RAN Function is received, 
-      * the callback is triggered.  
+      * the callback is triggered on the simulator thread, see
+      * DispatchOnSimulatorThread.
       *
       * \param ranFunctionId ID used to identify the KPM RAN Function
       * \param ranFunctionDescription 
@@ -106,12 +139,31 @@ namespace ns3 {
 
       /**
       * Reguster a callback function that handle events.
+      * Only e2sim dispatches these callbacks, so Start aborts if any is
+      * registered along with a transport.
       *
       * \param functionId ID used to identify function wants to call.
       * \param CbFun callback function that will be triggered if its called.
       */
       void RegisterCallbackFunctionToE2Sm (long functionId,CallbackFunction CbFun);
 
+      /**
+      * Counters of the inbound queue, see DispatchOnSimulatorThread
+      */
+      struct InboundQueueStats
+      {
+        uint64_t m_received; //!< messages handed over by the e2sim thread
+        uint64_t m_dispatched; //!< messages dispatched on the simulator thread
+        uint64_t m_dropped; //!< messages dropped after waiting InboundQueueTimeout for room
+        double m_meanLatency; //!< mean time from reception to dispatch, in us
+        uint64_t m_maxLatency; //!< largest time from reception to dispatch, in us
+      };
+
+      /**
+      * \return the counters of the inbound queue
+      */
+      InboundQueueStats GetInboundQueueStats () const;
+
       /**
       * Struct holding the values returned by ProcessRicSubscriptionRequest
       */
@@ -121,12 +173,28 @@ namespace ns3 {
         uint16_t instanceId; //!< RIC Instance ID
         uint16_t ranFuncionId; //!< RAN Function ID
         uint8_t actionId; //!< RIC Action ID
+        Ptr<KpmSubscriptionFilter> subscription; //!< KPIs requested by the action definition, null for every KPI
+        uint32_t reportingPeriod; //!< reporting period of the event trigger in ms, 0 if none
       }; 
 
+      /**
+      * Fills the header and the values of a periodic report of a
+      * subscription, see RegisterKpmReportProvider. Returning false skips
+      * the report.
+      */
+      typedef std::function<bool (const RicSubscriptionRequest_rval_s &params,
+                                  Ptr<KpmIndicationHeader> &header,
+                                  KpmIndicationMessage::KpmIndicationMessageValues &values)>
+          KpmReportProvider;
+
       /**
       * Process RIC Subscription Request.
       * This function processes the RIC Subscription Request and sends the 
-      * RIC Subscription Response.
+      * RIC Subscription Response. The action definition of the accepted
+      * action is decoded into the KPI filter of the subscription, and the
+      * event trigger into its reporting period. If a report provider is
+      * registered for the RAN function, the subscription is added to the
+      * periodic reports.
       *
       * \param sub_req_pdu request message
       * \return RIC subscription request parameters
@@ -141,6 +209,106 @@ namespace ns3 {
       */
       void SendE2Message (E2AP_PDU* pdu);   
 
+      /**
+      * Hands an E2 message over to the sender thread, which encodes it,
+      * sends it to the RIC and frees it. The queue is created by Start
+      * when the SendQueueSize attribute is not 0; otherwise, the message
+      * is sent and freed right away. If the queue is full, the message is
+      * dropped.
+      *
+      * \param pdu the PDU of the message, allocated with new and filled by
+      *        the e2sim encoding functions. Ownership is transferred.
+      */
+      void QueueE2Message (E2AP_PDU* pdu);
+
+      /**
+      * Counters of the send queue, see QueueE2Message
+      */
+      struct SendQueueStats
+      {
+        uint64_t m_enqueued; //!< messages accepted by the queue
+        uint64_t m_sent; //!< messages sent by the sender thread
+        uint64_t m_dropped; //!< messages dropped because the queue was full, or not sent
+        uint64_t m_depth; //!< messages currently queued
+        uint64_t m_maxDepth; //!< largest number of queued messages
+        double m_meanLatency; //!< mean time from enqueue to the end of the send, in us
+        uint64_t m_maxLatency; //!< largest time from enqueue to the end of the send, in us
+      };
+
+      /**
+      * \return the counters of the send queue
+      */
+      SendQueueStats GetSendQueueStats () const;
+
+      /**
+      * Encodes the KPIs of a report and sends them to the RIC as one or
+      * more RIC Indication messages, split according to the
+      * MaxUesPerIndication and MaxIndicationSize attributes. Every message
+      * carries the same header and the next RIC Indication SN of the
+      * subscription. Each message is sent as soon as it is encoded.
+      *
+      * \param params the parameters of the subscription
+      * \param header the encoded indication header
+      * \param values the values of the indication message
+      * \param tree if set, the UE reports kept from the previous indications
+      *        of the subscription, see KpmReportTree
+      * \return the number of RIC Indication messages sent
+      */
+      uint32_t SendKpmIndications (const RicSubscriptionRequest_rval_s &params,
+                                   Ptr<KpmIndicationHeader> header,
+                                   const KpmIndicationMessage::KpmIndicationMessageValues &values,
+                                   Ptr<KpmReportTree> tree = nullptr);
+
+      /**
+      * \param params the parameters of the subscription
+      * \return the RIC Indication SN to use for the next indication of the
+      *         subscription, starting from 1
+      */
+      long GetNextSequenceNumber (const RicSubscriptionRequest_rval_s &params);
+
+      /**
+      * Registers the provider of the periodic reports of the subscriptions
+      * to a RAN function. Every reporting period, the provider fills the
+      * values of each subscription, which are then sent with
+      * SendKpmIndications. Subscriptions sharing a period are reported in
+      * the same simulator event, at multiples of the period, so that
+      * their reports are aligned and can be batched. With
+      * BatchGranularityPeriods, the provider is called every granularity
+      * period of the action definition instead, and the samples of a
+      * reporting period are sent in a single indication.
+      *
+      * \param ranFunctionId the RAN Function ID
+      * \param provider the report provider
+      */
+      void RegisterKpmReportProvider (long ranFunctionId, KpmReportProvider provider);
+
+      /**
+      * Stops the periodic reports of a subscription. It may be called from
+      * any thread, the subscription table is updated on the simulator
+      * thread.
+      *
+      * \param params the parameters of the subscription
+      */
+      void RemoveSubscription (const RicSubscriptionRequest_rval_s &params);
+
+      /**
+      * \return the number of subscriptions with periodic reports
+      */
+      size_t GetSubscriptionCount () const;
+
+      /**
+      * Decodes the reporting period of an APER encoded E2SM-KPM event
+      * trigger definition
+      *
+      * \param buffer the encoded event trigger definition
+      * \param size the size of the buffer
+      * \return the reporting period in ms, 0 if it cannot be decoded
+      */
+      static uint32_t DecodeReportingPeriod (const uint8_t *buffer, size_t size);
+
+    protected:
+      virtual void DoDispose () override;
+
     private:
       /**
       * Run the e2sim main loop.
@@ -158,12 +326,223 @@ namespace ns3 {
       void RegisterFunctionDescToE2Sm (long ranFunctionId,
                                 Ptr<FunctionDescription> ranFunctionDescription);
 
+      typedef std::function<void (E2AP_PDU_t *)> E2MessageCallback; //!< e2sim callback signature
+
+      /**
+      * Wraps a callback registered to e2sim, so that it is run by the
+      * simulator thread instead of the e2sim thread receiving the message.
+      * The wrapper copies the PDU, which e2sim owns, by encoding it into
+      * the inbound queue, and wakes the simulator thread up with
+      * ScheduleWithContext only if no dispatch is pending. The simulator
+      * thread decodes the copy, runs the callback and frees the copy.
+      * If the queue is full, the receiving thread waits for the simulator
+      * thread to make room, and drops the message after
+      * InboundQueueTimeout.
+      * With an InboundQueueSize of 0, or before Start, callbacks run on
+      * the e2sim thread as before.
+      *
+      * \param callback the user callback, kept in m_inboundCallbacks
+      * \return the callback to register to e2sim
+      */
+      E2MessageCallback DispatchOnSimulatorThread (E2MessageCallback callback);
+
+      /**
+      * Runs a callback on a received message, on the simulator thread if
+      * the inbound queue exists, see DispatchOnSimulatorThread
+      *
+      * \param callback an element of m_inboundCallbacks
+      * \param pdu the decoded message
+      * \param buffer the APER encoding of the message, or nullptr to encode
+      *        pdu again
+      * \param size the size of buffer
+      */
+      void Deliver (const E2MessageCallback *callback, E2AP_PDU_t *pdu, const uint8_t *buffer,
+                    size_t size);
+
+      /**
+      * Connects the transport and sends the E2 Setup Request with the
+      * registered RAN functions
+      */
+      void StartOnTransport ();
+
+      /**
+      * Receive callback of the transport, decodes and dispatches a message
+      * of the RIC
+      *
+      * \param buffer the APER encoded message
+      * \param size the size of buffer
+      */
+      void ReceiveFromRic (const uint8_t *buffer, size_t size);
+
+      /**
+      * Dispatches a message received on the transport to the callbacks of
+      * its RAN function
+      *
+      * \param pdu the decoded message
+      * \param buffer the APER encoding of the message
+      * \param size the size of buffer
+      */
+      void HandleE2Message (E2AP_PDU_t *pdu, const uint8_t *buffer, size_t size);
+
+      /**
+      * Encodes and sends a message on the transport, or with e2sim if
+      * there is none
+      *
+      * \param pdu the message, still owned by the caller. e2sim frees the
+      *        contents of the messages it encodes, so that without a
+      *        transport only the top level of pdu is left to the caller.
+      * \return false if the message could not be encoded or sent
+      */
+      bool SendToRic (E2AP_PDU *pdu);
+
+      /**
+      * Frees a message of QueueE2Message once SendToRic returned, taking
+      * into account the contents freed by e2sim
+      *
+      * \param pdu the message, allocated with new
+      */
+      void FreeSentE2Message (E2AP_PDU *pdu);
+
+      /**
+      * Runs the callbacks of the messages in the inbound queue, on the
+      * simulator thread
+      */
+      void DispatchInbound ();
+
+      /**
+      * Adds a subscription to the periodic reports, on the simulator thread
+      *
+      * \param params the parameters of the subscription
+      */
+      void AddSubscription (RicSubscriptionRequest_rval_s params);
+
+      /**
+      * Removes a subscription from the periodic reports, on the simulator
+      * thread
+      *
+      * \param params the parameters of the subscription
+      */
+      void DoRemoveSubscription (RicSubscriptionRequest_rval_s params);
+
+      /**
+      * Sends the reports of every subscription with the given period and
+      * schedules the next ones
+      *
+      * \param period the reporting period in ms
+      */
+      void SendPeriodicReports (uint32_t period);
+
+      /**
+      * \param params the parameters of a subscription
+      * \return the period at which the provider of the subscription is
+      *         called: its granularity period if the granularity periods
+      *         are batched and the reporting period is a multiple of it,
+      *         its reporting period otherwise
+      */
+      uint32_t GetSamplingPeriod (const RicSubscriptionRequest_rval_s &params) const;
+
+      /**
+      * Loop of the sender thread, draining the send queue
+      */
+      void RunSender ();
+
+      /**
+      * Stops the sender thread and frees the messages left in the queue
+      */
+      void StopSender ();
+
       E2Sim* m_e2sim; //!< pointer to an instance of the O-RAN E2 simulator
       std::string m_ricAddress; //!< IP address of the RIC
       uint16_t m_ricPort; //!< port of the RIC
       uint16_t m_clientPort; //!< local bind port
       std::string m_gnbId; //!< GNB id
       std::string m_plmnId; //!< PLMN Id
+      uint32_t m_maxUesPerIndication; //!< maximum number of UEs per RIC Indication, 0 for no limit
+      uint32_t m_maxIndicationSize; //!< maximum encoded indication message size, 0 for no limit
+      bool m_persistentReportTrees; //!< keep the UE reports of each subscription between periods
+      bool m_batchGranularityPeriods; //!< send the granularity periods of a reporting period together
+
+      typedef std::tuple<uint16_t, uint16_t, uint16_t> SubscriptionKey; //!< requestor, instance and RAN function IDs
+      std::map<SubscriptionKey, long> m_sequenceNumbers; //!< last RIC Indication SN of each subscription
+      /**
+      * Guards m_sequenceNumbers: the inbound callbacks run on the simulator
+      * thread, but on the e2sim or reactor thread when InboundQueueSize is 0
+      */
+      std::mutex m_sequenceNumbersMutex;
+
+      /**
+      * Subscriptions reported in the same simulator event
+      */
+      struct ReportGroup
+      {
+        std::vector<SubscriptionKey> m_subscriptions; //!< in subscription order
+        EventId m_event; //!< next report
+      };
+
+      std::map<long, KpmReportProvider> m_reportProviders; //!< report provider of each RAN function
+      std::map<SubscriptionKey, RicSubscriptionRequest_rval_s> m_subscriptions; //!< subscriptions with periodic reports
+      std::map<uint32_t, ReportGroup> m_reportGroups; //!< subscriptions of each reporting period
+      std::map<SubscriptionKey, Ptr<KpmReportTree>> m_reportTrees; //!< UE reports of each subscription
+      std::map<SubscriptionKey, std::vector<KpmIndicationMessage::KpmIndicationMessageValues>>
+          m_pendingSamples; //!< granularity periods of each batched subscription not sent yet
+
+      /**
+      * Message waiting in the send queue
+      */
+      struct QueuedPdu
+      {
+        E2AP_PDU *m_pdu;
+        std::chrono::steady_clock::time_point m_enqueued; //!< time of QueueE2Message
+      };
+
+      uint32_t m_sendQueueSize; //!< capacity of the send queue, 0 to send on the calling thread
+      std::unique_ptr<MpscQueue<QueuedPdu>> m_sendQueue; //!< messages for the sender thread
+      std::thread m_senderThread;
+      std::atomic<bool> m_senderStop; //!< set to stop the sender thread
+      std::atomic<bool> m_senderWaiting; //!< true while the sender thread sleeps on m_senderCv
+      std::mutex m_senderMutex;
+      std::condition_variable m_senderCv; //!< wakes up the sender thread
+      std::atomic<uint64_t> m_enqueuedPdus;
+      std::atomic<uint64_t> m_sentPdus;
+      std::atomic<uint64_t> m_droppedPdus;
+      std::atomic<uint64_t> m_queuedPdus; //!< current depth of the send queue
+      std::atomic<uint64_t> m_maxQueuedPdus;
+      std::atomic<uint64_t> m_totalSendLatency; //!< sum of the send latencies, in us
+      std::atomic<uint64_t> m_maxSendLatency; //!< in us
+
+      /**
+      * Message received by the e2sim thread, waiting for the simulator
+      * thread
+      */
+      struct InboundMessage
+      {
+        void *m_buffer; //!< APER encoding of the PDU, see EncodeBufferPool
+        size_t m_size;
+        size_t m_capacity;
+        const E2MessageCallback *m_callback; //!< element of m_inboundCallbacks
+        std::chrono::steady_clock::time_point m_received;
+      };
+
+      uint32_t m_inboundQueueSize; //!< capacity of the inbound queue, 0 to run callbacks on the e2sim thread
+      std::unique_ptr<MpscQueue<InboundMessage>> m_inboundQueue; //!< messages for the simulator thread
+      std::list<E2MessageCallback> m_inboundCallbacks; //!< user callbacks, stable addresses
+      std::atomic<bool> m_inboundScheduled; //!< true while a DispatchInbound event is pending
+      Time m_inboundQueueTimeout; //!< longest wait for room in the inbound queue
+      std::mutex m_inboundMutex; //!< guards the waits for room in the inbound queue
+      std::condition_variable m_inboundCv; //!< notified when room is made for waiting threads
+      std::atomic<uint32_t> m_inboundWaiters; //!< threads waiting for room in the inbound queue
+      std::atomic<uint64_t> m_receivedMessages;
+      std::atomic<uint64_t> m_dispatchedMessages;
+      std::atomic<uint64_t> m_droppedMessages;
+      std::atomic<uint64_t> m_totalInboundLatency; //!< in us
+      std::atomic<uint64_t> m_maxInboundLatency; //!< in us
+
+      bool m_useIoReactor; //!< use an SctpE2Transport if no transport is set
+      Ptr<E2Transport> m_transport; //!< replaces e2sim if set, only changed before Start
+      std::map<long, OCTET_STRING_t *> m_ranFunctions; //!< registered RAN function descriptions
+      std::map<long, const E2MessageCallback *> m_subscriptionCallbacks; //!< subscription callback of each RAN function
+      std::map<long, const E2MessageCallback *> m_smCallbacks; //!< SM callback of each RAN function
+      std::set<long> m_e2simCallbacks; //!< function IDs of RegisterCallbackFunctionToE2Sm
   };
 }
 
@@ -28,6 +28,7 @@
 
 #include <ns3/ric-control-function-description.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/encode-buffer-pool.h>
 #include <ns3/log.h>
 
 extern "C" {  
@@ -56,20 +57,18 @@ RicControlFunctionDescription::~RicControlFunctionDescription ()
 void
 RicControlFunctionDescription::Encode (E2SM_RC_RANFunctionDefinition_t *descriptor)
 {
-  asn_codec_ctx_t *opt_cod = 0; // disable stack bounds checking
-  // encode the structure into the e2smbuffer
-  asn_encode_to_new_buffer_result_s encodedMsg = asn_encode_to_new_buffer (
-      opt_cod, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_RANFunctionDefinition, descriptor);
+  // encode the structure into a pooled buffer
+  asn_enc_rval_t encodedMsg = EncodeBufferPool::Encode (
+      &asn_DEF_E2SM_RC_RANFunctionDefinition, descriptor, &m_buffer, &m_capacity);
 
-  if (encodedMsg.result.encoded < 0)
+  if (encodedMsg.encoded < 0)
     {
       NS_FATAL_ERROR ("Error during the encoding of the RIC Indication Header, errno: "
-                      << strerror (errno) << ", failed_type " << encodedMsg.result.failed_type->name
-                      << ", structure_ptr " << encodedMsg.result.structure_ptr);
+                      << strerror (errno) << ", failed_type " << encodedMsg.failed_type->name
+                      << ", structure_ptr " << encodedMsg.structure_ptr);
     }
 
-  m_buffer = encodedMsg.buffer;
-  m_size = encodedMsg.result.encoded;
+  m_size = encodedMsg.encoded;
 }
 
 void
@@ -24,6 +24,7 @@
  
 #include <ns3/ric-control-message.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/asn1c-alloc.h>
 #include <ns3/log.h>
 #include <bitset>
 namespace ns3 {
@@ -101,7 +102,7 @@ RicControlMessage::DecodeRicControlMessage(E2AP_PDU_t* pdu)
                 NS_LOG_DEBUG("[E2SM] RICcontrolRequest_IEs__value_PR_RICcontrolHeader");
                 // xer_fprint(stderr, &asn_DEF_RICcontrolHeader, &ie->value.choice.RICcontrolHeader);
 
-                auto *e2smControlHeader = (E2SM_RC_ControlHeader_t *) calloc(1,
+                auto *e2smControlHeader = (E2SM_RC_ControlHeader_t *) ASN1C_CALLOC ("RicControlMessage", 1,
                                                                              sizeof(E2SM_RC_ControlHeader_t));
                 ASN_STRUCT_RESET(asn_DEF_E2SM_RC_ControlHeader, e2smControlHeader);
                 asn_dec_rval_t rval = asn_decode(nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlHeader,
@@ -133,7 +134,7 @@ RicControlMessage::DecodeRicControlMessage(E2AP_PDU_t* pdu)
                 NS_LOG_DEBUG("[E2SM] RICcontrolRequest_IEs__value_PR_RICcontrolMessage");
                 // xer_fprint(stderr, &asn_DEF_RICcontrolMessage, &ie->value.choice.RICcontrolMessage);
 
-                auto *e2SmControlMessage = (E2SM_RC_ControlMessage_t *) calloc(1,
+                auto *e2SmControlMessage = (E2SM_RC_ControlMessage_t *) ASN1C_CALLOC ("RicControlMessage", 1,
                                                                                sizeof(E2SM_RC_ControlMessage_t));
                 ASN_STRUCT_RESET(asn_DEF_E2SM_RC_ControlMessage, e2SmControlMessage);
                 // Decode message then assign to e2SmControlMessage with sutable format.
@@ -167,7 +168,7 @@ RicControlMessage::DecodeRicControlMessage(E2AP_PDU_t* pdu)
 
                     if(DISABLE_FOR_OCTANT_STRING) {
                         NS_LOG_DEBUG ("[E2SM] E2SM_RC_ControlMessage_PR_controlMessage_Format1");
-                        E2SM_RC_ControlMessage_Format1_t *e2SmRcControlMessageFormat1 = (E2SM_RC_ControlMessage_Format1_t*) calloc(0, sizeof(E2SM_RC_ControlMessage_Format1_t));
+                        E2SM_RC_ControlMessage_Format1_t *e2SmRcControlMessageFormat1 = (E2SM_RC_ControlMessage_Format1_t*) ASN1C_CALLOC ("RicControlMessage", 0, sizeof(E2SM_RC_ControlMessage_Format1_t));
 
                         e2SmRcControlMessageFormat1 = e2SmControlMessage->ric_controlMessage_formats.choice.controlMessage_Format1;
                         NS_LOG_INFO (xer_fprint(stderr, &asn_DEF_E2SM_RC_ControlMessage_Format1, e2SmRcControlMessageFormat1));
@@ -24,6 +24,43 @@
 
 // Include a header file from your module to test.
 #include "ns3/oran-interface.h"
+#include "ns3/asn1c-arena.h"
+#include "ns3/asn1c-alloc.h"
+#include "ns3/encode-buffer-pool.h"
+#include "ns3/kpi-table.h"
+#include "ns3/kpi-schema.h"
+#include "ns3/kpm-subscription-filter.h"
+#include "ns3/measurement-name-registry.h"
+#include "ns3/mpsc-queue.h"
+#include "ns3/e2-io-reactor.h"
+#include "ns3/e2-transport.h"
+#include "ns3/mock-ric.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern "C" {
+#include "E2SM-KPM-ActionDefinition.h"
+#include "E2SM-KPM-ActionDefinition-Format1.h"
+#include "MeasurementInfoItem.h"
+#include "LabelInfoItem.h"
+#include "E2SM-KPM-EventTriggerDefinition.h"
+#include "E2SM-KPM-EventTriggerDefinition-Format1.h"
+#include "E2SM-KPM-IndicationMessage.h"
+#include "E2SM-KPM-IndicationMessage-Format1.h"
+#include "E2SM-KPM-IndicationMessage-Format3.h"
+#include "UEMeasurementReportItem.h"
+#include "RIC-ReportStyle-Item.h"
+}
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -68,6 +105,2024 @@ OranInterfaceTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+/**
+* Checks that the ASN.1 arena hands out zeroed, aligned memory and that
+* lists reserved in it accept ASN_SEQUENCE_ADD without reallocating
+*/
+class Asn1ArenaTestCase : public TestCase
+{
+public:
+  Asn1ArenaTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+Asn1ArenaTestCase::Asn1ArenaTestCase ()
+  : TestCase ("ASN.1 arena allocation and reset")
+{
+}
+
+void
+Asn1ArenaTestCase::DoRun (void)
+{
+  Asn1Arena arena (256);
+
+  uint8_t *bytes = arena.NewArray<uint8_t> (3);
+  double *value = arena.New<double> ();
+  NS_TEST_ASSERT_MSG_EQ ((uintptr_t) value % alignof (double), 0, "Misaligned allocation");
+  NS_TEST_ASSERT_MSG_EQ (bytes[0] + bytes[1] + bytes[2], 0, "Allocation is not zeroed");
+  NS_TEST_ASSERT_MSG_EQ (*value, 0.0, "Allocation is not zeroed");
+
+  // larger than a chunk, served by a dedicated one
+  uint8_t *big = arena.NewArray<uint8_t> (1024);
+  NS_TEST_ASSERT_MSG_EQ (big[1023], 0, "Large allocation is not zeroed");
+  NS_TEST_ASSERT_MSG_EQ (arena.GetChunkCount (), 2, "Large allocation did not add a chunk");
+
+  MeasurementRecord_t *record = arena.New<MeasurementRecord_t> ();
+  MeasurementRecordItem_t *items = arena.NewArray<MeasurementRecordItem_t> (4);
+  arena.ReserveList (&record->list, 4);
+  MeasurementRecordItem_t **array = record->list.array;
+  for (int i = 0; i < 4; ++i)
+    {
+      ASN_SEQUENCE_ADD (&record->list, &items[i]);
+    }
+  NS_TEST_ASSERT_MSG_EQ (record->list.count, 4, "Wrong number of list items");
+  NS_TEST_ASSERT_MSG_EQ (record->list.array, array, "Reserved list was reallocated");
+
+  arena.Reset ();
+  NS_TEST_ASSERT_MSG_EQ (arena.GetUsedBytes (), 0, "Reset did not release the allocations");
+  NS_TEST_ASSERT_MSG_EQ (arena.GetChunkCount (), 1, "Reset did not keep a single chunk");
+
+  // the merged chunk serves the same allocations again
+  arena.NewArray<uint8_t> (3);
+  arena.New<double> ();
+  arena.NewArray<uint8_t> (1024);
+  NS_TEST_ASSERT_MSG_EQ (arena.GetChunkCount (), 1, "The merged chunk should be large enough");
+}
+
+/**
+* Checks that released encode buffers are reused for requests of the same
+* bucket and that oversized buffers bypass the pool
+*/
+class EncodeBufferPoolTestCase : public TestCase
+{
+public:
+  EncodeBufferPoolTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+EncodeBufferPoolTestCase::EncodeBufferPoolTestCase ()
+  : TestCase ("Encode buffer pool reuse")
+{
+}
+
+void
+EncodeBufferPoolTestCase::DoRun (void)
+{
+  EncodeBufferPool *pool = EncodeBufferPool::Get ();
+
+  size_t capacity = 0;
+  void *first = pool->Acquire (1000, &capacity);
+  NS_TEST_ASSERT_MSG_EQ (capacity, 1024, "Capacity not rounded to the bucket size");
+  EncodeBufferPool::Release (first, capacity);
+
+  uint64_t hits = pool->GetHits ();
+  void *second = pool->Acquire (600, &capacity);
+  NS_TEST_ASSERT_MSG_EQ (second, first, "Released buffer was not reused");
+  NS_TEST_ASSERT_MSG_EQ (pool->GetHits (), hits + 1, "Reuse not accounted as a hit");
+  EncodeBufferPool::Release (second, capacity);
+
+  size_t bigCapacity = 0;
+  void *big = pool->Acquire (EncodeBufferPool::MAX_BUFFER_SIZE + 1, &bigCapacity);
+  NS_TEST_ASSERT_MSG_EQ (bigCapacity, EncodeBufferPool::MAX_BUFFER_SIZE + 1,
+                         "Oversized buffer should have the exact requested size");
+  EncodeBufferPool::Release (big, bigCapacity);
+}
+
+/**
+* Checks the live bytes, counts and high-water marks of the asn1c
+* allocation accounting, including the memory moved and freed by the
+* plain allocator as the asn1c runtime does
+*/
+class Asn1cAllocTestCase : public TestCase
+{
+public:
+  Asn1cAllocTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+Asn1cAllocTestCase::Asn1cAllocTestCase ()
+  : TestCase ("asn1c allocation accounting")
+{
+}
+
+void
+Asn1cAllocTestCase::DoRun (void)
+{
+  Asn1cAlloc::Enable ();
+  if (!Asn1cAlloc::IsAvailable ())
+    {
+      NS_TEST_ASSERT_MSG_EQ (Asn1cAlloc::IsEnabled (), false,
+                             "Accounting enabled without being built");
+      return;
+    }
+
+  Asn1cAlloc::Counters before = Asn1cAlloc::GetTotal ();
+  void *ptr = ASN1C_CALLOC ("Asn1cAllocTest", 1, 100);
+  NS_TEST_ASSERT_MSG_EQ (Asn1cAlloc::GetTotal ().m_liveBytes, before.m_liveBytes + 100,
+                         "Allocation not accounted");
+  NS_TEST_ASSERT_MSG_EQ (Asn1cAlloc::GetTypeCounters ()["Asn1cAllocTest"].m_liveCount, 1,
+                         "Allocation not accounted to its message type");
+
+#ifdef __GLIBC__
+  ptr = realloc (ptr, 300);
+  NS_TEST_ASSERT_MSG_EQ (Asn1cAlloc::GetTotal ().m_liveBytes, before.m_liveBytes + 300,
+                         "realloc not followed");
+  free (ptr);
+#else
+  ASN1C_FREE (ptr);
+#endif
+  NS_TEST_ASSERT_MSG_EQ (Asn1cAlloc::GetTotal ().m_liveBytes, before.m_liveBytes,
+                         "Free not accounted");
+  Asn1cAlloc::Counters type = Asn1cAlloc::GetTypeCounters ()["Asn1cAllocTest"];
+  NS_TEST_ASSERT_MSG_EQ (type.m_liveCount, 0, "Free not accounted to the message type");
+  NS_TEST_ASSERT_MSG_EQ (type.m_frees, 1, "Free not counted");
+  NS_TEST_ASSERT_MSG_EQ (type.m_peakBytes >= 100, true, "High-water mark not kept");
+}
+
+/**
+* Checks that headers patched from the cached template match the asn1c
+* encoding of the same values
+*/
+class KpmHeaderTemplateTestCase : public TestCase
+{
+public:
+  KpmHeaderTemplateTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmHeaderTemplateTestCase::KpmHeaderTemplateTestCase ()
+  : TestCase ("KPM indication header template patching")
+{
+}
+
+void
+KpmHeaderTemplateTestCase::DoRun (void)
+{
+  KpmIndicationHeader::ClearTemplateCache ();
+  // any mismatch against the asn1c encoder is fatal in validation mode
+  KpmIndicationHeader::SetTemplateValidation (true);
+
+  KpmIndicationHeader::KpmRicIndicationHeaderValues values;
+  values.m_gnbId = "1";
+  values.m_nrCellId = 1111;
+  values.m_plmId = "111";
+
+  const uint64_t timestamps[] = {0, 1, 1690000000000ULL, 0xFFFFFFFFFFFFFFFFULL};
+  size_t size = 0;
+  for (uint64_t timestamp : timestamps)
+    {
+      values.m_timestamp = timestamp;
+      Ptr<KpmIndicationHeader> header =
+          Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::gNB, values);
+      NS_TEST_ASSERT_MSG_NE (header->m_buffer, nullptr, "Header not encoded");
+      if (size != 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (header->m_size, size, "Header size depends on the timestamp");
+        }
+      size = header->m_size;
+    }
+
+  KpmIndicationHeader::SetTemplateValidation (false);
+}
+
+/**
+* Checks that KPIs set for the same entity by different calls share a
+* slot and that columns added later leave the other slots without a value
+*/
+class KpiTableTestCase : public TestCase
+{
+public:
+  KpiTableTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpiTableTestCase::KpiTableTestCase ()
+  : TestCase ("KPI table slots and columns")
+{
+}
+
+void
+KpiTableTestCase::DoRun (void)
+{
+  KpiTable kpis;
+  size_t first = kpis.GetSlot ("111000000000001");
+  kpis.SetInteger (first, "DRB.EstabSucc.5QI.UEID", 3);
+  size_t second = kpis.GetSlot ("111000000000002");
+  kpis.SetInteger (second, "DRB.EstabSucc.5QI.UEID", 4);
+  kpis.SetReal (kpis.GetSlot ("111000000000001"), "servingSINR", 12.5);
+
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetSlotCount (), 2, "Same UE added twice");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetColumnCount (), 2, "Same KPI added twice");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetValueCount (first), 2, "Wrong number of values");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetValueCount (second), 1, "Wrong number of values");
+  NS_TEST_ASSERT_MSG_EQ (kpis.HasValue (second, 1), false, "Unexpected value");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetIntegers (0)[second], 4, "Wrong integer value");
+  NS_TEST_ASSERT_MSG_EQ_TOL (kpis.GetReal (first, 1), 12.5, 1e-9, "Wrong real value");
+
+  kpis.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (kpis.IsEmpty (), true, "Clear did not drop the slots");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetColumnCount (), 2, "Clear dropped the columns");
+}
+
+/**
+* Checks that the KPI schema columns resolve to the same KpiTable columns
+* as the name lookups
+*/
+class KpiSchemaTestCase : public TestCase
+{
+public:
+  KpiSchemaTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpiSchemaTestCase::KpiSchemaTestCase ()
+  : TestCase ("KPI schema keyed columns")
+{
+}
+
+void
+KpiSchemaTestCase::DoRun (void)
+{
+  KpiTable kpis;
+  kpis.GetColumn ("DRB.UEThpDl.UEID", KPI_SCHEMA[kpi::DRB_UE_THP_DL_UEID].m_type);
+  for (size_t id = 0; id < kpi::COUNT; ++id)
+    {
+      const KpiDescriptor &descriptor = KPI_SCHEMA[id];
+      NS_TEST_ASSERT_MSG_EQ (descriptor.m_nameSize, std::string (descriptor.m_name).size (),
+                             "Wrong name size for " << descriptor.m_name);
+      size_t column = kpis.GetColumn (descriptor.m_id, descriptor.m_name, descriptor.m_type);
+      NS_TEST_ASSERT_MSG_EQ (kpis.GetColumn (descriptor.m_name, descriptor.m_type), column,
+                             "Keyed and named columns differ for " << descriptor.m_name);
+      NS_TEST_ASSERT_MSG_EQ (kpis.GetColumn (descriptor.m_id, descriptor.m_name, descriptor.m_type),
+                             column, "Keyed column not cached for " << descriptor.m_name);
+    }
+  // names are unique, e.g., the O-CU-UP and O-DU share a single PDCP volume KPI
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetColumnCount (), kpi::COUNT, "Duplicated KPI names in the schema");
+}
+
+/**
+* Checks that the legacy MeasurementItemList view built from the KPI
+* table converts back to the same KPIs
+*/
+class KpiRecordLegacyViewTestCase : public TestCase
+{
+public:
+  KpiRecordLegacyViewTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpiRecordLegacyViewTestCase::KpiRecordLegacyViewTestCase ()
+  : TestCase ("KPI records legacy view round trip")
+{
+}
+
+void
+KpiRecordLegacyViewTestCase::DoRun (void)
+{
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  size_t ue = values.m_ueKpis.GetSlot ("111000000000001");
+  values.m_ueKpis.SetInteger (ue, "DRB.EstabSucc.5QI.UEID", 3);
+  values.m_ueKpis.SetInteger (ue, "DRB.RelActNbr.5QI.UEID", 0);
+
+  std::set<Ptr<MeasurementItemList>> legacy =
+      KpmIndicationMessage::BuildLegacyUeIndications (values);
+  NS_TEST_ASSERT_MSG_EQ (legacy.size (), 1, "Wrong number of legacy UE lists");
+
+  KpiTable kpis;
+  KpmIndicationMessage::AddToKpiTable (*legacy.begin (), kpis, kpis.GetSlot ("UE-1"));
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetValueCount (0), 2, "Wrong number of KPIs");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetColumnName (0), "DRB.EstabSucc.5QI.UEID", "Wrong KPI name");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetInteger (0, 0), 3, "Wrong KPI value");
+
+  Ptr<MeasurementItemList> realList = Create<MeasurementItemList> ("UE-2");
+  realList->AddItem<double> ("DRB.UEThpDl.UEID", 1.2);
+  KpmIndicationMessage::AddToKpiTable (realList, kpis, kpis.GetSlot ("UE-2"));
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetColumnType (2), KpiTable::REAL, "Real values should stay real");
+  NS_TEST_ASSERT_MSG_EQ (kpis.GetReal (1, 2), 1.2, "Real values should not be rounded");
+  NS_TEST_ASSERT_MSG_EQ (KPI_SCHEMA[kpi::DRB_UE_THP_DL_UEID].m_type, KpiTable::REAL,
+                         "Throughputs should be reported as real values");
+}
+
+/**
+* Checks that the measurement names are interned once, in buffers of
+* their own size
+*/
+class MeasurementNameRegistryTestCase : public TestCase
+{
+public:
+  MeasurementNameRegistryTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MeasurementNameRegistryTestCase::MeasurementNameRegistryTestCase ()
+  : TestCase ("Measurement name registry")
+{
+}
+
+void
+MeasurementNameRegistryTestCase::DoRun (void)
+{
+  const KpiDescriptor &descriptor = KPI_SCHEMA[kpi::QOSFLOW_PDCP_PDU_VOLUME_DL_FILTER_UEID];
+  const MeasurementTypeName_t &schemaName =
+      MeasurementNameRegistry::Get (kpi::QOSFLOW_PDCP_PDU_VOLUME_DL_FILTER_UEID);
+  NS_TEST_ASSERT_MSG_EQ ((const char *) schemaName.buf, descriptor.m_name,
+                         "Schema names should not be copied");
+  NS_TEST_ASSERT_MSG_EQ (schemaName.size, descriptor.m_nameSize, "Wrong name size");
+  NS_TEST_ASSERT_MSG_EQ (&MeasurementNameRegistry::Intern (descriptor.m_name), &schemaName,
+                         "Schema name interned twice");
+
+  size_t size = MeasurementNameRegistry::GetSize ();
+  const std::string custom = "Custom.MeasurementNameLongerThanAnOctetString.UEID";
+  const MeasurementTypeName_t &customName = MeasurementNameRegistry::Intern (custom);
+  NS_TEST_ASSERT_MSG_EQ (std::string ((const char *) customName.buf, customName.size), custom,
+                         "Wrong interned name");
+  NS_TEST_ASSERT_MSG_EQ (&MeasurementNameRegistry::Intern (custom), &customName,
+                         "Name interned twice");
+  NS_TEST_ASSERT_MSG_EQ (MeasurementNameRegistry::GetSize (), size + 1, "Wrong registry size");
+
+  // a name longer than sizeof (OCTET_STRING) used to overflow its buffer
+  Ptr<MeasurementItem> item = Create<MeasurementItem> (std::string (descriptor.m_name), 5L);
+  const MeasurementTypeName_t &itemName = item->GetPointer ()->pmType.choice.measName;
+  NS_TEST_ASSERT_MSG_EQ (itemName.buf, schemaName.buf, "The item should share the schema name");
+  NS_TEST_ASSERT_MSG_EQ (itemName.size, schemaName.size, "Wrong item name size");
+}
+
+/**
+* Checks that the parallel build of the UE measurement report items
+* encodes the same bytes as the sequential one
+*/
+class KpmParallelBuildTestCase : public TestCase
+{
+public:
+  KpmParallelBuildTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmParallelBuildTestCase::KpmParallelBuildTestCase ()
+  : TestCase ("KPM indication parallel build")
+{
+}
+
+void
+KpmParallelBuildTestCase::DoRun (void)
+{
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  for (int ue = 0; ue < 301; ++ue)
+    {
+      size_t slot = values.m_ueKpis.GetSlot ("1110000000" + std::to_string (10000 + ue));
+      values.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", ue * 1000);
+      values.m_ueKpis.SetInteger (slot, "TB.TotNbrDl.1.UEID", ue);
+      values.m_ueKpis.SetReal (slot, "servingSINR", ue / 7.0);
+    }
+
+  srand (42);
+  Ptr<KpmIndicationMessage> sequential = Create<KpmIndicationMessage> (values);
+
+  KpmIndicationMessage::SetParallelBuild (4, 16);
+  srand (42);
+  Ptr<KpmIndicationMessage> parallel = Create<KpmIndicationMessage> (values);
+  KpmIndicationMessage::SetParallelBuild (1);
+
+  NS_TEST_ASSERT_MSG_EQ (parallel->m_size, sequential->m_size, "Encoded sizes differ");
+  NS_TEST_ASSERT_MSG_EQ (memcmp (parallel->m_buffer, sequential->m_buffer, sequential->m_size), 0,
+                         "Parallel build encoded different bytes");
+}
+
+/**
+* Checks that large reports are split according to the UE count and
+* encoded size limits
+*/
+class KpmIndicationSplitTestCase : public TestCase
+{
+public:
+  KpmIndicationSplitTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmIndicationSplitTestCase::KpmIndicationSplitTestCase ()
+  : TestCase ("KPM indication size-bounded splitting")
+{
+}
+
+void
+KpmIndicationSplitTestCase::DoRun (void)
+{
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  for (int ue = 0; ue < 100; ++ue)
+    {
+      size_t slot = values.m_ueKpis.GetSlot ("1110000000" + std::to_string (10000 + ue));
+      values.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", ue * 1000);
+      values.m_ueKpis.SetInteger (slot, "TB.TotNbrDl.1.UEID", ue);
+    }
+
+  std::vector<size_t> sizes;
+  auto collect = [&sizes] (Ptr<KpmIndicationMessage> msg) { sizes.push_back (msg->m_size); };
+
+  uint32_t messages = KpmIndicationMessage::BuildIndications (values, 30, 0, collect);
+  NS_TEST_ASSERT_MSG_EQ (messages, 4, "100 UEs should take 4 messages of at most 30 UEs");
+  NS_TEST_ASSERT_MSG_EQ (sizes.size (), 4, "Every message should reach the sink");
+
+  sizes.clear ();
+  Ptr<KpmIndicationMessage> whole = Create<KpmIndicationMessage> (values);
+  uint32_t maxSize = whole->m_size / 3;
+  messages = KpmIndicationMessage::BuildIndications (values, 0, maxSize, collect);
+  NS_TEST_ASSERT_MSG_GT (messages, 2, "Report not split on the size limit");
+  for (size_t size : sizes)
+    {
+      NS_TEST_ASSERT_MSG_LT (size, maxSize + 1, "Message exceeds the size limit");
+    }
+}
+
+/**
+* Checks that a report tree only rebuilds the reports of the UEs that
+* changed, and encodes the same bytes as a full build
+*/
+class KpmReportTreeTestCase : public TestCase
+{
+public:
+  KpmReportTreeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmReportTreeTestCase::KpmReportTreeTestCase ()
+  : TestCase ("KPM report tree updated in place")
+{
+}
+
+static KpmIndicationMessage::KpmIndicationMessageValues
+MakeReportTreeValues (int firstUe, int ues, int period, int ueWithoutSinr = -1)
+{
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  for (int ue = firstUe; ue < firstUe + ues; ++ue)
+    {
+      size_t slot = values.m_ueKpis.GetSlot ("1110000000" + std::to_string (10000 + ue));
+      values.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", ue * 1000 + period);
+      if (ue != ueWithoutSinr)
+        {
+          values.m_ueKpis.SetReal (slot, "servingSINR", ue / 7.0 + period);
+        }
+    }
+  return values;
+}
+
+void
+KpmReportTreeTestCase::DoRun (void)
+{
+  Ptr<KpmReportTree> tree = Create<KpmReportTree> ();
+  for (int period = 0; period < 3; ++period)
+    {
+      KpmIndicationMessage::KpmIndicationMessageValues values =
+          MakeReportTreeValues (0, 50, period);
+      Ptr<KpmIndicationMessage> full = Create<KpmIndicationMessage> (values);
+      NS_TEST_ASSERT_MSG_EQ (tree->Update (values), 50, "Every UE should be reported");
+      Ptr<KpmIndicationMessage> updated = Create<KpmIndicationMessage> (tree, 0, 50);
+
+      NS_TEST_ASSERT_MSG_EQ (tree->GetBuildCount (), 50, "Reports rebuilt without churn");
+      NS_TEST_ASSERT_MSG_EQ (updated->m_size, full->m_size, "Encoded sizes differ");
+      NS_TEST_ASSERT_MSG_EQ (memcmp (updated->m_buffer, full->m_buffer, full->m_size), 0,
+                             "Updated tree encoded different bytes");
+    }
+
+  // 5 UEs detach and 5 attach
+  NS_TEST_ASSERT_MSG_EQ (tree->Update (MakeReportTreeValues (5, 50, 3)), 50, "Wrong UE count");
+  NS_TEST_ASSERT_MSG_EQ (tree->GetUeCount (), 50, "Detached UEs should be dropped");
+  NS_TEST_ASSERT_MSG_EQ (tree->GetBuildCount (), 55, "Only the new UEs should be built");
+
+  // a UE losing a KPI is rebuilt
+  KpmIndicationMessage::KpmIndicationMessageValues values = MakeReportTreeValues (5, 50, 4, 5);
+  tree->Update (values);
+  NS_TEST_ASSERT_MSG_EQ (tree->GetBuildCount (), 56, "The UE with fewer KPIs should be rebuilt");
+
+  tree->RemoveUe ("111000000010005");
+  NS_TEST_ASSERT_MSG_EQ (tree->GetUeCount (), 49, "Removed UE still in the tree");
+
+  std::vector<size_t> sizes;
+  auto collect = [&sizes] (Ptr<KpmIndicationMessage> msg) { sizes.push_back (msg->m_size); };
+  uint32_t messages = KpmIndicationMessage::BuildIndications (values, 20, 0, collect, tree);
+  NS_TEST_ASSERT_MSG_EQ (messages, 3, "50 UEs should take 3 messages of at most 20 UEs");
+  NS_TEST_ASSERT_MSG_EQ (tree->GetBuildCount (), 57, "Only the removed UE should be rebuilt");
+}
+
+/**
+* Checks that the UE IDs are derived from the IMSI or the numeric UE ID,
+* built once, encoded identically in every report, and evicted when the
+* UE leaves a report tree
+*/
+class KpmUeIdCacheTestCase : public TestCase
+{
+public:
+  KpmUeIdCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmUeIdCacheTestCase::KpmUeIdCacheTestCase ()
+  : TestCase ("KPM UE ID cache keyed by IMSI")
+{
+}
+
+void
+KpmUeIdCacheTestCase::DoRun (void)
+{
+  KpmUeIdCache::UeIdentity identity = KpmUeIdCache::GetIdentity ("310260000012345");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_imsi, 310260000012345ULL, "Wrong IMSI");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_mcc, 310, "Wrong MCC");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_mnc, 26, "Wrong MNC");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_amfUeNgapId, 12345, "The AMF-UE-NGAP-ID should be the MSIN");
+
+  identity = KpmUeIdCache::GetIdentity ("ue-1");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_mcc, 111, "Wrong default MCC");
+  NS_TEST_ASSERT_MSG_LT (identity.m_amfUeNgapId, 1ULL << 40, "AMF-UE-NGAP-ID out of range");
+
+  // numeric UE IDs which are not IMSIs are keyed by their value
+  identity = KpmUeIdCache::GetIdentity ("00001");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_imsi, 1, "Wrong key of a numeric UE ID");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_mcc, 111, "MCC taken from a UE ID shorter than an IMSI");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_mnc, 11, "MNC taken from a UE ID shorter than an IMSI");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_amfUeNgapId, 1, "Wrong AMF-UE-NGAP-ID");
+  identity = KpmUeIdCache::GetIdentity ("1");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_imsi, 1, "Wrong key of a numeric UE ID");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_mcc, 111, "MCC taken from a UE ID shorter than an IMSI");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_amfUeNgapId, 1, "Wrong AMF-UE-NGAP-ID");
+  identity = KpmUeIdCache::GetIdentity ("1234567890123");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_mcc, 111, "MCC taken from a UE ID shorter than an IMSI");
+  NS_TEST_ASSERT_MSG_EQ (identity.m_amfUeNgapId, 1234567890123ULL & ((1ULL << 40) - 1),
+                         "AMF-UE-NGAP-ID should be the low 40 bits of the UE ID");
+
+  size_t size = KpmUeIdCache::GetSize ();
+  UEID_GNB_t *ueId = KpmUeIdCache::Acquire ("310260000012345");
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::Acquire ("310260000012345"), ueId, "UE ID built twice");
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::GetSize (), size + 1, "Wrong cache size");
+  NS_TEST_ASSERT_MSG_EQ (ueId->guami.pLMNIdentity.size, 3, "Wrong PLMN identity size");
+  NS_TEST_ASSERT_MSG_EQ ((int) ueId->guami.pLMNIdentity.buf[0], 0x13, "Wrong PLMN identity");
+  NS_TEST_ASSERT_MSG_EQ ((int) ueId->ran_UEID->buf[7], 310260000012345ULL & 0xff,
+                         "Wrong RAN UE ID");
+  KpmUeIdCache::Release ("310260000012345");
+  KpmUeIdCache::Release ("310260000012345");
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::GetSize (), size + 1, "UE ID freed without eviction");
+
+  ueId = KpmUeIdCache::Acquire ("00001");
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::Acquire ("1"), ueId, "Same numeric UE ID built twice");
+  NS_TEST_ASSERT_MSG_EQ ((int) ueId->ran_UEID->buf[7], 1, "Wrong RAN UE ID");
+  NS_TEST_ASSERT_MSG_EQ ((int) ueId->ran_UEID->buf[0], 0, "Wrong RAN UE ID");
+  KpmUeIdCache::Release ("1", true);
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::GetSize (), size + 2, "Referenced UE ID evicted");
+  KpmUeIdCache::Release ("00001");
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::GetSize (), size + 1, "Unreferenced UE ID not evicted");
+
+  // a report tree evicts the UE IDs of the UEs leaving its report
+  KpmIndicationMessage::KpmIndicationMessageValues treeValues;
+  size_t slot = treeValues.m_ueKpis.GetSlot ("222010000099999");
+  treeValues.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", 1000.5);
+  size = KpmUeIdCache::GetSize ();
+  Ptr<KpmReportTree> tree = Create<KpmReportTree> ();
+  tree->Update (treeValues);
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::GetSize (), size + 1, "UE ID of a reported UE not cached");
+  tree->Update (KpmIndicationMessage::KpmIndicationMessageValues ());
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::GetSize (), size, "UE ID kept after the UE left");
+  tree->Update (treeValues);
+  tree->RemoveUe ("222010000099999");
+  NS_TEST_ASSERT_MSG_EQ (KpmUeIdCache::GetSize (), size, "UE ID kept after RemoveUe");
+
+  KpmIndicationMessage::KpmIndicationMessageValues values = MakeReportTreeValues (0, 20, 0);
+  Ptr<KpmIndicationMessage> first = Create<KpmIndicationMessage> (values);
+  Ptr<KpmIndicationMessage> second = Create<KpmIndicationMessage> (values);
+  NS_TEST_ASSERT_MSG_EQ (second->m_size, first->m_size, "Encoded sizes differ");
+  NS_TEST_ASSERT_MSG_EQ (memcmp (second->m_buffer, first->m_buffer, first->m_size), 0,
+                         "The same report encoded different bytes");
+}
+
+/**
+* Checks that the measurements of a KPM action definition are decoded
+* into the subscription filter and that unsubscribed KPIs are not encoded
+*/
+class KpmSubscriptionFilterTestCase : public TestCase
+{
+public:
+  KpmSubscriptionFilterTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmSubscriptionFilterTestCase::KpmSubscriptionFilterTestCase ()
+  : TestCase ("KPM subscription filter")
+{
+}
+
+void
+KpmSubscriptionFilterTestCase::DoRun (void)
+{
+  // Format 1 action definition subscribing to a KPI by name and one by ID
+  Asn1Arena arena;
+  E2SM_KPM_ActionDefinition_Format1_t *format1 = arena.New<E2SM_KPM_ActionDefinition_Format1_t> ();
+  MeasurementInfoItem_t *items = arena.NewArray<MeasurementInfoItem_t> (2);
+  LabelInfoItem_t *labels = arena.NewArray<LabelInfoItem_t> (2);
+  long *noLabel = arena.New<long> ();
+  *noLabel = MeasurementLabel__noLabel_true;
+  std::string name = "DRB.UEThpDl.UEID";
+  items[0].measType.present = MeasurementType_PR_measName;
+  items[0].measType.choice.measName.buf = arena.CopyBytes (name.data (), name.size ());
+  items[0].measType.choice.measName.size = name.size ();
+  items[1].measType.present = MeasurementType_PR_measID;
+  items[1].measType.choice.measID = kpi::TB_TOT_NBR_DL_1_UEID + 1;
+  arena.ReserveList (&format1->measInfoList.list, 2);
+  for (int i = 0; i < 2; ++i)
+    {
+      labels[i].measLabel.noLabel = noLabel;
+      arena.ReserveList (&items[i].labelInfoList.list, 1);
+      ASN_SEQUENCE_ADD (&items[i].labelInfoList.list, &labels[i]);
+      ASN_SEQUENCE_ADD (&format1->measInfoList.list, &items[i]);
+    }
+  format1->granulPeriod = 100;
+
+  E2SM_KPM_ActionDefinition_t *definition = arena.New<E2SM_KPM_ActionDefinition_t> ();
+  definition->ric_Style_Type = 1;
+  definition->actionDefinition_formats.present =
+      E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format1;
+  definition->actionDefinition_formats.choice.actionDefinition_Format1 = format1;
+
+  void *buffer = nullptr;
+  size_t capacity = 0;
+  asn_enc_rval_t encoded = EncodeBufferPool::Encode (&asn_DEF_E2SM_KPM_ActionDefinition,
+                                                     definition, &buffer, &capacity);
+  NS_TEST_ASSERT_MSG_GT (encoded.encoded, 0, "Cannot encode the action definition");
+  Ptr<KpmSubscriptionFilter> filter =
+      KpmSubscriptionFilter::Decode ((const uint8_t *) buffer, encoded.encoded);
+  EncodeBufferPool::Release (buffer, capacity);
+
+  NS_TEST_ASSERT_MSG_EQ (!filter, false, "Action definition not decoded");
+  NS_TEST_ASSERT_MSG_EQ (filter->GetSize (), 2, "Wrong number of subscribed KPIs");
+  NS_TEST_ASSERT_MSG_EQ (filter->IsSubscribed (kpi::DRB_UE_THP_DL_UEID), true,
+                         "KPI subscribed by name not matched to the schema");
+  NS_TEST_ASSERT_MSG_EQ (filter->IsSubscribed ("TB.TotNbrDl.1.UEID"), true,
+                         "KPI subscribed by ID not matched to its name");
+  NS_TEST_ASSERT_MSG_EQ (filter->IsSubscribed (kpi::RRU_PRB_USED_DL_UEID), false,
+                         "Unsubscribed KPI accepted");
+  NS_TEST_ASSERT_MSG_EQ (filter->GetGranularityPeriod (), 100, "Wrong granularity period");
+  NS_TEST_ASSERT_MSG_EQ (!KpmSubscriptionFilter::Decode (nullptr, 0), true,
+                         "A missing action definition should report every KPI");
+
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  for (int ue = 0; ue < 10; ++ue)
+    {
+      size_t slot = values.m_ueKpis.GetSlot ("1110000000" + std::to_string (10000 + ue));
+      values.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", ue * 1000);
+      values.m_ueKpis.SetInteger (slot, "TB.TotNbrDl.1.UEID", ue);
+      values.m_ueKpis.SetInteger (slot, "RRU.PrbUsedDl.UEID", ue);
+      values.m_ueKpis.SetInteger (slot, "TB.ErrTotalNbrDl.1.UEID", ue);
+    }
+  // a UE reporting only unsubscribed KPIs is dropped
+  size_t unsubscribed = values.m_ueKpis.GetSlot ("111000000099999");
+  values.m_ueKpis.SetInteger (unsubscribed, "RRU.PrbUsedDl.UEID", 1);
+
+  srand (7);
+  Ptr<KpmIndicationMessage> full = Create<KpmIndicationMessage> (values);
+
+  // the same KPIs as the subscribed ones, on the UEs that report them
+  KpmIndicationMessage::KpmIndicationMessageValues expectedValues;
+  for (int ue = 0; ue < 10; ++ue)
+    {
+      size_t slot = expectedValues.m_ueKpis.GetSlot ("1110000000" + std::to_string (10000 + ue));
+      expectedValues.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", ue * 1000);
+      expectedValues.m_ueKpis.SetInteger (slot, "TB.TotNbrDl.1.UEID", ue);
+    }
+  srand (7);
+  Ptr<KpmIndicationMessage> expected = Create<KpmIndicationMessage> (expectedValues);
+
+  values.m_subscription = filter;
+  srand (7);
+  Ptr<KpmIndicationMessage> filtered = Create<KpmIndicationMessage> (values);
+  NS_TEST_ASSERT_MSG_LT (filtered->m_size, full->m_size, "Unsubscribed KPIs were encoded");
+  NS_TEST_ASSERT_MSG_EQ (filtered->m_size, expected->m_size, "Wrong filtered message size");
+  NS_TEST_ASSERT_MSG_EQ (memcmp (filtered->m_buffer, expected->m_buffer, expected->m_size), 0,
+                         "Filtered message differs from the subscribed KPIs alone");
+}
+
+/**
+* Checks that a subscription to cell KPIs only is reported with a single
+* cell-level Format 1 message
+*/
+class KpmCellFormat1TestCase : public TestCase
+{
+public:
+  KpmCellFormat1TestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmCellFormat1TestCase::KpmCellFormat1TestCase ()
+  : TestCase ("KPM cell-level Format 1 indication")
+{
+}
+
+void
+KpmCellFormat1TestCase::DoRun (void)
+{
+  Ptr<KpmSubscriptionFilter> filter = Create<KpmSubscriptionFilter> ();
+  filter->AddName ("RRU.PrbUsedDl");
+  filter->AddMeasId (kpi::DRB_MEAN_ACTIVE_UE_DL + 1);
+  NS_TEST_ASSERT_MSG_EQ (filter->IsCellLevel (), true, "Cell KPIs only should be cell-level");
+  Ptr<KpmSubscriptionFilter> mixed = Create<KpmSubscriptionFilter> ();
+  mixed->AddName ("RRU.PrbUsedDl");
+  mixed->AddName ("DRB.UEThpDl.UEID");
+  NS_TEST_ASSERT_MSG_EQ (mixed->IsCellLevel (), false, "UE KPIs need the UE reports");
+  Ptr<KpmSubscriptionFilter> unknown = Create<KpmSubscriptionFilter> ();
+  unknown->AddName ("Vendor.Specific");
+  NS_TEST_ASSERT_MSG_EQ (unknown->IsCellLevel (), false, "Unknown KPIs have no known scope");
+
+  KpmIndicationMessage::KpmIndicationMessageValues values = MakeReportTreeValues (0, 100, 0);
+  size_t cell = values.m_cellKpis.GetSlot ("");
+  values.m_cellKpis.SetReal (cell, "RRU.PrbUsedDl", 42);
+  values.m_cellKpis.SetInteger (cell, "DRB.MeanActiveUeDl", 100);
+  values.m_cellKpis.SetInteger (cell, "TB.TotNbrDl.1", 7);
+  values.m_subscription = filter;
+
+  std::vector<Ptr<KpmIndicationMessage>> messages;
+  auto collect = [&messages] (Ptr<KpmIndicationMessage> msg) { messages.push_back (msg); };
+  NS_TEST_ASSERT_MSG_EQ (KpmIndicationMessage::BuildIndications (values, 30, 0, collect), 1,
+                         "A cell-level report should take a single message");
+  NS_TEST_ASSERT_MSG_EQ (messages.size (), 1, "The message should reach the sink");
+
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                  (void **) &decoded, messages[0]->m_buffer, messages[0]->m_size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the indication message");
+  NS_TEST_ASSERT_MSG_EQ (
+      decoded->indicationMessage_formats.present,
+      E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format1,
+      "Cell-level reports should use Format 1");
+  E2SM_KPM_IndicationMessage_Format1_t *format1 =
+      decoded->indicationMessage_formats.choice.indicationMessage_Format1;
+  NS_TEST_ASSERT_MSG_EQ (format1->measData.list.count, 1, "One data item per period expected");
+  NS_TEST_ASSERT_MSG_EQ (format1->measInfoList->list.count, 2,
+                         "Only the subscribed cell KPIs should be encoded");
+  NS_TEST_ASSERT_MSG_EQ (format1->measData.list.array[0]->measRecord.list.count, 2,
+                         "Records should match the KPIs");
+  NS_TEST_ASSERT_MSG_EQ (format1->measData.list.array[0]->measRecord.list.array[0]->choice.real,
+                         42, "Wrong cell KPI value");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+}
+
+/**
+* Checks that the granularity periods of a batched report are encoded as
+* one MeasurementDataItem each, for the UE and the cell-level reports, and
+* that the UEs attaching or detaching meanwhile keep their samples
+*/
+class KpmBatchedGranularityTestCase : public TestCase
+{
+public:
+  KpmBatchedGranularityTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmBatchedGranularityTestCase::KpmBatchedGranularityTestCase ()
+  : TestCase ("KPM indication batching granularity periods")
+{
+}
+
+void
+KpmBatchedGranularityTestCase::DoRun (void)
+{
+  // UE 2 has no SINR in the second period, UE 4 attaches in the last one
+  std::vector<KpmIndicationMessage::KpmIndicationMessageValues> samples;
+  samples.push_back (MakeReportTreeValues (0, 4, 0));
+  samples.push_back (MakeReportTreeValues (0, 4, 1, 2));
+  samples.push_back (MakeReportTreeValues (0, 5, 2));
+  KpmIndicationMessage::KpmIndicationMessageValues batch =
+      KpmIndicationMessage::BatchGranularityPeriods (samples, 10);
+  NS_TEST_ASSERT_MSG_EQ (batch.m_ueKpiHistory.size (), 2, "Wrong number of earlier periods");
+
+  std::vector<Ptr<KpmIndicationMessage>> messages;
+  auto collect = [&messages] (Ptr<KpmIndicationMessage> msg) { messages.push_back (msg); };
+  NS_TEST_ASSERT_MSG_EQ (
+      KpmIndicationMessage::BuildIndications (batch, 0, 0, collect, Create<KpmReportTree> ()), 1,
+      "The periods should be sent in a single message");
+
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                  (void **) &decoded, messages[0]->m_buffer, messages[0]->m_size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the indication message");
+  E2SM_KPM_IndicationMessage_Format3_t *format3 =
+      decoded->indicationMessage_formats.choice.indicationMessage_Format3;
+  NS_TEST_ASSERT_MSG_EQ (format3->ueMeasReportList.list.count, 5, "Wrong number of UEs");
+  for (int ue = 0; ue < 5; ++ue)
+    {
+      E2SM_KPM_IndicationMessage_Format1_t &report =
+          format3->ueMeasReportList.list.array[ue]->measReport;
+      NS_TEST_ASSERT_MSG_EQ (report.measData.list.count, 3, "One data item per period expected");
+      NS_TEST_ASSERT_MSG_EQ (report.measInfoList->list.count, 2, "Wrong number of KPIs");
+      NS_TEST_ASSERT_MSG_EQ (!report.granulPeriod, false, "Granularity period not encoded");
+      NS_TEST_ASSERT_MSG_EQ (*report.granulPeriod, 10, "Wrong granularity period");
+      for (int period = 0; period < 3; ++period)
+        {
+          MeasurementRecord_t &records = report.measData.list.array[period]->measRecord;
+          NS_TEST_ASSERT_MSG_EQ (records.list.count, 2, "Records should match the KPIs");
+          if (ue == 4 && period < 2)
+            {
+              NS_TEST_ASSERT_MSG_EQ (records.list.array[0]->present,
+                                     MeasurementRecordItem_PR_noValue,
+                                     "A UE not yet attached should have no value");
+              continue;
+            }
+          NS_TEST_ASSERT_MSG_EQ (records.list.array[0]->choice.real, ue * 1000 + period,
+                                 "Wrong value of the period");
+          NS_TEST_ASSERT_MSG_EQ (records.list.array[1]->present == MeasurementRecordItem_PR_noValue,
+                                 ue == 2 && period == 1, "Wrong missing SINR");
+        }
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+
+  // UEs 3 and 4 detach before the last period, their samples are kept
+  std::vector<KpmIndicationMessage::KpmIndicationMessageValues> detached;
+  detached.push_back (MakeReportTreeValues (0, 5, 0));
+  detached.push_back (MakeReportTreeValues (0, 5, 1));
+  detached.push_back (MakeReportTreeValues (0, 3, 2));
+  messages.clear ();
+  NS_TEST_ASSERT_MSG_EQ (
+      KpmIndicationMessage::BuildIndications (
+          KpmIndicationMessage::BatchGranularityPeriods (detached, 10), 2, 0, collect),
+      3, "The UEs of every period should be split in messages of 2");
+  for (int ue = 0; ue < 5; ++ue)
+    {
+      decoded = nullptr;
+      rval = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                         (void **) &decoded, messages[ue / 2]->m_buffer, messages[ue / 2]->m_size);
+      NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the indication message");
+      E2SM_KPM_IndicationMessage_Format1_t &report =
+          decoded->indicationMessage_formats.choice.indicationMessage_Format3->ueMeasReportList
+              .list.array[ue % 2]
+              ->measReport;
+      NS_TEST_ASSERT_MSG_EQ (report.measData.list.count, 3, "One data item per period expected");
+      for (int period = 0; period < 3; ++period)
+        {
+          MeasurementRecordItem_t *record =
+              report.measData.list.array[period]->measRecord.list.array[0];
+          if (ue >= 3 && period == 2)
+            {
+              NS_TEST_ASSERT_MSG_EQ (record->present, MeasurementRecordItem_PR_noValue,
+                                     "A detached UE should have no value");
+              continue;
+            }
+          NS_TEST_ASSERT_MSG_EQ (record->choice.real, ue * 1000 + period,
+                                 "Wrong value of the period");
+        }
+      ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+    }
+
+  Ptr<KpmSubscriptionFilter> filter = Create<KpmSubscriptionFilter> ();
+  filter->AddName ("RRU.PrbUsedDl");
+  for (int period = 0; period < 3; ++period)
+    {
+      samples[period].m_cellKpis.SetReal (samples[period].m_cellKpis.GetSlot (""),
+                                          "RRU.PrbUsedDl", 40 + period);
+      samples[period].m_subscription = filter;
+    }
+  batch = KpmIndicationMessage::BatchGranularityPeriods (samples, 10);
+  messages.clear ();
+  KpmIndicationMessage::BuildIndications (batch, 0, 0, collect);
+  decoded = nullptr;
+  rval = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                     (void **) &decoded, messages[0]->m_buffer, messages[0]->m_size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the cell indication message");
+  E2SM_KPM_IndicationMessage_Format1_t *format1 =
+      decoded->indicationMessage_formats.choice.indicationMessage_Format1;
+  NS_TEST_ASSERT_MSG_EQ (format1->measData.list.count, 3, "One data item per period expected");
+  NS_TEST_ASSERT_MSG_EQ (format1->measData.list.array[1]->measRecord.list.array[0]->choice.real,
+                         41, "Wrong cell KPI value");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+}
+
+/**
+* Checks that the bins of a histogram KPI are encoded as a single
+* measurement with one distBinX label per bin
+*/
+class KpmHistogramLabelTestCase : public TestCase
+{
+public:
+  KpmHistogramLabelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmHistogramLabelTestCase::KpmHistogramLabelTestCase ()
+  : TestCase ("KPM histogram KPIs encoded with bin labels")
+{
+}
+
+void
+KpmHistogramLabelTestCase::DoRun (void)
+{
+  KpmIndicationMessage::KpmIndicationMessageValues values = MakeReportTreeValues (0, 3, 0);
+  for (size_t slot = 0; slot < values.m_ueKpis.GetSlotCount (); ++slot)
+    {
+      for (int bin = 0; bin < 6; ++bin)
+        {
+          const KpiDescriptor &descriptor = KPI_SCHEMA[kpi::CARR_PDSCH_MCS_DIST_BIN1_UEID + bin];
+          values.m_ueKpis.SetInteger (slot, descriptor.m_name, slot * 10 + bin);
+        }
+    }
+
+  Ptr<KpmIndicationMessage> labelled = Create<KpmIndicationMessage> (values);
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                  (void **) &decoded, labelled->m_buffer, labelled->m_size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the indication message");
+  E2SM_KPM_IndicationMessage_Format1_t &report = decoded->indicationMessage_formats.choice
+                                                     .indicationMessage_Format3->ueMeasReportList
+                                                     .list.array[1]
+                                                     ->measReport;
+  NS_TEST_ASSERT_MSG_EQ (report.measInfoList->list.count, 3,
+                         "The bins should be a single measurement");
+  MeasurementInfoItem_t *histogram = report.measInfoList->list.array[2];
+  NS_TEST_ASSERT_MSG_EQ (std::string ((const char *) histogram->measType.choice.measName.buf,
+                                      histogram->measType.choice.measName.size),
+                         "CARR.PDSCHMCSDist.UEID", "Wrong histogram name");
+  NS_TEST_ASSERT_MSG_EQ (histogram->labelInfoList.list.count, 6, "One label per bin expected");
+  NS_TEST_ASSERT_MSG_EQ (*histogram->labelInfoList.list.array[5]->measLabel.distBinX, 6,
+                         "Wrong bin label");
+  NS_TEST_ASSERT_MSG_EQ (report.measData.list.count, 1, "One data item per period expected");
+  MeasurementRecord_t &records = report.measData.list.array[0]->measRecord;
+  NS_TEST_ASSERT_MSG_EQ (records.list.count, 8, "One record per bin expected");
+  NS_TEST_ASSERT_MSG_EQ (records.list.array[2 + 3]->choice.integer, 13, "Wrong bin value");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+
+  // the report trees group the bins the same way
+  Ptr<KpmReportTree> tree = Create<KpmReportTree> ();
+  for (int period = 0; period < 2; ++period)
+    {
+      NS_TEST_ASSERT_MSG_EQ (tree->Update (values), 3, "Every UE should be reported");
+      Ptr<KpmIndicationMessage> updated = Create<KpmIndicationMessage> (tree, 0, 3);
+      NS_TEST_ASSERT_MSG_EQ (updated->m_size, labelled->m_size, "Encoded sizes differ");
+      NS_TEST_ASSERT_MSG_EQ (memcmp (updated->m_buffer, labelled->m_buffer, labelled->m_size), 0,
+                             "Updated tree encoded different bytes");
+    }
+
+  KpmIndicationMessage::SetHistogramLabels (false);
+  Ptr<KpmIndicationMessage> named = Create<KpmIndicationMessage> (values);
+  NS_TEST_ASSERT_MSG_LT (labelled->m_size, named->m_size,
+                         "Labelled bins should be smaller than named bins");
+
+  // the trees rebuild the reports whose encoding changed with the labels
+  uint64_t builds = tree->GetBuildCount ();
+  for (Ptr<KpmIndicationMessage> expected : {named, labelled})
+    {
+      tree->Update (values);
+      NS_TEST_ASSERT_MSG_EQ (tree->GetBuildCount (), builds + 3, "Every UE should be rebuilt");
+      builds = tree->GetBuildCount ();
+      Ptr<KpmIndicationMessage> updated = Create<KpmIndicationMessage> (tree, 0, 3);
+      NS_TEST_ASSERT_MSG_EQ (updated->m_size, expected->m_size, "Encoded sizes differ");
+      NS_TEST_ASSERT_MSG_EQ (memcmp (updated->m_buffer, expected->m_buffer, expected->m_size), 0,
+                             "Updated tree encoded different bytes");
+      KpmIndicationMessage::SetHistogramLabels (true);
+    }
+
+  Ptr<KpmSubscriptionFilter> filter = Create<KpmSubscriptionFilter> ();
+  filter->AddName ("L1M.RS-SINR");
+  NS_TEST_ASSERT_MSG_EQ (filter->GetSize (), 7, "A histogram should subscribe all of its bins");
+  NS_TEST_ASSERT_MSG_EQ (filter->IsSubscribed (kpi::L1M_RS_SINR_BIN127), true,
+                         "Bin not subscribed");
+  NS_TEST_ASSERT_MSG_EQ (filter->IsCellLevel (), true, "Cell histogram should be cell-level");
+}
+
+/**
+* Checks that the measurement IDs advertised in the RAN function
+* description are used in the indications of the KPIs subscribed by ID
+*/
+class KpmMeasIdEncodingTestCase : public TestCase
+{
+public:
+  KpmMeasIdEncodingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmMeasIdEncodingTestCase::KpmMeasIdEncodingTestCase ()
+  : TestCase ("KPM measurement IDs negotiated through the RAN function description")
+{
+}
+
+void
+KpmMeasIdEncodingTestCase::DoRun (void)
+{
+  Ptr<KpmFunctionDescription> description = Create<KpmFunctionDescription> ();
+  E2SM_KPM_RANfunction_Description_t *decodedDescription = nullptr;
+  asn_dec_rval_t rval = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER,
+                                    &asn_DEF_E2SM_KPM_RANfunction_Description,
+                                    (void **) &decodedDescription, description->m_buffer,
+                                    description->m_size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the RAN function description");
+  MeasurementInfo_Action_List_t &actions =
+      decodedDescription->ric_ReportStyle_List->list.array[0]->measInfo_Action_List;
+  long advertisedId = 0;
+  for (int i = 0; i < actions.list.count; ++i)
+    {
+      MeasurementInfo_Action_Item_t *action = actions.list.array[i];
+      if (action->measID != nullptr &&
+          std::string ((const char *) action->measName.buf, action->measName.size) ==
+              "DRB.UEThpDl.UEID")
+        {
+          advertisedId = *action->measID;
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (advertisedId, GetMeasId (kpi::DRB_UE_THP_DL_UEID),
+                         "The measurement ID of the KPI should be advertised");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_RANfunction_Description, decodedDescription);
+
+  std::vector<std::string> measurements = {"DRB.UEThpDl.UEID", "servingSINR",
+                                           "CARR.PDSCHMCSDist.UEID"};
+  std::vector<uint8_t> definition = MockRic::EncodeActionDefinition (measurements, 100, true);
+  Ptr<KpmSubscriptionFilter> byId =
+      KpmSubscriptionFilter::Decode (definition.data (), definition.size ());
+  NS_TEST_ASSERT_MSG_EQ (!byId, false, "Action definition not decoded");
+  NS_TEST_ASSERT_MSG_EQ (byId->GetSize (), 8, "The histogram should subscribe its bins");
+  NS_TEST_ASSERT_MSG_EQ (byId->IsSubscribedByMeasId (kpi::DRB_UE_THP_DL_UEID), true,
+                         "KPI subscribed by ID not recorded");
+  NS_TEST_ASSERT_MSG_EQ (byId->IsSubscribedByMeasId (kpi::CARR_PDSCH_MCS_DIST_BIN6_UEID), true,
+                         "Histogram subscribed by ID not recorded");
+  definition = MockRic::EncodeActionDefinition (measurements, 100);
+  Ptr<KpmSubscriptionFilter> byName =
+      KpmSubscriptionFilter::Decode (definition.data (), definition.size ());
+  NS_TEST_ASSERT_MSG_EQ (byName->IsSubscribedByMeasId (kpi::DRB_UE_THP_DL_UEID), false,
+                         "KPI subscribed by name recorded as by ID");
+
+  KpmIndicationMessage::KpmIndicationMessageValues values = MakeReportTreeValues (0, 3, 0);
+  for (size_t slot = 0; slot < values.m_ueKpis.GetSlotCount (); ++slot)
+    {
+      for (int bin = 0; bin < 6; ++bin)
+        {
+          const KpiDescriptor &descriptor = KPI_SCHEMA[kpi::CARR_PDSCH_MCS_DIST_BIN1_UEID + bin];
+          values.m_ueKpis.SetInteger (slot, descriptor.m_name, bin);
+        }
+    }
+  values.m_subscription = byName;
+  Ptr<KpmIndicationMessage> named = Create<KpmIndicationMessage> (values);
+  values.m_subscription = byId;
+  Ptr<KpmIndicationMessage> numbered = Create<KpmIndicationMessage> (values);
+  NS_TEST_ASSERT_MSG_LT (numbered->m_size, named->m_size,
+                         "Measurement IDs should be smaller than the names");
+
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  rval = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                     (void **) &decoded, numbered->m_buffer, numbered->m_size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the indication message");
+  MeasurementInfoList_t *infoList = decoded->indicationMessage_formats.choice
+                                        .indicationMessage_Format3->ueMeasReportList.list.array[0]
+                                        ->measReport.measInfoList;
+  NS_TEST_ASSERT_MSG_EQ (infoList->list.count, 3, "Wrong number of measurements");
+  NS_TEST_ASSERT_MSG_EQ (infoList->list.array[0]->measType.present, MeasurementType_PR_measID,
+                         "KPI subscribed by ID should be encoded by ID");
+  NS_TEST_ASSERT_MSG_EQ (infoList->list.array[0]->measType.choice.measID,
+                         GetMeasId (kpi::DRB_UE_THP_DL_UEID), "Wrong measurement ID");
+  NS_TEST_ASSERT_MSG_EQ (infoList->list.array[2]->measType.choice.measID,
+                         GetHistogramMeasId (KPI_HISTOGRAMS[0]), "Wrong histogram ID");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+}
+
+/**
+* Checks that the reporting period is decoded from a KPM event trigger
+* definition
+*/
+class KpmEventTriggerTestCase : public TestCase
+{
+public:
+  KpmEventTriggerTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmEventTriggerTestCase::KpmEventTriggerTestCase ()
+  : TestCase ("KPM event trigger reporting period")
+{
+}
+
+void
+KpmEventTriggerTestCase::DoRun (void)
+{
+  Asn1Arena arena;
+  E2SM_KPM_EventTriggerDefinition_Format1_t *format1 =
+      arena.New<E2SM_KPM_EventTriggerDefinition_Format1_t> ();
+  format1->reportingPeriod = 250;
+  E2SM_KPM_EventTriggerDefinition_t *trigger = arena.New<E2SM_KPM_EventTriggerDefinition_t> ();
+  trigger->eventDefinition_formats.present =
+      E2SM_KPM_EventTriggerDefinition__eventDefinition_formats_PR_eventDefinition_Format1;
+  trigger->eventDefinition_formats.choice.eventDefinition_Format1 = format1;
+
+  void *buffer = nullptr;
+  size_t capacity = 0;
+  asn_enc_rval_t encoded = EncodeBufferPool::Encode (&asn_DEF_E2SM_KPM_EventTriggerDefinition,
+                                                     trigger, &buffer, &capacity);
+  NS_TEST_ASSERT_MSG_GT (encoded.encoded, 0, "Cannot encode the event trigger definition");
+  uint32_t period =
+      E2Termination::DecodeReportingPeriod ((const uint8_t *) buffer, encoded.encoded);
+  EncodeBufferPool::Release (buffer, capacity);
+  NS_TEST_ASSERT_MSG_EQ (period, 250, "Wrong reporting period");
+
+  NS_TEST_ASSERT_MSG_EQ (E2Termination::DecodeReportingPeriod (nullptr, 0), 0,
+                         "A missing event trigger should have no period");
+}
+
+/**
+* Checks that values pushed by concurrent producers are all popped once,
+* in order per producer, and that a full queue rejects pushes
+*/
+class MpscQueueTestCase : public TestCase
+{
+public:
+  MpscQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MpscQueueTestCase::MpscQueueTestCase ()
+  : TestCase ("MPSC queue")
+{
+}
+
+void
+MpscQueueTestCase::DoRun (void)
+{
+  MpscQueue<uint32_t> small (3);
+  NS_TEST_ASSERT_MSG_EQ (small.GetCapacity (), 4, "Capacity not rounded to a power of two");
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (small.TryPush (i), true, "Push rejected below the capacity");
+    }
+  uint32_t value = 4;
+  NS_TEST_ASSERT_MSG_EQ (small.TryPush (value), false, "Push accepted by a full queue");
+
+  const uint32_t producers = 4;
+  const uint32_t perProducer = 20000;
+  MpscQueue<uint32_t> queue (64);
+  std::vector<std::thread> threads;
+  for (uint32_t p = 0; p < producers; ++p)
+    {
+      threads.emplace_back ([&queue, p, perProducer] () {
+        for (uint32_t i = 0; i < perProducer; ++i)
+          {
+            uint32_t item = p * perProducer + i;
+            while (!queue.TryPush (item))
+              {
+                std::this_thread::yield ();
+              }
+          }
+      });
+    }
+
+  std::vector<uint32_t> next (producers, 0);
+  bool ordered = true;
+  uint32_t popped = 0;
+  while (popped < producers * perProducer)
+    {
+      if (queue.TryPop (value))
+        {
+          uint32_t p = value / perProducer;
+          ordered = ordered && value % perProducer == next[p];
+          next[p]++;
+          popped++;
+        }
+    }
+  for (auto &thread : threads)
+    {
+      thread.join ();
+    }
+  NS_TEST_ASSERT_MSG_EQ (ordered, true, "Values of a producer popped out of order");
+  NS_TEST_ASSERT_MSG_EQ (queue.IsEmpty (), true, "Values left in the queue");
+}
+
+/**
+* Checks that the reactor calls the handler of a readable descriptor on
+* one of its threads, and stops calling it after Remove
+*/
+class E2IoReactorTestCase : public TestCase
+{
+public:
+  E2IoReactorTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+E2IoReactorTestCase::E2IoReactorTestCase ()
+  : TestCase ("E2 I/O reactor")
+{
+}
+
+void
+E2IoReactorTestCase::DoRun (void)
+{
+  int fds[2];
+  NS_TEST_ASSERT_MSG_EQ (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, fds), 0, "socketpair failed");
+  fcntl (fds[1], F_SETFL, fcntl (fds[1], F_GETFL) | O_NONBLOCK);
+
+  E2IoReactor *reactor = E2IoReactor::Get ();
+  size_t watched = reactor->GetSize ();
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint32_t received = 0;
+  reactor->Add (fds[1], [&] () {
+    char byte;
+    while (recv (fds[1], &byte, 1, 0) == 1)
+      {
+        std::lock_guard<std::mutex> lock (mutex);
+        received++;
+        cv.notify_one ();
+      }
+  });
+  NS_TEST_EXPECT_MSG_EQ (reactor->GetSize (), watched + 1, "Descriptor not watched");
+
+  const uint32_t messages = 3;
+  for (uint32_t i = 0; i < messages; ++i)
+    {
+      char byte = i;
+      NS_TEST_EXPECT_MSG_EQ (send (fds[0], &byte, 1, 0), 1, "send failed");
+      std::unique_lock<std::mutex> lock (mutex);
+      cv.wait_for (lock, std::chrono::seconds (5), [&] { return received == i + 1; });
+    }
+  NS_TEST_EXPECT_MSG_EQ (received, messages, "Handler not called for every message");
+
+  reactor->Remove (fds[1]);
+  NS_TEST_ASSERT_MSG_EQ (reactor->GetSize (), watched, "Descriptor still watched");
+  char byte = 0;
+  send (fds[0], &byte, 1, 0);
+  std::this_thread::sleep_for (std::chrono::milliseconds (50));
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    NS_TEST_ASSERT_MSG_EQ (received, messages, "Handler called after Remove");
+  }
+
+  // Remove waits for a running handler, except when called by the handler
+  std::atomic<bool> started (false);
+  std::atomic<bool> returned (false);
+  reactor->Add (fds[1], [&] () {
+    started = true;
+    std::this_thread::sleep_for (std::chrono::milliseconds (100));
+    returned = true;
+  });
+  send (fds[0], &byte, 1, 0);
+  for (uint32_t i = 0; i < 5000 && !started; ++i)
+    {
+      std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+  NS_TEST_EXPECT_MSG_EQ (started, true, "Handler not called");
+  reactor->Remove (fds[1]);
+  NS_TEST_EXPECT_MSG_EQ (returned, true, "Remove returned before the handler");
+
+  // the bytes left unread keep the descriptor readable
+  std::atomic<bool> removed (false);
+  reactor->Add (fds[1], [&] () {
+    reactor->Remove (fds[1]);
+    removed = true;
+  });
+  for (uint32_t i = 0; i < 5000 && !removed; ++i)
+    {
+      std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+  NS_TEST_EXPECT_MSG_EQ (removed, true, "Handler blocked removing its own descriptor");
+  NS_TEST_EXPECT_MSG_EQ (reactor->GetSize (), watched, "Descriptor still watched");
+  close (fds[0]);
+  close (fds[1]);
+}
+
+/**
+* Checks that messages sent on a transport are received whole and in
+* order by the other end, for the in-process and socket backends
+*/
+class E2TransportTestCase : public TestCase
+{
+public:
+  E2TransportTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * Sends messages of growing sizes from one end to the other
+  *
+  * \param sender the sending end
+  * \param receiver the receiving end
+  * \param name the name of the backend
+  */
+  void CheckTransport (Ptr<E2Transport> sender, Ptr<E2Transport> receiver, std::string name);
+};
+
+E2TransportTestCase::E2TransportTestCase ()
+  : TestCase ("E2 transports")
+{
+}
+
+void
+E2TransportTestCase::CheckTransport (Ptr<E2Transport> sender, Ptr<E2Transport> receiver,
+                                     std::string name)
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::vector<uint8_t>> received;
+  NS_TEST_ASSERT_MSG_EQ (receiver->Connect ([&] (const uint8_t *buffer, size_t size) {
+                           std::lock_guard<std::mutex> lock (mutex);
+                           received.emplace_back (buffer, buffer + size);
+                           cv.notify_one ();
+                         }),
+                         true, name << ": cannot connect the receiver");
+  NS_TEST_EXPECT_MSG_EQ (sender->Connect ([] (const uint8_t *, size_t) {}), true,
+                         name << ": cannot connect the sender");
+
+  // the last message is larger than 64 KiB
+  const size_t messages = 65;
+  for (size_t i = 0; i < messages; ++i)
+    {
+      std::vector<uint8_t> message (i + 1 < messages ? 1 + i * 100 : 100000, (uint8_t) i);
+      NS_TEST_EXPECT_MSG_EQ (sender->Send (message.data (), message.size ()), true,
+                             name << ": send failed");
+    }
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    cv.wait_for (lock, std::chrono::seconds (5), [&] { return received.size () == messages; });
+  }
+  sender->Close ();
+  receiver->Close ();
+
+  NS_TEST_ASSERT_MSG_EQ (received.size (), messages, name << ": messages lost");
+  for (size_t i = 0; i < messages; ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (received[i].size (), i + 1 < messages ? 1 + i * 100 : 100000,
+                             name << ": message truncated");
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) received[i].back (), i, name << ": message out of order");
+    }
+}
+
+void
+E2TransportTestCase::DoRun (void)
+{
+  auto pair = InProcessE2Transport::CreatePair (16);
+  CheckTransport (pair.first, pair.second, "in-process");
+
+  int fds[2];
+  NS_TEST_ASSERT_MSG_EQ (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, fds), 0, "socketpair failed");
+  CheckTransport (Create<SocketE2Transport> (fds[0]), Create<SocketE2Transport> (fds[1]),
+                  "Unix socket");
+
+  // a sender is not held forever by an end that does not drain its queue
+  uint8_t byte = 0;
+  auto stalled = InProcessE2Transport::CreatePair (2, MilliSeconds (20));
+  for (int i = 0; i < 2; ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (stalled.first->Send (&byte, 1), true, "Message not queued");
+    }
+  NS_TEST_EXPECT_MSG_EQ (stalled.first->Send (&byte, 1), false, "Message of the full queue sent");
+  stalled.second->Close ();
+  NS_TEST_EXPECT_MSG_EQ (stalled.first->Send (&byte, 1), false, "Message sent to a closed end");
+  NS_TEST_EXPECT_MSG_EQ (stalled.first->GetDroppedCount (), 2, "Wrong number of dropped messages");
+}
+
+/**
+* Forwards to another transport, and holds the senders while closed
+*/
+class GatedE2Transport : public E2Transport
+{
+public:
+  explicit GatedE2Transport (Ptr<E2Transport> transport)
+    : m_transport (transport),
+      m_open (true),
+      m_waiting (0)
+  {
+  }
+
+  virtual bool
+  Connect (ReceiveCallback receive)
+  {
+    return m_transport->Connect (receive);
+  }
+
+  virtual bool
+  Send (const uint8_t *buffer, size_t size)
+  {
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      m_waiting++;
+      m_cv.notify_all ();
+      m_cv.wait (lock, [this] { return m_open; });
+      m_waiting--;
+    }
+    return m_transport->Send (buffer, size);
+  }
+
+  virtual void
+  Close ()
+  {
+    SetOpen (true);
+    m_transport->Close ();
+  }
+
+  void
+  SetOpen (bool open)
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_open = open;
+    m_cv.notify_all ();
+  }
+
+  /**
+  * \return false if no sender is held after 5 s
+  */
+  bool
+  WaitForSender ()
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    return m_cv.wait_for (lock, std::chrono::seconds (5), [this] { return m_waiting > 0; });
+  }
+
+private:
+  Ptr<E2Transport> m_transport;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_open;
+  uint32_t m_waiting; //!< senders held or about to be
+};
+
+/**
+* Sender thread of the E2Termination: messages queued while it sleeps,
+* while it is held by the transport with a full queue, and when it is
+* stopped
+*/
+class SenderThreadTestCase : public TestCase
+{
+public:
+  SenderThreadTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * Queues a RIC Indication with one UE
+  */
+  void Indicate ();
+
+  /**
+  * \return false if fewer messages reached the RIC end after 5 s
+  */
+  bool WaitForMessages (size_t count);
+
+  Ptr<E2Termination> m_e2Term;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  size_t m_received; //!< messages received by the RIC end
+};
+
+SenderThreadTestCase::SenderThreadTestCase ()
+  : TestCase ("Sender thread"),
+    m_received (0)
+{
+}
+
+void
+SenderThreadTestCase::Indicate ()
+{
+  E2Termination::RicSubscriptionRequest_rval_s params {};
+  params.requestorId = 1;
+  params.instanceId = 1;
+  params.ranFuncionId = 200;
+  params.actionId = 1;
+
+  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues;
+  headerValues.m_plmId = "111";
+  headerValues.m_gnbId = "1";
+  headerValues.m_nrCellId = 1;
+  Ptr<KpmIndicationHeader> header =
+      Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::gNB, headerValues);
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  size_t slot = values.m_ueKpis.GetSlot ("111000000010000");
+  values.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", 1000.5);
+  NS_TEST_EXPECT_MSG_EQ (m_e2Term->SendKpmIndications (params, header, values), 1,
+                         "Wrong number of RIC Indications");
+}
+
+bool
+SenderThreadTestCase::WaitForMessages (size_t count)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  return m_cv.wait_for (lock, std::chrono::seconds (5),
+                        [this, count] { return m_received >= count; });
+}
+
+void
+SenderThreadTestCase::DoRun (void)
+{
+  auto pair = InProcessE2Transport::CreatePair ();
+  Ptr<GatedE2Transport> gate = Create<GatedE2Transport> (pair.first);
+  NS_TEST_ASSERT_MSG_EQ (pair.second->Connect ([this] (const uint8_t *, size_t) {
+                           std::lock_guard<std::mutex> lock (m_mutex);
+                           m_received++;
+                           m_cv.notify_all ();
+                         }),
+                         true, "Cannot connect the RIC end");
+
+  m_e2Term = CreateObject<E2Termination> ("127.0.0.1", 36422, 38470, "1", "111");
+  m_e2Term->SetAttribute ("SendQueueSize", UintegerValue (2));
+  m_e2Term->SetAttribute ("InboundQueueSize", UintegerValue (0));
+  m_e2Term->SetTransport (gate);
+  m_e2Term->Start ();
+  // the E2 Setup Request is sent by Start
+  NS_TEST_EXPECT_MSG_EQ (WaitForMessages (1), true, "No E2 Setup Request");
+
+  // the sender sleeps after each burst, and is woken by the next one
+  for (size_t burst = 1; burst <= 4; ++burst)
+    {
+      Indicate ();
+      Indicate ();
+      NS_TEST_EXPECT_MSG_EQ (WaitForMessages (1 + 2 * burst), true, "Messages of a burst lost");
+    }
+  E2Termination::SendQueueStats stats = m_e2Term->GetSendQueueStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.m_enqueued, 8, "Wrong number of enqueued messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_sent, 8, "Wrong number of sent messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_dropped, 0, "Messages dropped");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_depth, 0, "Messages left in the queue");
+
+  // the sender is held with one message, two fill the queue and three
+  // are dropped
+  gate->SetOpen (false);
+  Indicate ();
+  NS_TEST_EXPECT_MSG_EQ (gate->WaitForSender (), true, "Sender not held by the transport");
+  for (size_t i = 0; i < 5; ++i)
+    {
+      Indicate ();
+    }
+  stats = m_e2Term->GetSendQueueStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.m_enqueued, 11, "Wrong number of enqueued messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_dropped, 3, "Messages of the full queue not dropped");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_depth, 2, "Wrong number of queued messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_maxDepth, 2, "Queue deeper than its size");
+  gate->SetOpen (true);
+  NS_TEST_EXPECT_MSG_EQ (WaitForMessages (12), true, "Queued messages lost");
+  stats = m_e2Term->GetSendQueueStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.m_sent, 11, "Wrong number of sent messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_depth, 0, "Messages left in the queue");
+
+  // the sender is stopped while held with a full queue, and sends the
+  // queued messages before stopping
+  gate->SetOpen (false);
+  Indicate ();
+  NS_TEST_EXPECT_MSG_EQ (gate->WaitForSender (), true, "Sender not held by the transport");
+  Indicate ();
+  Indicate ();
+  std::thread opener ([gate] () {
+    std::this_thread::sleep_for (std::chrono::milliseconds (50));
+    gate->SetOpen (true);
+  });
+  m_e2Term->Dispose ();
+  opener.join ();
+  stats = m_e2Term->GetSendQueueStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.m_enqueued, 14, "Wrong number of enqueued messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_sent + stats.m_dropped, stats.m_enqueued + 3,
+                         "Messages neither sent nor dropped");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_sent, 14, "Queued messages not sent before stopping");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_depth, 0, "Messages left in the queue");
+  NS_TEST_EXPECT_MSG_EQ (WaitForMessages (1 + stats.m_sent), true, "Sent messages lost");
+
+  m_e2Term = nullptr;
+  pair.second->Close ();
+  Simulator::Destroy ();
+}
+
+/**
+* Runs the whole E2 path against the mock RIC over an in-process
+* transport: E2 Setup, RIC Subscription with its trigger and action
+* definition, KPM RIC Indication and E2SM-RC RIC Control
+*/
+class MockRicLoopbackTestCase : public TestCase
+{
+public:
+  MockRicLoopbackTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MockRicLoopbackTestCase::MockRicLoopbackTestCase ()
+  : TestCase ("Mock RIC loopback")
+{
+}
+
+void
+MockRicLoopbackTestCase::DoRun (void)
+{
+  auto pair = InProcessE2Transport::CreatePair ();
+  Ptr<E2Termination> e2Term = CreateObject<E2Termination> ("127.0.0.1", 36422, 38470, "1", "111");
+  // callbacks run on the reactor thread, the simulator is not running
+  e2Term->SetAttribute ("InboundQueueSize", UintegerValue (0));
+  e2Term->SetTransport (pair.first);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool subscribed = false;
+  E2Termination::RicSubscriptionRequest_rval_s params;
+  RicControlMessage::ControlMessageRequestIdType controlType = RicControlMessage::RC;
+  bool controlled = false;
+  e2Term->RegisterKpmCallbackToE2Sm (200, Create<KpmFunctionDescription> (),
+                                     [&] (E2AP_PDU_t *pdu) {
+                                       auto result = e2Term->ProcessRicSubscriptionRequest (pdu);
+                                       std::lock_guard<std::mutex> lock (mutex);
+                                       params = result;
+                                       subscribed = true;
+                                       cv.notify_all ();
+                                     });
+  e2Term->RegisterSmCallbackToE2Sm (300, Create<RicControlFunctionDescription> (),
+                                    [&] (E2AP_PDU_t *pdu) {
+                                      Ptr<RicControlMessage> message =
+                                          Create<RicControlMessage> (pdu);
+                                      std::lock_guard<std::mutex> lock (mutex);
+                                      controlType = message->m_requestType;
+                                      controlled = true;
+                                      cv.notify_all ();
+                                    });
+
+  Ptr<MockRic> ric = CreateObject<MockRic> ();
+  ric->SetTransport (pair.second);
+  ric->AddSubscription (200, MockRic::EncodeEventTrigger (100),
+                        MockRic::EncodeActionDefinition ({"DRB.UEThpDl.UEID"}, 100));
+  ric->Start ();
+  e2Term->Start ();
+
+  NS_TEST_EXPECT_MSG_EQ (ric->WaitForSetup (5000), true, "No E2 Setup Request");
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    cv.wait_for (lock, std::chrono::seconds (5), [&] { return subscribed; });
+  }
+  NS_TEST_EXPECT_MSG_EQ (subscribed, true, "No RIC Subscription Request");
+  NS_TEST_EXPECT_MSG_EQ (params.reportingPeriod, 100, "Wrong reporting period");
+  NS_TEST_EXPECT_MSG_EQ (params.subscription && params.subscription->GetSize () == 1, true,
+                         "Wrong action definition");
+
+  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues;
+  headerValues.m_plmId = "111";
+  headerValues.m_gnbId = "1";
+  headerValues.m_nrCellId = 1;
+  Ptr<KpmIndicationHeader> header =
+      Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::gNB, headerValues);
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  size_t slot = values.m_ueKpis.GetSlot ("111000000010000");
+  values.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", 1000);
+  values.m_subscription = params.subscription;
+  e2Term->SendKpmIndications (params, header, values);
+  NS_TEST_EXPECT_MSG_EQ (ric->WaitForIndications (1, 5000), true, "No RIC Indication decoded");
+
+  ric->SendControl (MockRic::HANDOVER, 1, 2);
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    cv.wait_for (lock, std::chrono::seconds (5), [&] { return controlled; });
+  }
+  NS_TEST_EXPECT_MSG_EQ (controlled, true, "No RIC Control Request");
+  NS_TEST_EXPECT_MSG_EQ (controlType, RicControlMessage::TS, "Wrong RIC requestor");
+
+  MockRic::Stats stats = ric->GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.m_setupRequests, 1, "Wrong number of E2 Setup Requests");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_decodeErrors, 0, "Messages of the E2 node not decoded");
+
+  ric->Dispose ();
+  e2Term->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+* Periodic reports of two subscriptions with the same reporting period,
+* the second one added while the first is reported, then both removed
+*/
+class PeriodicReportsTestCase : public TestCase
+{
+public:
+  PeriodicReportsTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * KpmReportProvider of the RAN function 200, with one UE
+  */
+  bool Report (const E2Termination::RicSubscriptionRequest_rval_s &params,
+               Ptr<KpmIndicationHeader> &header,
+               KpmIndicationMessage::KpmIndicationMessageValues &values);
+
+  /**
+  * Sends the second RIC Subscription Request, and waits for its
+  * processing so that it is added at the current time
+  */
+  void Subscribe ();
+
+  void Unsubscribe (size_t index);
+
+  bool WaitForSubscriptions (size_t count);
+
+  Ptr<E2Termination> m_e2Term;
+  Ptr<MockRic> m_ric;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<E2Termination::RicSubscriptionRequest_rval_s> m_subscriptions;
+  std::map<long, std::vector<int64_t>> m_reportTimes; //!< in ms, by RIC instance ID
+  std::map<long, std::vector<long>> m_sequenceNumbers; //!< by RIC instance ID
+};
+
+PeriodicReportsTestCase::PeriodicReportsTestCase ()
+  : TestCase ("Periodic reports of the subscriptions")
+{
+}
+
+bool
+PeriodicReportsTestCase::Report (const E2Termination::RicSubscriptionRequest_rval_s &params,
+                                 Ptr<KpmIndicationHeader> &header,
+                                 KpmIndicationMessage::KpmIndicationMessageValues &values)
+{
+  m_reportTimes[params.instanceId].push_back (Simulator::Now ().GetMilliSeconds ());
+
+  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues;
+  headerValues.m_plmId = "111";
+  headerValues.m_gnbId = "1";
+  headerValues.m_nrCellId = 1;
+  header = Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::gNB, headerValues);
+  size_t slot = values.m_ueKpis.GetSlot ("111000000010000");
+  values.m_ueKpis.SetReal (slot, "DRB.UEThpDl.UEID", 1000.5);
+  return true;
+}
+
+void
+PeriodicReportsTestCase::Subscribe ()
+{
+  m_ric->AddSubscription (200, MockRic::EncodeEventTrigger (100),
+                          MockRic::EncodeActionDefinition ({"DRB.UEThpDl.UEID"}, 100));
+  NS_TEST_EXPECT_MSG_EQ (WaitForSubscriptions (2), true, "No second RIC Subscription Request");
+}
+
+void
+PeriodicReportsTestCase::Unsubscribe (size_t index)
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  if (index < m_subscriptions.size ())
+    {
+      m_e2Term->RemoveSubscription (m_subscriptions[index]);
+    }
+}
+
+bool
+PeriodicReportsTestCase::WaitForSubscriptions (size_t count)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  return m_cv.wait_for (lock, std::chrono::seconds (5),
+                        [this, count] { return m_subscriptions.size () >= count; });
+}
+
+void
+PeriodicReportsTestCase::DoRun (void)
+{
+  // the simulator is created on this thread, before the reactor thread
+  // schedules the subscriptions on it
+  Simulator::Stop (MilliSeconds (1000));
+
+  auto pair = InProcessE2Transport::CreatePair ();
+  m_e2Term = CreateObject<E2Termination> ("127.0.0.1", 36422, 38470, "1", "111");
+  // the requests are processed on the reactor thread, which schedules the
+  // subscriptions at the current simulation time
+  m_e2Term->SetAttribute ("InboundQueueSize", UintegerValue (0));
+  m_e2Term->SetTransport (pair.first);
+  m_e2Term->RegisterKpmCallbackToE2Sm (
+      200, Create<KpmFunctionDescription> (), [this] (E2AP_PDU_t *pdu) {
+        auto params = m_e2Term->ProcessRicSubscriptionRequest (pdu);
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_subscriptions.push_back (params);
+        m_cv.notify_all ();
+      });
+  m_e2Term->RegisterKpmReportProvider (
+      200, [this] (const E2Termination::RicSubscriptionRequest_rval_s &params,
+                   Ptr<KpmIndicationHeader> &header,
+                   KpmIndicationMessage::KpmIndicationMessageValues &values) {
+        return Report (params, header, values);
+      });
+
+  m_ric = CreateObject<MockRic> ();
+  m_ric->SetTransport (pair.second);
+  m_ric->SetIndicationCallback ([this] (long ranFunctionId, long instanceId, long sequenceNumber,
+                                        const E2SM_KPM_IndicationHeader_t *header,
+                                        const E2SM_KPM_IndicationMessage_t *message) {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_sequenceNumbers[instanceId].push_back (sequenceNumber);
+  });
+  m_ric->AddSubscription (200, MockRic::EncodeEventTrigger (100),
+                          MockRic::EncodeActionDefinition ({"DRB.UEThpDl.UEID"}, 100));
+  m_ric->Start ();
+  m_e2Term->Start ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_ric->WaitForSetup (5000), true, "No E2 Setup Request");
+  NS_TEST_EXPECT_MSG_EQ (WaitForSubscriptions (1), true, "No first RIC Subscription Request");
+
+  // reported at 100 to 600 ms, and at 300 and 400 ms
+  Simulator::Schedule (MilliSeconds (250), &PeriodicReportsTestCase::Subscribe, this);
+  Simulator::Schedule (MilliSeconds (450), &PeriodicReportsTestCase::Unsubscribe, this, 1);
+  Simulator::Schedule (MilliSeconds (650), &PeriodicReportsTestCase::Unsubscribe, this, 0);
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_e2Term->GetSubscriptionCount (), 0, "Subscriptions not removed");
+  NS_TEST_EXPECT_MSG_EQ (m_ric->WaitForIndications (8, 5000), true, "Missing RIC Indications");
+  NS_TEST_EXPECT_MSG_EQ (m_subscriptions.size (), 2, "Wrong number of subscriptions");
+  if (m_subscriptions.size () == 2)
+    {
+      long first = m_subscriptions[0].instanceId;
+      long second = m_subscriptions[1].instanceId;
+      std::vector<int64_t> firstTimes = {100, 200, 300, 400, 500, 600};
+      std::vector<int64_t> secondTimes = {300, 400};
+      NS_TEST_EXPECT_MSG_EQ ((m_reportTimes[first] == firstTimes), true,
+                             "First subscription not reported at the multiples of the period");
+      NS_TEST_EXPECT_MSG_EQ ((m_reportTimes[second] == secondTimes), true,
+                             "Second subscription not reported with the first one");
+
+      std::lock_guard<std::mutex> lock (m_mutex);
+      std::vector<long> firstSequenceNumbers = {1, 2, 3, 4, 5, 6};
+      std::vector<long> secondSequenceNumbers = {1, 2};
+      NS_TEST_EXPECT_MSG_EQ ((m_sequenceNumbers[first] == firstSequenceNumbers), true,
+                             "Wrong RIC Indication SNs of the first subscription");
+      NS_TEST_EXPECT_MSG_EQ ((m_sequenceNumbers[second] == secondSequenceNumbers), true,
+                             "Wrong RIC Indication SNs of the second subscription");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_ric->GetStats ().m_decodeErrors, 0,
+                         "Messages of the E2 node not decoded");
+
+  m_ric->Dispose ();
+  m_e2Term->Dispose ();
+  m_ric = nullptr;
+  m_e2Term = nullptr;
+  Simulator::Destroy ();
+}
+
+/**
+* Inbound queue of the E2Termination: RIC Control Requests received on
+* the reactor thread are dispatched on the simulator thread, the
+* receiving thread waiting for room in the full queue
+*/
+class InboundQueueTestCase : public TestCase
+{
+public:
+  InboundQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  void SendControls (uint32_t count);
+
+  /**
+  * Keeps the simulator running until the messages are dispatched
+  */
+  void Poll (uint64_t dispatched, uint32_t polls);
+
+  /**
+  * \return false if fewer messages were received or dropped after 5 s
+  */
+  bool WaitForMessages (uint64_t count);
+
+  Ptr<E2Termination> m_e2Term;
+  Ptr<MockRic> m_ric;
+  std::mutex m_mutex;
+  std::vector<std::thread::id> m_callbackThreads;
+};
+
+InboundQueueTestCase::InboundQueueTestCase ()
+  : TestCase ("Inbound queue")
+{
+}
+
+void
+InboundQueueTestCase::SendControls (uint32_t count)
+{
+  for (uint32_t i = 0; i < count; ++i)
+    {
+      m_ric->SendControl (MockRic::HANDOVER, 1, 2);
+    }
+}
+
+void
+InboundQueueTestCase::Poll (uint64_t dispatched, uint32_t polls)
+{
+  if (m_e2Term->GetInboundQueueStats ().m_dispatched >= dispatched || polls == 0)
+    {
+      Simulator::Stop ();
+      return;
+    }
+  std::this_thread::sleep_for (std::chrono::milliseconds (1));
+  Simulator::Schedule (MilliSeconds (1), &InboundQueueTestCase::Poll, this, dispatched, polls - 1);
+}
+
+bool
+InboundQueueTestCase::WaitForMessages (uint64_t count)
+{
+  for (uint32_t i = 0; i < 5000; ++i)
+    {
+      E2Termination::InboundQueueStats stats = m_e2Term->GetInboundQueueStats ();
+      if (stats.m_received + stats.m_dropped >= count)
+        {
+          return true;
+        }
+      std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+  return false;
+}
+
+void
+InboundQueueTestCase::DoRun (void)
+{
+  // the simulator is created on this thread, before the reactor thread
+  // schedules the dispatches on it
+  Simulator::Schedule (MilliSeconds (1), &InboundQueueTestCase::SendControls, this, 6);
+  Simulator::Schedule (MilliSeconds (1), &InboundQueueTestCase::Poll, this, 8, 5000);
+
+  auto pair = InProcessE2Transport::CreatePair ();
+  m_e2Term = CreateObject<E2Termination> ("127.0.0.1", 36422, 38470, "1", "111");
+  m_e2Term->SetAttribute ("InboundQueueSize", UintegerValue (2));
+  m_e2Term->SetAttribute ("InboundQueueTimeout", TimeValue (MilliSeconds (500)));
+  m_e2Term->SetTransport (pair.first);
+  m_e2Term->RegisterSmCallbackToE2Sm (300, Create<RicControlFunctionDescription> (),
+                                      [this] (E2AP_PDU_t *pdu) {
+                                        std::lock_guard<std::mutex> lock (m_mutex);
+                                        m_callbackThreads.push_back (std::this_thread::get_id ());
+                                      });
+
+  m_ric = CreateObject<MockRic> ();
+  m_ric->SetTransport (pair.second);
+  m_ric->Start ();
+  m_e2Term->Start ();
+  NS_TEST_EXPECT_MSG_EQ (m_ric->WaitForSetup (5000), true, "No E2 Setup Request");
+
+  // the simulator is not running, the third message is dropped once the
+  // reactor thread gave up waiting for room
+  SendControls (3);
+  NS_TEST_EXPECT_MSG_EQ (WaitForMessages (3), true, "RIC Control Requests not received");
+  E2Termination::InboundQueueStats stats = m_e2Term->GetInboundQueueStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.m_received, 2, "Wrong number of queued messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_dropped, 1, "Message of the full queue not dropped");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_dispatched, 0, "Message dispatched without the simulator");
+
+  // the simulator thread drains the queue as the reactor thread fills it
+  Simulator::Run ();
+
+  stats = m_e2Term->GetInboundQueueStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.m_received, 8, "Wrong number of received messages");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_dispatched, stats.m_received, "Received messages not dispatched");
+  NS_TEST_EXPECT_MSG_EQ (stats.m_dropped, 1, "Messages dropped while the simulator runs");
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    NS_TEST_EXPECT_MSG_EQ (m_callbackThreads.size (), 8, "Wrong number of callbacks");
+    for (std::thread::id id : m_callbackThreads)
+      {
+        NS_TEST_EXPECT_MSG_EQ ((id == std::this_thread::get_id ()), true,
+                               "Callback not run on the simulator thread");
+      }
+  }
+
+  m_ric->Dispose ();
+  m_e2Term->Dispose ();
+  m_ric = nullptr;
+  m_e2Term = nullptr;
+  Simulator::Destroy ();
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -83,6 +2138,31 @@ OranInterfaceTestSuite::OranInterfaceTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new OranInterfaceTestCase1, TestCase::QUICK);
+  AddTestCase (new Asn1ArenaTestCase, TestCase::QUICK);
+  AddTestCase (new EncodeBufferPoolTestCase, TestCase::QUICK);
+  AddTestCase (new Asn1cAllocTestCase, TestCase::QUICK);
+  AddTestCase (new KpmHeaderTemplateTestCase, TestCase::QUICK);
+  AddTestCase (new KpiTableTestCase, TestCase::QUICK);
+  AddTestCase (new KpiSchemaTestCase, TestCase::QUICK);
+  AddTestCase (new KpiRecordLegacyViewTestCase, TestCase::QUICK);
+  AddTestCase (new MeasurementNameRegistryTestCase, TestCase::QUICK);
+  AddTestCase (new KpmParallelBuildTestCase, TestCase::QUICK);
+  AddTestCase (new KpmIndicationSplitTestCase, TestCase::QUICK);
+  AddTestCase (new KpmReportTreeTestCase, TestCase::QUICK);
+  AddTestCase (new KpmUeIdCacheTestCase, TestCase::QUICK);
+  AddTestCase (new KpmSubscriptionFilterTestCase, TestCase::QUICK);
+  AddTestCase (new KpmCellFormat1TestCase, TestCase::QUICK);
+  AddTestCase (new KpmBatchedGranularityTestCase, TestCase::QUICK);
+  AddTestCase (new KpmHistogramLabelTestCase, TestCase::QUICK);
+  AddTestCase (new KpmMeasIdEncodingTestCase, TestCase::QUICK);
+  AddTestCase (new KpmEventTriggerTestCase, TestCase::QUICK);
+  AddTestCase (new MpscQueueTestCase, TestCase::QUICK);
+  AddTestCase (new E2IoReactorTestCase, TestCase::QUICK);
+  AddTestCase (new E2TransportTestCase, TestCase::QUICK);
+  AddTestCase (new SenderThreadTestCase, TestCase::QUICK);
+  AddTestCase (new MockRicLoopbackTestCase, TestCase::QUICK);
+  AddTestCase (new PeriodicReportsTestCase, TestCase::QUICK);
+  AddTestCase (new InboundQueueTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite